@@ -0,0 +1,311 @@
+#include "MockOutlineServer.h"
+
+#include "outline/constants/ApiEndpoint.h"
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
+#include <stdexcept>
+
+namespace outline {
+namespace bench {
+
+namespace http = boost::beast::http;
+namespace ssl = boost::asio::ssl;
+using boost::asio::ip::tcp;
+
+namespace {
+
+constexpr std::string_view kPrefix = "/bench";
+
+struct Route {
+  http::verb verb;
+  std::string_view endpoint;
+  int status;
+};
+
+// Status of every route; bodies are picked in route().
+constexpr Route kRoutes[] = {
+    {http::verb::get, api::Endpoints::GetAccessKeys, 200},
+    {http::verb::get, api::Endpoints::GetAccessKeyById, 200},
+    {http::verb::post, api::Endpoints::CreateAccessKey, 201},
+    {http::verb::put, api::Endpoints::UpdateAccessKey, 201},
+    {http::verb::delete_, api::Endpoints::DeleteAccessKey, 204},
+    {http::verb::put, api::Endpoints::RenameAccessKey, 204},
+    {http::verb::put, api::Endpoints::AddDataLimit, 204},
+    {http::verb::delete_, api::Endpoints::DeleteDataLimit, 204},
+    {http::verb::get, api::Endpoints::GetMetrics, 200},
+    {http::verb::get, api::Endpoints::GetServerInformation, 200},
+    {http::verb::put, api::Endpoints::SetServerName, 204},
+    {http::verb::put, api::Endpoints::SetHostName, 204},
+    {http::verb::get, api::Endpoints::GetMetricsStatus, 200},
+    {http::verb::put, api::Endpoints::SetMetricsStatus, 204},
+    {http::verb::put, api::Endpoints::SetDefaultPort, 204},
+    {http::verb::put, api::Endpoints::SetDataLimitForAllAccessKeys, 204},
+    {http::verb::delete_, api::Endpoints::DeleteDataLimitForAllAccessKeys,
+     204},
+};
+
+// Compares the path with an endpoint template segment by segment; a
+// "{placeholder}" segment matches any value.
+bool matches(std::string_view endpoint, std::string_view path) {
+  while (!endpoint.empty() && !path.empty()) {
+    auto endpointEnd = endpoint.find('/', 1);
+    auto pathEnd = path.find('/', 1);
+    auto segment = endpoint.substr(0, endpointEnd);
+    auto value = path.substr(0, pathEnd);
+    bool placeholder = segment.size() > 2 && segment[1] == '{';
+    if (!placeholder && segment != value)
+      return false;
+    endpoint = endpointEnd == std::string_view::npos
+                   ? std::string_view()
+                   : endpoint.substr(endpointEnd);
+    path = pathEnd == std::string_view::npos ? std::string_view()
+                                             : path.substr(pathEnd);
+  }
+  return endpoint.empty() && path.empty();
+}
+
+std::string accessKeyJson(std::size_t id) {
+  std::string idText = std::to_string(id);
+  return "{\"id\":\"" + idText + "\",\"name\":\"key-" + idText +
+         "\",\"password\":\"Zb9Xk2qLmP4rT7vW\",\"port\":12345,"
+         "\"method\":\"chacha20-ietf-poly1305\",\"accessUrl\":\"ss://"
+         "Y2hhY2hhMjAtaWV0Zi1wb2x5MTMwNTpaYjlYazJxTG1QNHJUN3ZX@127.0.0.1:"
+         "12345/?outline=1\",\"dataLimit\":{\"bytes\":" +
+         std::to_string(1000000000 + id) + "}}";
+}
+
+struct KeyDeleter {
+  void operator()(EVP_PKEY* key) const { EVP_PKEY_free(key); }
+};
+struct CertDeleter {
+  void operator()(X509* cert) const { X509_free(cert); }
+};
+struct KeygenDeleter {
+  void operator()(EVP_PKEY_CTX* ctx) const { EVP_PKEY_CTX_free(ctx); }
+};
+
+// Installs a fresh self-signed P-256 certificate for 127.0.0.1.
+void useSelfSignedCertificate(ssl::context& context) {
+  std::unique_ptr<EVP_PKEY_CTX, KeygenDeleter> keygen(
+      EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr));
+  EVP_PKEY* rawKey = nullptr;
+  if (!keygen || EVP_PKEY_keygen_init(keygen.get()) <= 0 ||
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keygen.get(),
+                                             NID_X9_62_prime256v1) <= 0 ||
+      EVP_PKEY_keygen(keygen.get(), &rawKey) <= 0) {
+    throw std::runtime_error("Unable to generate the mock server key");
+  }
+  std::unique_ptr<EVP_PKEY, KeyDeleter> key(rawKey);
+
+  std::unique_ptr<X509, CertDeleter> cert(X509_new());
+  X509_set_version(cert.get(), 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert.get()), 24 * 60 * 60);
+  X509_set_pubkey(cert.get(), key.get());
+  X509_NAME* name = X509_get_subject_name(cert.get());
+  X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<const unsigned char*>("127.0.0.1"), -1, -1, 0);
+  X509_set_issuer_name(cert.get(), name);
+  if (X509_sign(cert.get(), key.get(), EVP_sha256()) <= 0 ||
+      SSL_CTX_use_certificate(context.native_handle(), cert.get()) != 1 ||
+      SSL_CTX_use_PrivateKey(context.native_handle(), key.get()) != 1) {
+    throw std::runtime_error("Unable to install the mock server certificate");
+  }
+}
+
+}  // namespace
+
+MockOutlineServer::MockOutlineServer(const MockServerOptions& options)
+    : m_latency(options.latency), m_errorRate(options.errorRate) {
+  useSelfSignedCertificate(m_ssl);
+  m_accessKey = std::make_shared<const std::string>(accessKeyJson(0));
+  m_serverInfo = std::make_shared<const std::string>(
+      "{\"name\":\"bench\",\"serverId\":\"5f1c3e0a-bench\","
+      "\"metricsEnabled\":true,\"createdTimestampMs\":1700000000000,"
+      "\"version\":\"1.9.0\",\"portForNewAccessKeys\":12345,"
+      "\"hostnameForAccessKeys\":\"127.0.0.1\"}");
+  m_metricsEnabled =
+      std::make_shared<const std::string>("{\"metricsEnabled\":true}");
+  m_empty = std::make_shared<const std::string>();
+  setKeyCount(options.keyCount);
+
+  tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), 0);
+  m_acceptor.open(endpoint.protocol());
+  m_acceptor.set_option(tcp::acceptor::reuse_address(true));
+  m_acceptor.bind(endpoint);
+  m_acceptor.listen();
+
+  boost::asio::co_spawn(m_io, acceptLoop(), boost::asio::detached);
+  for (std::size_t i = 0; i < std::max<std::size_t>(1, options.threads); ++i) {
+    m_threads.emplace_back([this, onStart = options.onThreadStart]() {
+      if (onStart)
+        onStart();
+      m_io.run();
+    });
+  }
+}
+
+MockOutlineServer::~MockOutlineServer() {
+  m_io.stop();
+  for (auto& thread : m_threads)
+    thread.join();
+}
+
+std::string MockOutlineServer::apiUrl() const {
+  return "https://127.0.0.1:" +
+         std::to_string(m_acceptor.local_endpoint().port()) +
+         std::string(kPrefix);
+}
+
+void MockOutlineServer::setKeyCount(std::size_t keyCount) {
+  auto accessKeys =
+      std::make_shared<const std::string>(makeAccessKeysBody(keyCount));
+  auto metrics = std::make_shared<const std::string>(makeMetricsBody(keyCount));
+  std::lock_guard lock(m_mutex);
+  m_accessKeys = std::move(accessKeys);
+  m_metrics = std::move(metrics);
+}
+
+std::shared_ptr<const std::string> MockOutlineServer::accessKeysBody() const {
+  std::lock_guard lock(m_mutex);
+  return m_accessKeys;
+}
+
+std::shared_ptr<const std::string> MockOutlineServer::metricsBody() const {
+  std::lock_guard lock(m_mutex);
+  return m_metrics;
+}
+
+std::string MockOutlineServer::makeAccessKeysBody(std::size_t keyCount) {
+  std::string body = "{\"accessKeys\":[";
+  body.reserve(16 + keyCount * 260);
+  for (std::size_t i = 0; i < keyCount; ++i) {
+    if (i != 0)
+      body += ',';
+    body += accessKeyJson(i);
+  }
+  body += "]}";
+  return body;
+}
+
+std::string MockOutlineServer::makeMetricsBody(std::size_t keyCount) {
+  std::string body = "{\"bytesTransferredByUserId\":{";
+  body.reserve(32 + keyCount * 24);
+  for (std::size_t i = 0; i < keyCount; ++i) {
+    if (i != 0)
+      body += ',';
+    body += '"' + std::to_string(i) + "\":" + std::to_string(i * 7919 + 1);
+  }
+  body += "}}";
+  return body;
+}
+
+boost::asio::awaitable<void> MockOutlineServer::acceptLoop() {
+  for (;;) {
+    boost::system::error_code ec;
+    auto socket = co_await m_acceptor.async_accept(
+        boost::asio::make_strand(m_io),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (ec)
+      co_return;
+    socket.set_option(tcp::no_delay(true));
+    auto executor = socket.get_executor();
+    boost::asio::co_spawn(executor, serve(std::move(socket)),
+                          boost::asio::detached);
+  }
+}
+
+boost::asio::awaitable<void> MockOutlineServer::serve(tcp::socket socket) {
+  boost::beast::ssl_stream<boost::beast::tcp_stream> stream(std::move(socket),
+                                                            m_ssl);
+  boost::system::error_code ec;
+  co_await stream.async_handshake(
+      ssl::stream_base::server,
+      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  if (ec)
+    co_return;
+
+  boost::beast::flat_buffer buffer;
+  boost::asio::steady_timer delay(co_await boost::asio::this_coro::executor);
+  for (;;) {
+    http::request<http::string_body> req;
+    co_await http::async_read(
+        stream, buffer, req,
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (ec)
+      break;
+    ++m_requests;
+
+    auto latency = m_latency.load();
+    if (latency.count() > 0) {
+      delay.expires_after(latency);
+      co_await delay.async_wait(
+          boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }
+
+    Response response =
+        failNow() ? Response{503, m_empty}
+                  : route(req.method(), std::string_view(req.target().data(),
+                                                         req.target().size()));
+    // The body is shared, not copied: response keeps it alive.
+    http::response<http::span_body<const char>> res(
+        static_cast<http::status>(response.status), req.version());
+    res.keep_alive(req.keep_alive());
+    if (!response.body->empty()) {
+      res.set(http::field::content_type, "application/json");
+      res.body() = {response.body->data(), response.body->size()};
+    }
+    res.prepare_payload();
+    co_await http::async_write(
+        stream, res,
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (ec || !req.keep_alive())
+      break;
+  }
+  co_await stream.async_shutdown(
+      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+}
+
+MockOutlineServer::Response MockOutlineServer::route(
+    boost::beast::http::verb verb, std::string_view target) {
+  if (target.substr(0, kPrefix.size()) != kPrefix)
+    return {404, m_empty};
+  std::string_view path = target.substr(kPrefix.size());
+  path = path.substr(0, path.find('?'));
+
+  for (const auto& route : kRoutes) {
+    if (route.verb != verb || !matches(route.endpoint, path))
+      continue;
+    if (route.status == 204)
+      return {204, m_empty};
+    if (route.endpoint == api::Endpoints::GetAccessKeys &&
+        verb == http::verb::get) {
+      return {200, accessKeysBody()};
+    }
+    if (route.endpoint == api::Endpoints::GetMetrics)
+      return {200, metricsBody()};
+    if (route.endpoint == api::Endpoints::GetServerInformation)
+      return {200, m_serverInfo};
+    if (route.endpoint == api::Endpoints::GetMetricsStatus)
+      return {200, m_metricsEnabled};
+    return {route.status, m_accessKey};
+  }
+  return {404, m_empty};
+}
+
+bool MockOutlineServer::failNow() {
+  double rate = m_errorRate.load();
+  if (rate <= 0)
+    return false;
+  std::lock_guard lock(m_mutex);
+  return std::uniform_real_distribution<double>(0, 1)(m_random) < rate;
+}
+
+}  // namespace bench
+}  // namespace outline
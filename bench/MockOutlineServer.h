@@ -0,0 +1,108 @@
+#ifndef OUTLINE_BENCH_MOCK_OUTLINE_SERVER_H
+#define OUTLINE_BENCH_MOCK_OUTLINE_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/http/verb.hpp>
+
+namespace outline {
+namespace bench {
+
+/**
+ * @brief Settings of the mock server.
+ */
+struct MockServerOptions {
+  // Keys listed by /access-keys and /metrics/transfer.
+  std::size_t keyCount = 100;
+  // Added before every response.
+  std::chrono::microseconds latency{0};
+  // Fraction of requests answered with 503 instead of the normal response.
+  double errorRate = 0;
+  std::size_t threads = 1;
+  // Runs first on every server thread, e.g. to exclude it from allocation
+  // counts.
+  std::function<void()> onThreadStart;
+};
+
+/**
+ * @brief In-process HTTPS server answering the api::Endpoints routes like
+ *        an Outline server, for benchmarks.
+ *
+ * Listens on 127.0.0.1 with a self-signed certificate generated at start,
+ * keeps connections alive and answers pipelined requests in order. The key
+ * list and metrics bodies are built once per setKeyCount().
+ */
+class MockOutlineServer {
+ public:
+  explicit MockOutlineServer(const MockServerOptions& options = {});
+  ~MockOutlineServer();
+
+  MockOutlineServer(const MockOutlineServer&) = delete;
+  MockOutlineServer& operator=(const MockOutlineServer&) = delete;
+
+  /**
+   * @brief Returns the API URL to pass to OutlineClient.
+   */
+  std::string apiUrl() const;
+
+  void setKeyCount(std::size_t keyCount);
+  void setLatency(std::chrono::microseconds latency) { m_latency = latency; }
+  void setErrorRate(double errorRate) { m_errorRate = errorRate; }
+
+  std::uint64_t requests() const { return m_requests.load(); }
+
+  /**
+   * @brief Returns the /access-keys body for the current key count.
+   */
+  std::shared_ptr<const std::string> accessKeysBody() const;
+  std::shared_ptr<const std::string> metricsBody() const;
+
+  static std::string makeAccessKeysBody(std::size_t keyCount);
+  static std::string makeMetricsBody(std::size_t keyCount);
+
+ private:
+  struct Response {
+    int status = 200;
+    std::shared_ptr<const std::string> body;
+  };
+
+  boost::asio::awaitable<void> acceptLoop();
+  boost::asio::awaitable<void> serve(boost::asio::ip::tcp::socket socket);
+  Response route(boost::beast::http::verb verb, std::string_view target);
+  bool failNow();
+
+  boost::asio::io_context m_io;
+  boost::asio::ssl::context m_ssl{boost::asio::ssl::context::tls_server};
+  boost::asio::ip::tcp::acceptor m_acceptor{m_io};
+  std::vector<std::thread> m_threads;
+
+  std::atomic<std::chrono::microseconds> m_latency;
+  std::atomic<double> m_errorRate;
+  std::atomic<std::uint64_t> m_requests{0};
+
+  mutable std::mutex m_mutex;
+  std::shared_ptr<const std::string> m_accessKeys;
+  std::shared_ptr<const std::string> m_metrics;
+  std::shared_ptr<const std::string> m_accessKey;
+  std::shared_ptr<const std::string> m_serverInfo;
+  std::shared_ptr<const std::string> m_metricsEnabled;
+  std::shared_ptr<const std::string> m_empty;
+  std::mt19937 m_random{42};
+};
+
+}  // namespace bench
+}  // namespace outline
+
+#endif  // OUTLINE_BENCH_MOCK_OUTLINE_SERVER_H
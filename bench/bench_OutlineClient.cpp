@@ -0,0 +1,273 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "MockOutlineServer.h"
+#include "outline/OutlineClient.h"
+#include "outline/constants/ApiEndpoint.h"
+#include "outline/utils/JsonArena.h"
+#include "outline/utils/JsonStreamParsers.h"
+#include "outline/utils/JsonUtils.h"
+
+// Counts heap allocations of the benchmark and client threads; the mock
+// server's threads are excluded.
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+thread_local bool t_untracked = false;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  if (!t_untracked)
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+using outline::bench::MockOutlineServer;
+using outline::bench::MockServerOptions;
+
+// One mock server for the whole run; benchmarks reconfigure it.
+MockOutlineServer& server() {
+  static MockOutlineServer instance([] {
+    MockServerOptions options;
+    options.threads = 2;
+    options.onThreadStart = []() { t_untracked = true; };
+    return options;
+  }());
+  return instance;
+}
+
+std::shared_ptr<outline::OutlineClient> makeClient(
+    outline::OutlineClientOptions options = {}) {
+  return outline::OutlineClient::create(server().apiUrl(), "", 10, options);
+}
+
+// Reports the latency percentiles the client recorded for the endpoint.
+void reportLatency(benchmark::State& state,
+                   const outline::OutlineClient& client,
+                   std::string_view endpoint) {
+  auto snapshot = client.getInstrumentation();
+  for (const auto& e : snapshot.endpoints) {
+    if (e.endpoint != endpoint)
+      continue;
+    state.counters["p50_us"] = static_cast<double>(e.latency.percentile(0.5));
+    state.counters["p99_us"] = static_cast<double>(e.latency.percentile(0.99));
+  }
+}
+
+void reportAllocations(benchmark::State& state, std::uint64_t allocations) {
+  state.counters["allocs_per_call"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// Latency of one call on a warm connection; the argument is the latency
+// injected by the server in microseconds.
+void BM_SingleCallLatency(benchmark::State& state) {
+  server().setLatency(std::chrono::microseconds(state.range(0)));
+  server().setErrorRate(0);
+  auto client = makeClient();
+  client->getServerInformationTyped();
+
+  std::uint64_t allocations = 0;
+  for (auto _ : state) {
+    auto before = g_allocations.load(std::memory_order_relaxed);
+    benchmark::DoNotOptimize(client->getServerInformationTyped());
+    allocations += g_allocations.load(std::memory_order_relaxed) - before;
+  }
+  reportAllocations(state, allocations);
+  reportLatency(state, *client,
+                outline::api::Endpoints::GetServerInformation);
+  server().setLatency(std::chrono::microseconds(0));
+}
+BENCHMARK(BM_SingleCallLatency)
+    ->Arg(0)
+    ->Arg(1000)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// GET /access-keys end to end; the argument is the number of keys.
+void BM_GetAccessKeys(benchmark::State& state) {
+  server().setKeyCount(static_cast<std::size_t>(state.range(0)));
+  server().setErrorRate(0);
+  auto body = server().accessKeysBody();
+  outline::OutlineClientOptions options;
+  options.jsonArenaSize = 64 * 1024;
+  auto client = makeClient(options);
+
+  std::uint64_t allocations = 0;
+  for (auto _ : state) {
+    auto before = g_allocations.load(std::memory_order_relaxed);
+    auto keys = client->getAccessKeysTyped();
+    allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() *
+                                                    body->size()));
+  reportAllocations(state, allocations);
+  reportLatency(state, *client, outline::api::Endpoints::GetAccessKeys);
+}
+BENCHMARK(BM_GetAccessKeys)
+    ->RangeMultiplier(10)
+    ->Range(1, 100000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Calls in flight at once over the pool; the arguments are the number of
+// concurrent calls and the server error rate in permille. Failed calls are
+// retried by the client and counted as errors when retries run out.
+void BM_FanOutThroughput(benchmark::State& state) {
+  const auto concurrency = static_cast<std::size_t>(state.range(0));
+  server().setErrorRate(static_cast<double>(state.range(1)) / 1000);
+  outline::OutlineClientOptions options;
+  options.pool.maxPerHost = concurrency;
+  auto client = makeClient(options);
+
+  std::uint64_t errors = 0;
+  std::vector<std::future<outline::ServerInfo>> calls;
+  calls.reserve(concurrency);
+  for (auto _ : state) {
+    calls.clear();
+    for (std::size_t i = 0; i < concurrency; ++i)
+      calls.push_back(client->getServerInformationTypedAsync());
+    for (auto& call : calls) {
+      try {
+        benchmark::DoNotOptimize(call.get());
+      } catch (const std::exception&) {
+        ++errors;
+      }
+    }
+  }
+  state.SetItemsProcessed(
+      static_cast<std::int64_t>(state.iterations() * concurrency));
+  state.counters["errors"] = static_cast<double>(errors);
+  reportLatency(state, *client,
+                outline::api::Endpoints::GetServerInformation);
+  server().setErrorRate(0);
+}
+BENCHMARK(BM_FanOutThroughput)
+    ->ArgsProduct({{1, 8, 64}, {0}})
+    ->ArgsProduct({{8}, {10, 100}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Reconciling a server after the first resync; the arguments are the
+// number of keys and the number of them renamed per reconcile.
+void BM_ReconcileAccessKeys(benchmark::State& state) {
+  const auto keyCount = static_cast<std::size_t>(state.range(0));
+  const auto changes = static_cast<std::size_t>(state.range(1));
+  server().setKeyCount(keyCount);
+  server().setErrorRate(0);
+  outline::OutlineClientOptions options;
+  options.pipelineDepth = 16;
+  auto client = makeClient(options);
+
+  std::vector<outline::DesiredAccessKey> desired(keyCount);
+  for (std::size_t i = 0; i < keyCount; ++i) {
+    desired[i] = {std::to_string(i), "key-" + std::to_string(i),
+                  static_cast<int>(1000000000 + i)};
+  }
+  outline::AccessKeyReconciler reconciler;
+  client->reconcileAccessKeys(reconciler, desired);
+
+  std::uint64_t requests = 0;
+  std::size_t round = 0;
+  for (auto _ : state) {
+    ++round;
+    const std::string suffix = "-" + std::to_string(round);
+    for (std::size_t i = 0; i < changes; ++i)
+      desired[i].name = "key-" + std::to_string(i) + suffix;
+    auto before = server().requests();
+    auto report = client->reconcileAccessKeys(reconciler, desired);
+    requests += server().requests() - before;
+    benchmark::DoNotOptimize(report.mutations.data());
+  }
+  state.counters["requests_per_reconcile"] = benchmark::Counter(
+      static_cast<double>(requests), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ReconcileAccessKeys)
+    ->ArgsProduct({{20000}, {0, 10, 100}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Parsing an /access-keys body without the network; the arguments are the
+// number of keys and the arena size in KiB (0 parses on the heap).
+void BM_ParseAccessKeys(benchmark::State& state) {
+  const std::string body = MockOutlineServer::makeAccessKeysBody(
+      static_cast<std::size_t>(state.range(0)));
+  outline::utils::JsonArenaPool arenas(
+      static_cast<std::size_t>(state.range(1)) * 1024, 1);
+
+  std::uint64_t allocations = 0;
+  for (auto _ : state) {
+    auto before = g_allocations.load(std::memory_order_relaxed);
+    auto lease = arenas.acquire();
+    auto value = lease.parse(body, "access keys");
+    auto keys = outline::utils::jsonTo<std::vector<outline::AccessKey>>(
+        value.as_object().at("accessKeys"), "access keys");
+    allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetBytesProcessed(
+      static_cast<std::int64_t>(state.iterations() * body.size()));
+  reportAllocations(state, allocations);
+}
+BENCHMARK(BM_ParseAccessKeys)
+    ->ArgsProduct({{1, 100, 10000, 100000}, {0, 256}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Billing queries over a snapshot built from the key list and metrics
+// bodies without the network; the argument is the number of keys.
+void BM_AccessKeySnapshotQueries(benchmark::State& state) {
+  const auto keyCount = static_cast<std::size_t>(state.range(0));
+  outline::AccessKeySnapshot snapshot(keyCount);
+  outline::utils::AccessKeyStreamParser keys(
+      [&snapshot](outline::AccessKey&& key) { snapshot.add(key); });
+  keys.write(MockOutlineServer::makeAccessKeysBody(keyCount));
+  keys.finish();
+  outline::utils::TransferMetricsStreamParser metrics(
+      [&snapshot](std::string_view id, std::uint64_t bytes) {
+        snapshot.setBytes(id, bytes);
+      });
+  metrics.write(MockOutlineServer::makeMetricsBody(keyCount));
+  metrics.finish();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(snapshot.totalBytes());
+    auto top = snapshot.topUsage(10);
+    auto over = snapshot.overLimit(0.9);
+    benchmark::DoNotOptimize(top.data());
+    benchmark::DoNotOptimize(over.data());
+    for (std::size_t i = 0; i < keyCount; i += 97)
+      benchmark::DoNotOptimize(snapshot.find(std::to_string(i)));
+  }
+  state.SetItemsProcessed(
+      static_cast<std::int64_t>(state.iterations() * keyCount));
+}
+BENCHMARK(BM_AccessKeySnapshotQueries)
+    ->RangeMultiplier(10)
+    ->Range(1000, 100000)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
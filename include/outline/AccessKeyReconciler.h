@@ -0,0 +1,157 @@
+#ifndef OUTLINE_ACCESS_KEY_RECONCILER_H
+#define OUTLINE_ACCESS_KEY_RECONCILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "outline/models/AccessKey.h"
+#include "outline/models/BatchResult.h"
+
+namespace outline {
+
+/**
+ * @brief State one access key should have on the server.
+ */
+struct DesiredAccessKey {
+  std::string id;
+  std::string name;
+  // Unset means the key has no data limit.
+  std::optional<int> dataLimitBytes;
+};
+
+/**
+ * @brief One change that brings a server key to its desired state.
+ */
+struct AccessKeyMutation {
+  enum class Kind {
+    // PUT /access-keys/{id} with the name and the data limit.
+    Create,
+    Rename,
+    SetDataLimit,
+    RemoveDataLimit,
+    // Only for keys missing from the desired set, with deleteUnlisted.
+    Delete,
+  };
+
+  Kind kind = Kind::Create;
+  std::string accessKeyId;
+  // Create and Rename.
+  std::string name;
+  // Create and SetDataLimit.
+  std::optional<int> dataLimitBytes;
+};
+
+/**
+ * @brief What one reconcile did.
+ */
+struct ReconcileReport {
+  // The server's key list was fetched before diffing.
+  bool resynced = false;
+  // The mutations sent, and the outcome of each at the same index.
+  std::vector<AccessKeyMutation> mutations;
+  BatchResult<void> results;
+
+  std::size_t failed() const {
+    std::size_t count = 0;
+    for (const auto& result : results) {
+      if (!result.ok())
+        ++count;
+    }
+    return count;
+  }
+};
+
+/**
+ * @brief Settings of AccessKeyReconciler.
+ */
+struct ReconcilerOptions {
+  // The full key list is fetched again when the snapshot is older than this,
+  // picking up changes made outside the reconciler. 0 fetches it every time.
+  std::chrono::seconds resyncInterval{600};
+  // Delete server keys that are missing from the desired set.
+  bool deleteUnlisted = false;
+};
+
+/**
+ * @brief Keeps a snapshot of a server's access keys and diffs desired key
+ *        sets against it.
+ *
+ * The snapshot is loaded from a full key list (beginResync(), update() per
+ * key, finishResync()) and then kept current by commit() from the outcome
+ * of the mutations, so between resyncs a reconcile costs one request per
+ * change instead of a fetch of every key. A failed mutation leaves the
+ * server state unknown and makes the next reconcile resync first. Not
+ * thread safe.
+ */
+class AccessKeyReconciler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit AccessKeyReconciler(const ReconcilerOptions& options = {});
+
+  /**
+   * @brief Returns true if the snapshot must be loaded before planning:
+   *        there is none, it is older than resyncInterval, or a mutation
+   *        failed or invalidate() was called since the last resync.
+   */
+  bool resyncDue(Clock::time_point now = Clock::now()) const;
+  /**
+   * @brief Starts loading a new snapshot; the current one stays in use
+   *        until finishResync().
+   */
+  void beginResync();
+  /**
+   * @brief Records one key of the server's list in the new snapshot.
+   */
+  void update(AccessKey&& key);
+  /**
+   * @brief Replaces the snapshot with the keys recorded since beginResync().
+   */
+  void finishResync(Clock::time_point now = Clock::now());
+
+  /**
+   * @brief Returns the mutations that turn the snapshot into the desired
+   *        set: a create per missing key, and a rename or data-limit change
+   *        per field that differs.
+   * @throws std::invalid_argument if an id appears twice in desired.
+   */
+  std::vector<AccessKeyMutation> plan(
+      const std::vector<DesiredAccessKey>& desired) const;
+  /**
+   * @brief Applies the mutations that succeeded to the snapshot.
+   * @param results - the outcome of each mutation, at the same index.
+   */
+  void commit(const std::vector<AccessKeyMutation>& mutations,
+              const BatchResult<void>& results);
+
+  /**
+   * @brief Makes the next reconcile resync first.
+   */
+  void invalidate() { m_stale = true; }
+  /**
+   * @brief Returns the number of keys in the snapshot.
+   */
+  std::size_t size() const { return m_snapshot.size(); }
+  const ReconcilerOptions& options() const { return m_options; }
+
+ private:
+  struct Entry {
+    std::string name;
+    std::optional<std::int64_t> dataLimitBytes;
+  };
+
+  ReconcilerOptions m_options;
+  std::unordered_map<std::string, Entry> m_snapshot;
+  // The snapshot being loaded by a resync.
+  std::unordered_map<std::string, Entry> m_incoming;
+  std::optional<Clock::time_point> m_lastResync;
+  bool m_stale = false;
+};
+
+}  // namespace outline
+
+#endif  // OUTLINE_ACCESS_KEY_RECONCILER_H
@@ -0,0 +1,134 @@
+#ifndef OUTLINE_ACCESS_KEY_SNAPSHOT_H
+#define OUTLINE_ACCESS_KEY_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "outline/models/AccessKey.h"
+
+namespace outline {
+
+/**
+ * @brief Access keys joined with their transferred bytes, stored column by
+ *        column for analytics over many keys.
+ *
+ * Each key is a row; a field of all keys is one contiguous vector, so a scan
+ * such as totalBytes() or overLimit() reads only the columns it needs and
+ * compiles to a tight loop. Ids and names live in one character buffer and
+ * an open-addressing index maps an id to its row. Only the fields billing
+ * needs are kept: id, name, port, data limit and bytes; passwords and access
+ * URLs are dropped. Filled from the parsers' callbacks: add() per access
+ * key, then setBytes() per metrics entry. Not thread safe.
+ */
+class AccessKeySnapshot {
+ public:
+  using Row = std::uint32_t;
+
+  static constexpr Row npos = std::numeric_limits<Row>::max();
+  // Value of dataLimitColumn() for keys without a data limit.
+  static constexpr std::int64_t kNoLimit = -1;
+
+  /**
+   * @param expectedKeys - number of keys to reserve room for.
+   */
+  explicit AccessKeySnapshot(std::size_t expectedKeys = 0);
+
+  /**
+   * @brief Adds the key, or replaces the fields of a key with the same id.
+   * @return the key's row.
+   */
+  Row add(const AccessKey& key);
+  /**
+   * @brief Records the key's transferred bytes.
+   * @return false if no key has the id; the bytes are then counted in
+   *         unmatchedBytes().
+   */
+  bool setBytes(std::string_view accessKeyId, std::uint64_t bytes);
+  void clear();
+
+  std::size_t size() const { return m_ports.size(); }
+  bool empty() const { return m_ports.empty(); }
+  /**
+   * @brief Returns the row of the key, or npos.
+   */
+  Row find(std::string_view accessKeyId) const;
+
+  std::string_view id(Row row) const { return text(m_ids[row]); }
+  std::string_view name(Row row) const { return text(m_names[row]); }
+  std::uint16_t port(Row row) const { return m_ports[row]; }
+  std::optional<std::int64_t> dataLimitBytes(Row row) const {
+    if (m_dataLimits[row] == kNoLimit)
+      return std::nullopt;
+    return m_dataLimits[row];
+  }
+  // 0 for keys missing from the metrics.
+  std::uint64_t bytes(Row row) const { return m_bytes[row]; }
+
+  std::span<const std::uint16_t> portColumn() const { return m_ports; }
+  std::span<const std::int64_t> dataLimitColumn() const {
+    return m_dataLimits;
+  }
+  std::span<const std::uint64_t> bytesColumn() const { return m_bytes; }
+
+  /**
+   * @brief Returns the bytes of all keys.
+   */
+  std::uint64_t totalBytes() const;
+  /**
+   * @brief Returns the bytes of metrics entries without a key, e.g. of keys
+   *        deleted between the two fetches.
+   */
+  std::uint64_t unmatchedBytes() const { return m_unmatchedBytes; }
+  /**
+   * @brief Returns the rows of the n keys with the most bytes, most first;
+   *        equal counts keep the row order.
+   */
+  std::vector<Row> topUsage(std::size_t n) const;
+  /**
+   * @brief Returns the rows, in order, of the keys with a data limit whose
+   *        bytes reached ratio times the limit; 1 finds the keys over their
+   *        limit, 0.9 also those within 10% of it.
+   */
+  std::vector<Row> overLimit(double ratio = 1.0) const;
+
+ private:
+  // Location of an id or a name in m_text.
+  struct TextRef {
+    std::uint32_t offset = 0;
+    std::uint32_t size = 0;
+  };
+
+  std::string_view text(TextRef ref) const {
+    return std::string_view(m_text).substr(ref.offset, ref.size);
+  }
+  TextRef append(std::string_view value);
+  std::size_t slotOf(std::string_view accessKeyId) const;
+  void grow();
+  // Rebuilds the index with room for every row, after the columns were
+  // filled directly.
+  void reindex();
+  void indexRows();
+
+  friend class SnapshotFile;
+
+  // Ids and names of all rows back to back.
+  std::string m_text;
+  std::vector<TextRef> m_ids;
+  std::vector<TextRef> m_names;
+  std::vector<std::uint16_t> m_ports;
+  std::vector<std::int64_t> m_dataLimits;
+  std::vector<std::uint64_t> m_bytes;
+  // Open-addressing table of rows, npos for an empty slot.
+  std::vector<Row> m_index;
+  std::uint64_t m_unmatchedBytes = 0;
+};
+
+}  // namespace outline
+
+#endif  // OUTLINE_ACCESS_KEY_SNAPSHOT_H
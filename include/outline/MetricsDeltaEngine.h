@@ -0,0 +1,110 @@
+#ifndef OUTLINE_METRICS_DELTA_ENGINE_H
+#define OUTLINE_METRICS_DELTA_ENGINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace outline {
+
+/**
+ * @brief Change of one access key's transferred bytes between two polls.
+ */
+struct MetricsDelta {
+  std::string accessKeyId;
+  // Total reported by the server in this poll.
+  std::uint64_t bytes = 0;
+  // Bytes transferred since the previous poll.
+  std::uint64_t deltaBytes = 0;
+  // deltaBytes over the time between the polls.
+  double bytesPerSecond = 0;
+  // The counter went backwards (server restarted); deltaBytes is the total.
+  bool reset = false;
+};
+
+/**
+ * @brief What changed in one poll of /metrics/transfer.
+ */
+struct MetricsDeltaReport {
+  // True for the first poll, which only records the baseline.
+  bool baseline = false;
+  // Time since the previous poll.
+  std::chrono::duration<double> interval{0};
+  // Keys whose byte count changed or which are new, in the server's order.
+  // Empty for a baseline.
+  std::vector<MetricsDelta> changed;
+  // Keys of the previous poll missing from this one.
+  std::vector<std::string> removed;
+};
+
+/**
+ * @brief Keeps the last metrics snapshot and turns each new one into deltas.
+ *
+ * The snapshot is an open-addressing hash table of key id and byte count, so
+ * a poll only touches the entries that exist; nothing is rebuilt unless keys
+ * disappear. Entries are fed one by one, e.g. straight from
+ * utils::TransferMetricsStreamParser. Not thread safe.
+ */
+class MetricsDeltaEngine {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param expectedKeys - number of keys to reserve room for.
+   */
+  explicit MetricsDeltaEngine(std::size_t expectedKeys = 0);
+
+  /**
+   * @brief Starts a poll taken at the given time.
+   */
+  void begin(Clock::time_point now = Clock::now());
+  /**
+   * @brief Records the byte count of one key in the current poll.
+   */
+  void update(std::string_view accessKeyId, std::uint64_t bytes);
+  /**
+   * @brief Ends the poll and returns the keys that changed since the last.
+   */
+  MetricsDeltaReport finish();
+
+  /**
+   * @brief Returns the byte count of the key in the last poll.
+   */
+  std::optional<std::uint64_t> bytes(std::string_view accessKeyId) const;
+  /**
+   * @brief Returns the number of keys in the last poll.
+   */
+  std::size_t size() const { return m_size; }
+  /**
+   * @brief Forgets the snapshot; the next poll is a baseline again.
+   */
+  void clear();
+
+ private:
+  struct Slot {
+    std::string accessKeyId;
+    std::uint64_t bytes = 0;
+    // Number of the last poll that reported the key; 0 for an empty slot.
+    std::uint32_t poll = 0;
+  };
+
+  std::size_t find(std::string_view accessKeyId) const;
+  void grow();
+  void rehash(std::size_t capacity, std::uint32_t minPoll);
+
+  std::vector<Slot> m_slots;
+  std::size_t m_size = 0;
+  // Keys reported in the current poll.
+  std::size_t m_seen = 0;
+  std::uint32_t m_poll = 0;
+  MetricsDeltaReport m_report;
+  std::optional<Clock::time_point> m_lastPoll;
+  Clock::time_point m_currentPoll;
+};
+
+}  // namespace outline
+
+#endif  // OUTLINE_METRICS_DELTA_ENGINE_H
@@ -1,17 +1,50 @@
 #ifndef OUTLINECLIENT_H
 #define OUTLINECLIENT_H
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/ssl.hpp>
+#include <boost/beast/http.hpp>
 #include <boost/url.hpp>
 
+#include "outline/AccessKeyReconciler.h"
+#include "outline/AccessKeySnapshot.h"
+#include "outline/MetricsDeltaEngine.h"
+#include "outline/SnapshotFile.h"
+#include "outline/exceptions/OutlineExceptions.h"
+#include "outline/models/AccessKey.h"
+#include "outline/models/BatchResult.h"
+#include "outline/models/ServerInfo.h"
+#include "outline/models/TransferMetrics.h"
+#include "outline/network/ConnectionPool.h"
+#include "outline/network/ContentDecoding.h"
+#include "outline/network/Hedging.h"
+#include "outline/network/Instrumentation.h"
+#include "outline/network/PeriodicPoller.h"
+#include "outline/network/RequestContext.h"
+#include "outline/network/RequestLimiter.h"
+#include "outline/network/ResolverCache.h"
+#include "outline/network/ResponseCache.h"
+#include "outline/network/Retry.h"
+#include "outline/network/ShutdownGate.h"
+#include "outline/network/SingleFlight.h"
+#include "outline/network/TlsSessionCache.h"
+#include "outline/network/Tracing.h"
+#include "outline/utils/EndpointTemplate.h"
+#include "outline/utils/JsonArena.h"
+
 namespace outline {
 
 struct CreateAccessKeyParams {
@@ -28,6 +61,85 @@ struct UpdateAccessKeyParams {
   std::optional<int> data_limit_bytes;
 };
 
+/**
+ * @brief Per-phase limits of a request. Unset phases use the client timeout.
+ *
+ * connect also bounds the wait for a free pooled connection.
+ */
+struct RequestTimeouts {
+  std::optional<std::chrono::milliseconds> resolve;
+  std::optional<std::chrono::milliseconds> connect;
+  std::optional<std::chrono::milliseconds> handshake;
+  std::optional<std::chrono::milliseconds> write;
+  std::optional<std::chrono::milliseconds> read;
+};
+
+/**
+ * @brief Tuning options of the client.
+ */
+struct OutlineClientOptions {
+  // Number of threads running the client's own io_context.
+  std::size_t ioThreads = 1;
+  // Run on a caller-supplied executor instead of an own io_context. The
+  // caller keeps it running and must outlive all requests of the client.
+  std::optional<boost::asio::any_io_executor> executor;
+  network::ConnectionPoolOptions pool;
+  network::ResolverCacheOptions resolver;
+  RequestTimeouts timeouts;
+  network::RetryOptions retry;
+  // Second requests for GETs slower than their usual latency. Off by
+  // default.
+  network::HedgeOptions hedge;
+  network::LimiterOptions limiter;
+  // Read-through cache of /access-keys, /access-keys/{id} and /server,
+  // invalidated by the calls that change them. Off by default.
+  network::ResponseCacheOptions cache;
+  // Initial size of the per-request JSON arenas used for parsing responses
+  // and building request bodies; 0 parses on the default heap. One arena is
+  // cached for every connection the pool may open.
+  std::size_t jsonArenaSize = 0;
+  // Batch deletes and data-limit updates write up to this many requests
+  // back-to-back on one connection and read the responses in order; 0 or 1
+  // sends one request at a time.
+  std::size_t pipelineDepth = 0;
+  // Resume TLS sessions per host to avoid full handshakes on reconnects.
+  bool tlsSessionResumption = true;
+  // Ask for gzip or deflate compressed responses; they are decoded while
+  // they are read.
+  bool acceptCompression = true;
+  // User-Agent header of every request; empty sends none.
+  std::string userAgent;
+  // Receives a span per request and its phases; null disables tracing.
+  std::shared_ptr<network::Tracer> tracer;
+  // File keeping the last-known server state across restarts. The client
+  // loads it at construction and refreshes it in the background; empty
+  // disables it.
+  std::string snapshotCachePath;
+};
+
+/**
+ * @brief Event loop, TLS context, connection pool and caches used by a
+ *        client. OutlineFleet shares one set among all of its clients.
+ */
+struct OutlineClientResources {
+  boost::asio::any_io_executor executor;
+  std::shared_ptr<boost::asio::ssl::context> sslContext;
+  std::shared_ptr<network::ConnectionPool> pool;
+  std::shared_ptr<network::TlsSessionCache> sessionCache;
+  std::shared_ptr<network::ResolverCache> resolverCache;
+  std::shared_ptr<network::CircuitBreaker> circuitBreaker;
+  std::shared_ptr<network::RequestLimiter> limiter;
+
+  /**
+   * @brief Creates the TLS context, pool and caches for requests running on
+   *        the executor, configured by the options.
+   */
+  static OutlineClientResources create(const OutlineClientOptions& options,
+                                       boost::asio::any_io_executor executor);
+};
+
+class OutlineFleet;
+
 /**
  * @brief Класс OutlineClient отвечает за подключение к Outline-серверу.
  */
@@ -36,24 +148,37 @@ class OutlineClient : public std::enable_shared_from_this<OutlineClient> {
   /**
      * apiUrl - url for server API
      * cert - certificate after apiUrl
-     * timeout - request timeout
+     * timeout - request timeout in seconds, applied to every phase
+     * options - connection pool limits and other tuning options
      */
   OutlineClient(std::string_view apiUrl, std::string_view cert,
-                int timeout = 5);
+                int timeout = 5, const OutlineClientOptions& options = {});
+  /**
+   * @brief Creates a client running on shared resources instead of its own.
+   *        options.executor, pool, resolver and tlsSessionResumption are
+   *        ignored; the resources must outlive the client's requests.
+   */
+  OutlineClient(std::string_view apiUrl, std::string_view cert, int timeout,
+                const OutlineClientOptions& options,
+                OutlineClientResources resources);
 
   /**
-     * @brief Destructor. Stops the io_context and joins the io_thread.
+     * @brief Destructor. Fails the requests still in flight, background
+     *        polls and the snapshot refresh included, closing their
+     *        connections, and blocks until they have let go of the client;
+     *        then stops the own io_context, if any, and joins its threads.
+     *        It must not run on a thread of the client's loop.
      */
   ~OutlineClient();
 
   /**
     * @brief Creates a shared_ptr for handling the lifetime issues
    */
-  static std::shared_ptr<OutlineClient> create(std::string_view apiUrl,
-                                               std::string_view cert,
-                                               int timeout = 5) {
+  static std::shared_ptr<OutlineClient> create(
+      std::string_view apiUrl, std::string_view cert, int timeout = 5,
+      const OutlineClientOptions& options = {}) {
     return std::shared_ptr<OutlineClient>(
-        new OutlineClient(apiUrl, cert, timeout));
+        new OutlineClient(apiUrl, cert, timeout, options));
   }
 
   /**
@@ -61,18 +186,59 @@ class OutlineClient : public std::enable_shared_from_this<OutlineClient> {
      * @return the access keys.
      */
   std::future<std::string> getAccessKeysAsync();
+  /**
+   * @brief Returns the response body of /access-keys as received, without
+   *        parsing it.
+   */
+  std::future<std::string> getAccessKeysRawAsync();
+  /**
+   * @brief Returns the access keys parsed into AccessKey structs.
+   */
+  std::future<std::vector<AccessKey>> getAccessKeysTypedAsync();
+  /**
+   * @brief Streams the access keys: each key is parsed and passed to the
+   *        callback while the body is still arriving, in constant memory.
+   * @param onAccessKey - called on the client's io thread for every key.
+   * @return the number of access keys.
+   */
+  std::future<std::size_t> streamAccessKeysAsync(
+      std::function<void(AccessKey&&)> onAccessKey);
+  /**
+   * @brief Streams the access keys and then the transferred bytes into a
+   *        columnar snapshot, building neither a JSON document nor a map.
+   * @param expectedKeys - number of keys to reserve room for, e.g. the size
+   *        of the previous snapshot.
+   */
+  std::future<AccessKeySnapshot> getAccessKeySnapshotAsync(
+      std::size_t expectedKeys = 0);
   /**
    * @brief Returns the access key by id.
    * @param accessKeyId - the access key id.
    * @return the access key by id.
    */
   std::future<std::string> getAccessKeyAsync(const std::string& accessKeyId);
+  /**
+   * @brief Returns the response body of the access key as received.
+   * @param accessKeyId - the access key id.
+   */
+  std::future<std::string> getAccessKeyRawAsync(const std::string& accessKeyId);
+  /**
+   * @brief Returns the access key by id parsed into an AccessKey.
+   * @param accessKeyId - the access key id.
+   */
+  std::future<AccessKey> getAccessKeyTypedAsync(const std::string& accessKeyId);
   /**
    * @brief Creates the access key.
    * @param params - the parameters for the access key.
    */
   std::future<std::string> createAccessKeyAsync(
       const CreateAccessKeyParams& params);
+  /**
+   * @brief Creates the access key and returns it parsed into an AccessKey.
+   * @param params - the parameters for the access key.
+   */
+  std::future<AccessKey> createAccessKeyTypedAsync(
+      const CreateAccessKeyParams& params);
   /**
    * @brief Updates the access key.
    * @param accessKeyId - the access key id.
@@ -104,17 +270,92 @@ class OutlineClient : public std::enable_shared_from_this<OutlineClient> {
    * @param accessKeyId - the access key id.
    */
   std::future<void> deleteDataLimitAsync(const std::string& accessKeyId);
+  /**
+   * @brief Creates one access key per entry, running at most maxInFlight
+   *        requests at a time over the pooled connections.
+   * @param params - the parameters for each access key.
+   * @param maxInFlight - concurrent requests; 0 uses pool.maxPerHost.
+   * @return the created key or the error of each entry, in input order. The
+   *         future itself only fails if the batch cannot be started.
+   */
+  std::future<BatchResult<AccessKey>> createAccessKeysBatchAsync(
+      std::vector<CreateAccessKeyParams> params, std::size_t maxInFlight = 0);
+  /**
+   * @brief Deletes the access keys, at most maxInFlight at a time.
+   * @param accessKeyIds - the access key ids.
+   * @param maxInFlight - concurrent requests; 0 uses pool.maxPerHost.
+   * @return the outcome of each deletion, in input order.
+   */
+  std::future<BatchResult<void>> deleteAccessKeysBatchAsync(
+      std::vector<std::string> accessKeyIds, std::size_t maxInFlight = 0);
+  /**
+   * @brief Sets the data limit of each access key, at most maxInFlight at a
+   *        time.
+   * @param limits - the access key ids and their data limits in bytes.
+   * @param maxInFlight - concurrent requests; 0 uses pool.maxPerHost.
+   * @return the outcome of each update, in input order.
+   */
+  std::future<BatchResult<void>> setDataLimitsBatchAsync(
+      std::vector<DataLimitUpdate> limits, std::size_t maxInFlight = 0);
+  /**
+   * @brief Brings the server's access keys to the desired set. Resyncs the
+   *        reconciler's snapshot from /access-keys when it is due, then
+   *        sends only the mutations planned against the snapshot as one
+   *        batch, pipelined when pipelineDepth allows.
+   * @param reconciler - holds the snapshot; must outlive the future and must
+   *        not be reconciled concurrently.
+   * @param desired - every key the server should have.
+   * @param maxInFlight - concurrent requests; 0 uses pool.maxPerHost.
+   * @return the mutations and the outcome of each. The future fails if the
+   *         resync fails or desired has a duplicate id.
+   */
+  std::future<ReconcileReport> reconcileAccessKeysAsync(
+      AccessKeyReconciler& reconciler, std::vector<DesiredAccessKey> desired,
+      std::size_t maxInFlight = 0);
   /**
    * @brief Returns the metrics of the server.
    * @return the metrics of the server.
    */
   std::future<std::string> getMetricsAsync();
+  /**
+   * @brief Returns the response body of /metrics/transfer as received.
+   */
+  std::future<std::string> getMetricsRawAsync();
+  /**
+   * @brief Returns the transferred bytes per access key.
+   */
+  std::future<TransferMetrics> getMetricsTypedAsync();
+  /**
+   * @brief Streams the transferred bytes per access key while the body is
+   *        still arriving, in constant memory.
+   * @param onBytes - called on the client's io thread for every access key.
+   * @return the number of entries.
+   */
+  std::future<std::size_t> streamMetricsAsync(
+      std::function<void(std::string_view, std::uint64_t)> onBytes);
+  /**
+   * @brief Streams /metrics/transfer into the engine and returns the keys
+   *        whose transferred bytes changed since its previous poll.
+   * @param engine - holds the previous snapshot; must outlive the future and
+   *        must not be polled concurrently. After a failed poll the keys
+   *        received so far count as updated.
+   */
+  std::future<MetricsDeltaReport> pollMetricsDeltaAsync(
+      MetricsDeltaEngine& engine);
   /**
    * @details Example: name, serverId, metricsEnabled, createdTimestampMs, version, accessKeyDataLimit, portForNewAccessKeys, hostnameForAccessKeys
    * @brief Returns the information about the server.
    * @return the information about the server.
    */
   std::future<std::string> getServerInformationAsync();
+  /**
+   * @brief Returns the response body of /server as received.
+   */
+  std::future<std::string> getServerInformationRawAsync();
+  /**
+   * @brief Returns the information about the server parsed into ServerInfo.
+   */
+  std::future<ServerInfo> getServerInformationTypedAsync();
   /**
    * @brief Sets the server name.
    */
@@ -150,8 +391,15 @@ class OutlineClient : public std::enable_shared_from_this<OutlineClient> {
   std::future<void> deleteDataLimitForAllAccessKeysAsync();
 
   std::string getAccessKeys();
+  std::string getAccessKeysRaw();
+  std::vector<AccessKey> getAccessKeysTyped();
+  std::size_t streamAccessKeys(std::function<void(AccessKey&&)> onAccessKey);
+  AccessKeySnapshot getAccessKeySnapshot(std::size_t expectedKeys = 0);
   std::string getAccessKey(const std::string& accessKeyId);
+  std::string getAccessKeyRaw(const std::string& accessKeyId);
+  AccessKey getAccessKeyTyped(const std::string& accessKeyId);
   std::string createAccessKey(const CreateAccessKeyParams& params);
+  AccessKey createAccessKeyTyped(const CreateAccessKeyParams& params);
   std::string updateAccessKey(const std::string& accessKeyId,
                               const UpdateAccessKeyParams& params);
   void deleteAccessKey(const std::string& accessKeyId);
@@ -159,8 +407,24 @@ class OutlineClient : public std::enable_shared_from_this<OutlineClient> {
                        const std::string& newName);
   void addDataLimit(const std::string& accessKeyId, int dataLimitBytes);
   void deleteDataLimit(const std::string& accessKeyId);
+  BatchResult<AccessKey> createAccessKeysBatch(
+      std::vector<CreateAccessKeyParams> params, std::size_t maxInFlight = 0);
+  BatchResult<void> deleteAccessKeysBatch(std::vector<std::string> accessKeyIds,
+                                          std::size_t maxInFlight = 0);
+  BatchResult<void> setDataLimitsBatch(std::vector<DataLimitUpdate> limits,
+                                       std::size_t maxInFlight = 0);
+  ReconcileReport reconcileAccessKeys(AccessKeyReconciler& reconciler,
+                                      std::vector<DesiredAccessKey> desired,
+                                      std::size_t maxInFlight = 0);
   std::string getMetrics();
+  std::string getMetricsRaw();
+  TransferMetrics getMetricsTyped();
+  std::size_t streamMetrics(
+      std::function<void(std::string_view, std::uint64_t)> onBytes);
+  MetricsDeltaReport pollMetricsDelta(MetricsDeltaEngine& engine);
   std::string getServerInformation();
+  std::string getServerInformationRaw();
+  ServerInfo getServerInformationTyped();
   bool getMetricsStatus();
   void setMetricsStatus(bool status);
   void setServerName(const std::string& serverName);
@@ -169,25 +433,693 @@ class OutlineClient : public std::enable_shared_from_this<OutlineClient> {
   void setDataLimitForAllAccessKeys(int dataLimitBytes);
   void deleteDataLimitForAllAccessKeys();
 
+  /**
+   * Overloads taking an Asio completion token instead of returning a future,
+   * e.g. boost::asio::use_awaitable inside a coroutine, boost::asio::deferred
+   * or a callback of signature void(std::exception_ptr, T)
+   * (void(std::exception_ptr) for calls without a result). They behave like
+   * the *Async methods above, which are these overloads called with
+   * boost::asio::use_future.
+   */
+  template <typename CompletionToken>
+  auto getAccessKeys(CompletionToken&& token) {
+    return spawn(validateJsonAsync(requestAccessKeysAsync(), "access keys"),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getAccessKeysRaw(CompletionToken&& token) {
+    return spawn(requestAccessKeysAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getAccessKeysTyped(CompletionToken&& token) {
+    return spawn(requestAccessKeysTypedAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto streamAccessKeys(std::function<void(AccessKey&&)> onAccessKey,
+                        CompletionToken&& token) {
+    return spawn(requestStreamAccessKeysAsync(std::move(onAccessKey)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getAccessKeySnapshot(std::size_t expectedKeys, CompletionToken&& token) {
+    return spawn(requestAccessKeySnapshotAsync(expectedKeys),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getAccessKey(std::string accessKeyId, CompletionToken&& token) {
+    return spawn(
+        validateJsonAsync(requestAccessKeyAsync(std::move(accessKeyId)),
+                          "access key"),
+        std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getAccessKeyRaw(std::string accessKeyId, CompletionToken&& token) {
+    return spawn(requestAccessKeyAsync(std::move(accessKeyId)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getAccessKeyTyped(std::string accessKeyId, CompletionToken&& token) {
+    return spawn(requestAccessKeyTypedAsync(std::move(accessKeyId)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto createAccessKey(CreateAccessKeyParams params, CompletionToken&& token) {
+    return spawn(
+        validateJsonAsync(requestCreateAccessKeyAsync(std::move(params)),
+                          "access key creation"),
+        std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto createAccessKeyTyped(CreateAccessKeyParams params,
+                            CompletionToken&& token) {
+    return spawn(requestCreateAccessKeyTypedAsync(std::move(params)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto updateAccessKey(std::string accessKeyId, UpdateAccessKeyParams params,
+                       CompletionToken&& token) {
+    return spawn(
+        requestUpdateAccessKeyAsync(std::move(accessKeyId), std::move(params)),
+        std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto deleteAccessKey(std::string accessKeyId, CompletionToken&& token) {
+    return spawn(requestDeleteAccessKeyAsync(std::move(accessKeyId)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto renameAccessKey(std::string accessKeyId, std::string newName,
+                       CompletionToken&& token) {
+    return spawn(
+        requestRenameAccessKeyAsync(std::move(accessKeyId), std::move(newName)),
+        std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto addDataLimit(std::string accessKeyId, int dataLimitBytes,
+                    CompletionToken&& token) {
+    return spawn(
+        requestAddDataLimitAsync(std::move(accessKeyId), dataLimitBytes),
+        std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto deleteDataLimit(std::string accessKeyId, CompletionToken&& token) {
+    return spawn(requestDeleteDataLimitAsync(std::move(accessKeyId)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getMetrics(CompletionToken&& token) {
+    return spawn(validateJsonAsync(requestMetricsAsync(), "metrics"),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getMetricsRaw(CompletionToken&& token) {
+    return spawn(requestMetricsAsync(), std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getMetricsTyped(CompletionToken&& token) {
+    return spawn(requestMetricsTypedAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto streamMetrics(
+      std::function<void(std::string_view, std::uint64_t)> onBytes,
+      CompletionToken&& token) {
+    return spawn(requestMetricsStreamAsync(std::move(onBytes)),
+                 std::forward<CompletionToken>(token));
+  }
+  /**
+   * @param engine - must outlive the operation.
+   */
+  template <typename CompletionToken>
+  auto pollMetricsDelta(MetricsDeltaEngine& engine, CompletionToken&& token) {
+    return spawn(requestPollMetricsDeltaAsync(engine),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getServerInformation(CompletionToken&& token) {
+    return spawn(validateJsonAsync(requestServerInformationAsync(), "server"),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getServerInformationRaw(CompletionToken&& token) {
+    return spawn(requestServerInformationAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getServerInformationTyped(CompletionToken&& token) {
+    return spawn(requestServerInformationTypedAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto getMetricsStatus(CompletionToken&& token) {
+    return spawn(requestMetricsStatusAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto setMetricsStatus(bool status, CompletionToken&& token) {
+    return spawn(requestSetMetricsStatusAsync(status),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto setServerName(std::string serverName, CompletionToken&& token) {
+    return spawn(requestSetServerNameAsync(std::move(serverName)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto setHostName(std::string hostName, CompletionToken&& token) {
+    return spawn(requestSetHostNameAsync(std::move(hostName)),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto setDefaultPort(int port, CompletionToken&& token) {
+    return spawn(requestSetDefaultPortAsync(port),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto setDataLimitForAllAccessKeys(int dataLimitBytes,
+                                    CompletionToken&& token) {
+    return spawn(requestSetDataLimitForAllAccessKeysAsync(dataLimitBytes),
+                 std::forward<CompletionToken>(token));
+  }
+  template <typename CompletionToken>
+  auto deleteDataLimitForAllAccessKeys(CompletionToken&& token) {
+    return spawn(requestDeleteDataLimitForAllAccessKeysAsync(),
+                 std::forward<CompletionToken>(token));
+  }
+
+  /**
+   * @brief Polls /metrics/transfer in the background and passes every result
+   *        or error to onMetrics. All subscribers share one poll, which runs
+   *        at the shortest interval any of them asked for.
+   * @param onMetrics - called on the client's io thread; must not block.
+   * @return the id for unsubscribe().
+   * @throws OutlineShutdownException after shutdownAsync().
+   */
+  std::uint64_t subscribeMetrics(
+      std::function<void(std::shared_ptr<const TransferMetrics>,
+                         std::exception_ptr)>
+          onMetrics,
+      const network::PollOptions& options = {});
+  /**
+   * @brief Polls /server in the background, like subscribeMetrics().
+   */
+  std::uint64_t subscribeServerInformation(
+      std::function<void(std::shared_ptr<const ServerInfo>,
+                         std::exception_ptr)>
+          onServerInfo,
+      const network::PollOptions& options = {});
+  /**
+   * @brief Ends a subscription. The callback may still run once if a poll
+   *        is finishing.
+   * @return false if the id isn't subscribed.
+   */
+  bool unsubscribe(std::uint64_t subscriptionId);
+
+  /**
+   * @brief Returns the number of resumed and full TLS handshakes.
+   */
+  network::TlsSessionStats getTlsSessionStats() const;
+  /**
+   * @brief Returns the hit and miss counters of the response cache.
+   */
+  network::ResponseCacheStats getCacheStats() const;
+  /**
+   * @brief Drops all cached responses.
+   */
+  void clearCache();
+  /**
+   * @brief Returns the request counters and the per-phase and per-endpoint
+   *        latency histograms; toPrometheus() formats them for scraping.
+   */
+  network::InstrumentationSnapshot getInstrumentation() const;
+
+  /**
+   * @brief Returns the last-known server state without a request: the one
+   *        loaded from options.snapshotCachePath at construction until the
+   *        first refreshSnapshotAsync() completes, then the latest fetched.
+   *        Null if there is none yet.
+   */
+  std::shared_ptr<const ServerSnapshot> cachedSnapshot() const;
+  /**
+   * @brief Fetches /server, /access-keys and /metrics/transfer into a new
+   *        snapshot, makes it the cached one and writes it to the cache
+   *        file, if there is one. The constructor starts one in the
+   *        background when the cache file is set.
+   */
+  std::future<std::shared_ptr<const ServerSnapshot>> refreshSnapshotAsync();
+  std::shared_ptr<const ServerSnapshot> refreshSnapshot();
+  template <typename CompletionToken>
+  auto refreshSnapshot(CompletionToken&& token) {
+    return spawn(requestRefreshSnapshotAsync(),
+                 std::forward<CompletionToken>(token),
+                 network::RequestPriority::Bulk);
+  }
+
+  /**
+   * @brief Shuts the client down gracefully. New calls fail right away with
+   *        OutlineShutdownException and background polls stop. Requests in
+   *        flight get until the deadline to finish; the ones still running
+   *        then fail with OutlineShutdownException, and their connections
+   *        are closed so they finish without waiting for a timeout. Idle
+   *        pooled connections are then closed with a TLS close_notify,
+   *        unless the pool is shared with an OutlineFleet, and the client's
+   *        own io threads are let go so the destructor only joins them.
+   * @param deadline - how long in-flight requests may take to finish.
+   * @return completes once every request has finished; later calls return
+   *         a completed future.
+   */
+  std::future<void> shutdownAsync(
+      std::chrono::milliseconds deadline = std::chrono::seconds(5));
+  void shutdown(std::chrono::milliseconds deadline = std::chrono::seconds(5));
+
  private:
+  friend class OutlineFleet;
+
+  /**
+   * @brief Target of one request and the api::Endpoints template it was
+   *        built from, which keys the latency histograms and names spans.
+   */
+  struct RequestTarget {
+    std::string_view endpoint;
+    std::string target;
+  };
+
   boost::urls::url m_apiUrl;
+  // Path of m_apiUrl, the prefix of every request target, and its encoded
+  // query, which every target ends with.
+  std::string m_basePath;
+  std::string m_baseQuery;
   std::string m_cert;
+  // Parsed m_cert; unset when it is empty and the server isn't checked.
+  std::optional<network::Fingerprint> m_pin;
   int m_timeout;
+  RequestTimeouts m_timeouts;
+  std::size_t m_pipelineDepth;
+  // Set once the server closed a pipelined connection early; later batches
+  // fall back to one request at a time.
+  std::atomic<bool> m_pipeliningRejected{false};
 
-  boost::asio::ssl::context m_sslContext;
-  boost::asio::io_context m_ioContext;
-  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+  std::shared_ptr<boost::asio::ssl::context> m_sslContext;
+  network::Instrumentation m_instrumentation;
+  // Declared before the io_context: coroutine frames destroyed with it may
+  // still hold arena leases.
+  utils::JsonArenaPool m_jsonArenas;
+  // Admits and counts the requests started by spawn(); declared before the
+  // io_context for the same reason.
+  network::ShutdownGate m_shutdown;
+  std::unique_ptr<boost::asio::io_context> m_ioContext;
+  std::optional<
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>
       m_workGuard;
-  std::thread m_ioThread;
+  std::vector<std::thread> m_ioThreads;
+  boost::asio::any_io_executor m_executor;
+  std::shared_ptr<network::ConnectionPool> m_pool;
+  std::shared_ptr<network::TlsSessionCache> m_sessionCache;
+  std::shared_ptr<network::ResolverCache> m_resolverCache;
+  std::shared_ptr<network::CircuitBreaker> m_circuitBreaker;
+  std::shared_ptr<network::RequestLimiter> m_limiter;
+  // The pool, caches and executor belong to an OutlineFleet.
+  bool m_sharedResources = false;
+  network::RetryOptions m_retry;
+  network::RetryBudget m_retryBudget;
+  network::HedgeOptions m_hedge;
+  network::HedgeBudget m_hedgeBudget;
+  bool m_acceptCompression = true;
+  std::string m_userAgent;
+  std::shared_ptr<network::Tracer> m_tracer;
+
+  network::ResponseCache m_cache;
+  // Concurrent GETs of these endpoints share one request.
+  network::SingleFlight<std::string> m_metricsFlight;
+  network::SingleFlight<std::string> m_serverInfoFlight;
+  std::atomic<std::uint64_t> m_nextSubscriptionId{1};
+  std::shared_ptr<network::PeriodicPoller<TransferMetrics>> m_metricsPoller;
+  std::shared_ptr<network::PeriodicPoller<ServerInfo>> m_serverInfoPoller;
+
+  std::string m_snapshotPath;
+  mutable std::mutex m_snapshotMutex;
+  std::shared_ptr<const ServerSnapshot> m_snapshot;
+  // Serializes the writes of the cache file.
+  std::mutex m_snapshotFileMutex;
+
+  /**
+   * @brief Returns a new strand for one request and the connection it uses.
+   *        With fromCaller set, the request joins the caller's active span
+   *        and RequestScope; call it on the caller's thread. The scope's
+   *        priority, if it sets one, overrides priority. The strand
+   *        carries a trace context when a tracer is installed, and a
+   *        request context unless the request is interactive and can't be
+   *        cancelled.
+   * @param cancellation - signal of the call's own, which takes the place
+   *        of the scope's.
+   */
+  boost::asio::any_io_executor makeRequestExecutor(
+      bool fromCaller = true,
+      network::RequestPriority priority =
+          network::RequestPriority::Interactive,
+      std::shared_ptr<network::CancellationSignal> cancellation =
+          nullptr) const;
+  // Completion signature of co_spawn for an awaitable<T>.
+  template <typename T>
+  using SpawnSignature = std::conditional_t<
+      std::is_void_v<T>, void(std::exception_ptr),
+      void(std::exception_ptr, std::conditional_t<std::is_void_v<T>, int, T>)>;
+  /**
+   * @brief Starts op on a new request strand and completes token with its
+   *        result. After shutdownAsync() the token completes with
+   *        OutlineShutdownException instead, off the client's loop, which
+   *        may no longer run.
+   *
+   * A cancellation slot bound to the token, such as the one of an
+   * awaiting coroutine, cancels the call like a RequestScope's signal.
+   * @param priority - class of the call unless the caller's RequestScope
+   *        sets one.
+   */
+  template <typename T, typename CompletionToken>
+  auto spawn(boost::asio::awaitable<T> op, CompletionToken&& token,
+             network::RequestPriority priority =
+                 network::RequestPriority::Interactive) {
+    return boost::asio::async_initiate<CompletionToken, SpawnSignature<T>>(
+        [this, priority](auto handler, boost::asio::awaitable<T> op) {
+          startRequest(std::move(handler), std::move(op), priority);
+        },
+        token, std::move(op));
+  }
+  template <typename T, typename Handler>
+  void startRequest(Handler handler, boost::asio::awaitable<T> op,
+                    network::RequestPriority priority) {
+    auto slot = boost::asio::get_associated_cancellation_slot(handler);
+    // The request answers the slot itself, so co_spawn must not claim it.
+    auto unbound = boost::asio::bind_cancellation_slot(
+        boost::asio::cancellation_slot(), std::move(handler));
+    auto ticket = m_shutdown.admit();
+    if (!ticket) {
+      boost::asio::co_spawn(boost::asio::system_executor(), rejectAsync<T>(),
+                            std::move(unbound));
+      return;
+    }
+    if (!slot.is_connected()) {
+      boost::asio::co_spawn(makeRequestExecutor(true, priority),
+                            trackAsync(std::move(ticket), std::move(op)),
+                            std::move(unbound));
+      return;
+    }
+    // Any cancellation type ends the call; a request can't be paused
+    // part way.
+    auto cancellation = std::make_shared<network::CancellationSignal>();
+    slot.assign([cancellation](boost::asio::cancellation_type type) {
+      if (type != boost::asio::cancellation_type::none)
+        cancellation->emit();
+    });
+    const auto* scope = network::RequestContext::active();
+    auto scoped = scope ? scope->cancellation : nullptr;
+    boost::asio::co_spawn(
+        makeRequestExecutor(true, priority, cancellation),
+        trackAsync(std::move(ticket),
+                   scoped ? forwardCancellationAsync(std::move(scoped),
+                                                     std::move(cancellation),
+                                                     std::move(op))
+                          : std::move(op)),
+        std::move(unbound));
+  }
+  /**
+   * @brief Runs op with to emitted once from is, so the caller's
+   *        RequestScope still cancels a call with a signal of its own.
+   */
+  template <typename T>
+  static boost::asio::awaitable<T> forwardCancellationAsync(
+      std::shared_ptr<network::CancellationSignal> from,
+      std::shared_ptr<network::CancellationSignal> to,
+      boost::asio::awaitable<T> op) {
+    auto forward = from->connect(co_await boost::asio::this_coro::executor,
+                                 [to]() { to->emit(); });
+    co_return co_await std::move(op);
+  }
+  /**
+   * @brief Work run apart from any caller, such as the fetch of a
+   *        background poll or of a shared flight, counted like a call of
+   *        spawn(). The poller creates it under its lock, so no fetch is
+   *        admitted once the poller is stopped.
+   */
+  template <typename T>
+  boost::asio::awaitable<T> backgroundAsync(boost::asio::awaitable<T> op) {
+    auto ticket = m_shutdown.admit();
+    if (!ticket)
+      return rejectAsync<T>();
+    return trackAsync(std::move(ticket), std::move(op));
+  }
+  /**
+   * @brief Runs op as one of the requests the shutdown drains; the ticket
+   *        counts it until the frame is gone. A request cancelled at the
+   *        deadline fails with OutlineShutdownException, and one whose
+   *        signal was emitted with OutlineCancelledException, whatever
+   *        error its closed connection caused.
+   */
+  template <typename T>
+  boost::asio::awaitable<T> trackAsync(network::ShutdownGate::Ticket ticket,
+                                       boost::asio::awaitable<T> op) {
+    const auto* context = network::RequestContext::active();
+    if (context && context->cancelled())
+      throw OutlineCancelledException("Request cancelled");
+    try {
+      co_return co_await std::move(op);
+    } catch (...) {
+      if (!m_shutdown.cancelled() && !(context && context->cancelled()))
+        throw;
+    }
+    if (m_shutdown.cancelled()) {
+      throw OutlineShutdownException(
+          "Request cancelled at the shutdown deadline");
+    }
+    throw OutlineCancelledException("Request cancelled");
+  }
+  template <typename T>
+  static boost::asio::awaitable<T> rejectAsync() {
+    co_await boost::asio::this_coro::executor;
+    throw OutlineShutdownException("Client is shut down");
+  }
+  boost::asio::awaitable<void> requestShutdownAsync(
+      std::chrono::steady_clock::time_point deadline);
+
+  boost::asio::awaitable<void> connectAsync(network::PooledConnection& conn,
+                                            const std::string& host,
+                                            const std::string& port);
+  boost::asio::awaitable<void> handshakeAsync(network::PooledConnection& conn);
+  boost::asio::awaitable<network::ConnectionLease> leaseConnectionAsync(
+      const std::string& host, const std::string& port);
+  boost::asio::awaitable<boost::system::error_code> writeRequestAsync(
+      network::PooledConnection& conn,
+      boost::beast::http::request<boost::beast::http::string_body>& req);
+  // Reads one response into parser with the read timeout applied.
+  boost::asio::awaitable<boost::system::error_code> readResponseAsync(
+      network::PooledConnection& conn,
+      boost::beast::http::response_parser<network::DecodingBody>& parser);
+  /**
+   * @brief Sets the headers every request to the host carries.
+   * @param statusOnly - the body of the response will be dropped, so no
+   *        compression is asked for.
+   */
+  void prepareRequest(
+      boost::beast::http::request<boost::beast::http::string_body>& req,
+      const std::string& host, bool statusOnly = false) const;
+  /**
+   * @param statusOnly - drop the response body as it is read and return an
+   *        empty one.
+   */
+  boost::asio::awaitable<std::pair<int, std::string>> sendAsync(
+      boost::beast::http::request<boost::beast::http::string_body>& req,
+      bool statusOnly = false);
+  /**
+   * @brief Waits for the limiter to let a request to the host ("host:port")
+   *        start. The wait is bounded by the connect timeout.
+   */
+  boost::asio::awaitable<network::RequestLimiter::Permit>
+  acquireRequestSlotAsync(const std::string& key);
+  /**
+   * @brief sendAsync() with the retry policy and circuit breaker applied.
+   */
+  boost::asio::awaitable<std::pair<int, std::string>> sendWithRetryAsync(
+      boost::beast::http::request<boost::beast::http::string_body>& req,
+      bool statusOnly = false);
+  // Attempts of one hedged request; lives on the request's strand.
+  struct HedgeRace;
+  /**
+   * @brief sendWithRetryAsync() of a GET, hedged once the endpoint's latency
+   *        percentile passed without an answer and the hedge budget allows.
+   */
+  boost::asio::awaitable<std::pair<int, std::string>> sendHedgedAsync(
+      boost::beast::http::request<boost::beast::http::string_body>& req,
+      std::string_view endpoint);
+  /**
+   * @brief Starts one attempt of the race on its own cancellation signal, as
+   *        a request the shutdown drains.
+   * @return false if the client is shutting down.
+   */
+  bool startHedgeAttempt(
+      const std::shared_ptr<HedgeRace>& race,
+      boost::beast::http::request<boost::beast::http::string_body> req);
+  /**
+   * @brief Writes the idempotent requests back-to-back on one connection and
+   *        returns their statuses in order; the bodies are dropped. Requests
+   *        left unanswered when the server closes the connection are sent
+   *        again one at a time, and pipelining is turned off for the client.
+   */
+  boost::asio::awaitable<std::vector<std::pair<int, std::string>>>
+  sendPipelinedAsync(
+      std::vector<boost::beast::http::request<boost::beast::http::string_body>>&
+          reqs);
+  /**
+   * @brief GETs the target and passes a 200 response body to onChunk piece
+   *        by piece as it arrives. Returns the status code.
+   */
+  boost::asio::awaitable<int> doGetStreamingAsync(
+      RequestTarget target,
+      const std::function<void(std::string_view)>& onChunk);
+  // Checks and feeds the circuit breaker around streamOnceAsync(). Not
+  // retried: part of the body may already be with the caller.
+  boost::asio::awaitable<int> sendStreamingAsync(
+      std::string_view target,
+      const std::function<void(std::string_view)>& onChunk);
+  boost::asio::awaitable<int> streamOnceAsync(
+      std::string_view target,
+      const std::function<void(std::string_view)>& onChunk);
+
+  /**
+   * @brief Serves the body cached under key or fetches and caches it.
+   */
+  boost::asio::awaitable<std::shared_ptr<const std::string>> cachedGetAsync(
+      std::string key,
+      std::function<boost::asio::awaitable<network::ResponseCache::Body>()>
+          fetch);
+  // Drops the cached key and key list after a change to the key.
+  void invalidateAccessKey(const std::string& accessKeyId);
+
+  // Fetch the endpoint, check the status and return the body untouched.
+  boost::asio::awaitable<std::shared_ptr<const std::string>>
+  requestAccessKeysSharedAsync();
+  boost::asio::awaitable<std::string> requestAccessKeysAsync();
+  boost::asio::awaitable<std::string> requestAccessKeyAsync(
+      std::string accessKeyId);
+  boost::asio::awaitable<std::string> requestCreateAccessKeyAsync(
+      CreateAccessKeyParams params);
+  boost::asio::awaitable<void> requestDeleteAccessKeyAsync(
+      std::string accessKeyId);
+  boost::asio::awaitable<void> requestAddDataLimitAsync(std::string accessKeyId,
+                                                        int dataLimitBytes);
+  boost::asio::awaitable<std::string> requestMetricsAsync();
+  // Coalesce concurrent callers into one fetch run by fetch*BodyAsync().
+  boost::asio::awaitable<std::shared_ptr<const std::string>>
+  requestMetricsSharedAsync();
+  boost::asio::awaitable<std::string> fetchMetricsBodyAsync();
+  // Streams /metrics/transfer; returns the number of entries.
+  boost::asio::awaitable<std::size_t> requestMetricsStreamAsync(
+      std::function<void(std::string_view, std::uint64_t)> onBytes);
+  boost::asio::awaitable<std::string> requestServerInformationAsync();
+  boost::asio::awaitable<std::shared_ptr<const std::string>>
+  requestServerInformationSharedAsync();
+  boost::asio::awaitable<std::string> fetchServerInformationBodyAsync();
+  // Fetch and parse into the typed models.
+  boost::asio::awaitable<std::vector<AccessKey>> requestAccessKeysTypedAsync();
+  boost::asio::awaitable<TransferMetrics> requestMetricsTypedAsync();
+  boost::asio::awaitable<ServerInfo> requestServerInformationTypedAsync();
+  boost::asio::awaitable<AccessKey> requestAccessKeyTypedAsync(
+      std::string accessKeyId);
+  boost::asio::awaitable<AccessKey> requestCreateAccessKeyTypedAsync(
+      CreateAccessKeyParams params);
+  // Awaits body and checks that it is valid JSON before returning it.
+  boost::asio::awaitable<std::string> validateJsonAsync(
+      boost::asio::awaitable<std::string> body, const char* what);
+
+  // The remaining calls, one coroutine each.
+  boost::asio::awaitable<std::size_t> requestStreamAccessKeysAsync(
+      std::function<void(AccessKey&&)> onAccessKey);
+  boost::asio::awaitable<AccessKeySnapshot> requestAccessKeySnapshotAsync(
+      std::size_t expectedKeys);
+  boost::asio::awaitable<std::shared_ptr<const ServerSnapshot>>
+  requestRefreshSnapshotAsync();
+  boost::asio::awaitable<std::string> requestUpdateAccessKeyAsync(
+      std::string accessKeyId, UpdateAccessKeyParams params);
+  boost::asio::awaitable<void> requestRenameAccessKeyAsync(
+      std::string accessKeyId, std::string newName);
+  boost::asio::awaitable<void> requestDeleteDataLimitAsync(
+      std::string accessKeyId);
+  boost::asio::awaitable<MetricsDeltaReport> requestPollMetricsDeltaAsync(
+      MetricsDeltaEngine& engine);
+  boost::asio::awaitable<bool> requestMetricsStatusAsync();
+  boost::asio::awaitable<void> requestSetMetricsStatusAsync(bool status);
+  boost::asio::awaitable<void> requestSetServerNameAsync(
+      std::string serverName);
+  boost::asio::awaitable<void> requestSetHostNameAsync(std::string hostName);
+  boost::asio::awaitable<void> requestSetDefaultPortAsync(int port);
+  boost::asio::awaitable<void> requestSetDataLimitForAllAccessKeysAsync(
+      int dataLimitBytes);
+  boost::asio::awaitable<void> requestDeleteDataLimitForAllAccessKeysAsync();
+
+  boost::asio::awaitable<ReconcileReport> requestReconcileAsync(
+      AccessKeyReconciler& reconciler, std::vector<DesiredAccessKey> desired,
+      std::size_t maxInFlight);
+  /**
+   * @brief Sends the mutations as one batch, pipelined if enabled.
+   */
+  boost::asio::awaitable<BatchResult<void>> requestMutationsAsync(
+      std::vector<AccessKeyMutation> mutations, std::size_t maxInFlight);
+
+  /**
+   * @brief Runs item(i) for every i below count with at most maxInFlight
+   *        items in progress and resumes with all outcomes once the last
+   *        item has finished.
+   */
+  template <typename T, typename Item>
+  boost::asio::awaitable<BatchResult<T>> runBatchAsync(std::size_t count,
+                                                       std::size_t maxInFlight,
+                                                       Item item);
+  /**
+   * @brief Like runBatchAsync for calls without a result, but every worker
+   *        takes m_pipelineDepth items at a time and pipelines the requests
+   *        built by makeCall(i).
+   */
+  template <typename MakeCall>
+  boost::asio::awaitable<BatchResult<void>> runPipelinedBatchAsync(
+      std::size_t count, std::size_t maxInFlight, MakeCall makeCall);
+
+  static boost::beast::http::request<boost::beast::http::string_body>
+  makeRequest(boost::beast::http::verb verb, std::string_view target,
+              std::string body = {});
 
+  /**
+   * @brief Returns the request target of the endpoint with the values in
+   *        place of its parameters, e.g. targetOf<Endpoints::DeleteAccessKey>(
+   *        accessKeyId).
+   */
+  template <const std::string_view& Endpoint, typename... Values>
+  RequestTarget targetOf(const Values&... values) const {
+    return {Endpoint, utils::buildTarget<Endpoint>(targetBase(), values...)};
+  }
+  utils::TargetBase targetBase() const { return {m_basePath, m_baseQuery}; }
+
+  /**
+   * @brief The one request path behind the verbs below: builds the request,
+   *        applies the limiter, retries and circuit breaker, records the
+   *        outcome and returns the status and body.
+   */
+  template <boost::beast::http::verb Verb>
+  boost::asio::awaitable<std::pair<int, std::string>> doRequestAsync(
+      RequestTarget target, std::string body = {}, bool statusOnly = false);
   boost::asio::awaitable<std::pair<int, std::string>> doGetAsync(
-      const boost::urls::url& url);
+      RequestTarget target);
   boost::asio::awaitable<std::pair<int, std::string>> doPostAsync(
-      const boost::urls::url& url, const std::string& body);
+      RequestTarget target, std::string body);
   boost::asio::awaitable<std::pair<int, std::string>> doPutAsync(
-      const boost::urls::url& url, const std::string& body);
+      RequestTarget target, std::string body);
   boost::asio::awaitable<std::pair<int, std::string>> doDeleteAsync(
-      const boost::urls::url& url);
+      RequestTarget target);
+  // Calls whose response body is never looked at: it is dropped as it is
+  // read and only the status is returned.
+  boost::asio::awaitable<int> doPutStatusAsync(RequestTarget target,
+                                               std::string body);
+  boost::asio::awaitable<int> doDeleteStatusAsync(RequestTarget target);
 };
 
 }  // namespace outline
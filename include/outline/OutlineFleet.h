@@ -0,0 +1,142 @@
+#ifndef OUTLINEFLEET_H
+#define OUTLINEFLEET_H
+
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include "outline/OutlineClient.h"
+#include "outline/models/BatchResult.h"
+#include "outline/network/ShutdownGate.h"
+
+namespace outline {
+
+/**
+ * @brief Outcome of a fan-out call on one server of the fleet.
+ */
+template <typename T>
+struct FleetResult : BatchItemResult<T> {
+  // The API URL the server was added with.
+  std::string server;
+};
+
+/**
+ * @brief Manages clients of many Outline servers on one event loop.
+ *
+ * All clients share the fleet's executor, TLS context, connection pool, TLS
+ * session cache and resolver cache, so adding a server costs no thread and
+ * no CA store load. Clients must not be used after the fleet is destroyed;
+ * release every one handed out before that.
+ */
+class OutlineFleet {
+ public:
+  /**
+   * @brief options - applied to every client; pool limits are per host.
+   */
+  explicit OutlineFleet(const OutlineClientOptions& options = {});
+
+  /**
+   * @brief Destructor. Fails the requests of every client still in flight,
+   *        waits for them and destroys the clients while the loop runs;
+   *        then stops the own io_context and joins its threads.
+   */
+  ~OutlineFleet();
+
+  OutlineFleet(const OutlineFleet&) = delete;
+  OutlineFleet& operator=(const OutlineFleet&) = delete;
+
+  /**
+   * @brief Adds a server, or returns its client if it was already added.
+   * @param apiUrl - url for server API, also the server's name in the fleet.
+   * @param cert - certificate after apiUrl.
+   * @param timeout - request timeout in seconds, applied to every phase.
+   */
+  std::shared_ptr<OutlineClient> addServer(std::string_view apiUrl,
+                                           std::string_view cert,
+                                           int timeout = 5);
+  /**
+   * @brief Removes a server. Requests already started keep its client alive.
+   * @return false if the server wasn't in the fleet.
+   */
+  bool removeServer(std::string_view apiUrl);
+  /**
+   * @brief Returns the client of a server, or nullptr.
+   */
+  std::shared_ptr<OutlineClient> server(std::string_view apiUrl) const;
+  /**
+   * @brief Returns the API URLs of all servers.
+   */
+  std::vector<std::string> servers() const;
+  std::size_t size() const;
+
+  /**
+   * @brief Fetches the metrics of every server concurrently.
+   * @param onResult - called once per server as soon as its request finishes,
+   *        never concurrently with itself, on one of the fleet's io threads.
+   * @return the number of servers, once all of them have finished. Exceptions
+   *         thrown by onResult are rethrown here.
+   */
+  std::future<std::size_t> getMetricsAllAsync(
+      std::function<void(FleetResult<TransferMetrics>&&)> onResult);
+  /**
+   * @brief Fetches the information of every server concurrently.
+   * @param onResult - called once per server as its request finishes.
+   */
+  std::future<std::size_t> getServerInformationAllAsync(
+      std::function<void(FleetResult<ServerInfo>&&)> onResult);
+  /**
+   * @brief Fetches the access keys of every server concurrently.
+   * @param onResult - called once per server as its request finishes.
+   */
+  std::future<std::size_t> getAccessKeysAllAsync(
+      std::function<void(FleetResult<std::vector<AccessKey>>&&)> onResult);
+
+  std::size_t getMetricsAll(
+      std::function<void(FleetResult<TransferMetrics>&&)> onResult);
+  std::size_t getServerInformationAll(
+      std::function<void(FleetResult<ServerInfo>&&)> onResult);
+  std::size_t getAccessKeysAll(
+      std::function<void(FleetResult<std::vector<AccessKey>>&&)> onResult);
+
+  /**
+   * @brief Returns the number of resumed and full TLS handshakes of all
+   *        servers.
+   */
+  network::TlsSessionStats getTlsSessionStats() const;
+
+ private:
+  OutlineClientOptions m_options;
+  std::unique_ptr<boost::asio::io_context> m_ioContext;
+  std::optional<
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>
+      m_workGuard;
+  std::vector<std::thread> m_ioThreads;
+  OutlineClientResources m_resources;
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, std::shared_ptr<OutlineClient>, std::less<>> m_clients;
+  // Counts the fan-out workers until they have released their client.
+  network::ShutdownGate m_fanOuts;
+
+  /**
+   * @brief Runs call on every client at once and reports each outcome.
+   */
+  template <typename T>
+  std::future<std::size_t> fanOutAsync(
+      std::function<boost::asio::awaitable<T>(OutlineClient&)> call,
+      std::function<void(FleetResult<T>&&)> onResult);
+};
+
+}  // namespace outline
+
+#endif  // OUTLINEFLEET_H
@@ -0,0 +1,69 @@
+#ifndef OUTLINE_SNAPSHOT_FILE_H
+#define OUTLINE_SNAPSHOT_FILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "outline/AccessKeySnapshot.h"
+#include "outline/MetricsDeltaEngine.h"
+#include "outline/models/ServerInfo.h"
+
+namespace outline {
+
+/**
+ * @brief Last-known state of a server: its information, access keys and
+ *        the transferred bytes of each key.
+ */
+struct ServerSnapshot {
+  // When the state was fetched from the server.
+  std::chrono::system_clock::time_point fetchedAt;
+  ServerInfo serverInfo;
+  // The bytes column is the metrics baseline.
+  AccessKeySnapshot accessKeys;
+
+  /**
+   * @brief Records the bytes as the engine's previous poll, taken at
+   *        fetchedAt, so the engine's next poll reports deltas instead of a
+   *        baseline.
+   */
+  void seedMetrics(MetricsDeltaEngine& engine) const;
+};
+
+/**
+ * @brief Versioned binary file holding a ServerSnapshot.
+ *
+ * A fixed header is followed by the snapshot's columns as raw arrays, each
+ * 8-byte aligned, so the file is mapped and every column is read with a
+ * single copy; nothing is parsed. The file is written to a temporary name
+ * and renamed over the old one, so a crash never leaves a torn file.
+ */
+class SnapshotFile {
+ public:
+  // Bumped on every change of the layout; files of another version are
+  // ignored.
+  static constexpr std::uint32_t kVersion = 1;
+
+  /**
+   * @brief Writes the snapshot to path.
+   * @param source - identifies the server, e.g. its API URL; stored as a
+   *        hash only.
+   * @throws std::runtime_error if the file can't be written.
+   */
+  static void save(const std::string& path, std::string_view source,
+                   const ServerSnapshot& snapshot);
+  /**
+   * @brief Reads the snapshot saved at path for the source.
+   * @return nothing if there is no file, or it is of another version, byte
+   *         order or source.
+   * @throws OutlineParseException if the file is truncated or corrupt.
+   */
+  static std::optional<ServerSnapshot> load(const std::string& path,
+                                            std::string_view source);
+};
+
+}  // namespace outline
+
+#endif  // OUTLINE_SNAPSHOT_FILE_H
@@ -24,6 +24,27 @@ class OutlineNetworkException : public OutlineException {
       : OutlineException("Network Error: " + message) {}
 };
 
+/**
+ * @brief Исключение, которое говорит о том, что запросы к хосту временно не отправляются
+ *        из-за серии ошибок (сработал circuit breaker).
+ */
+class OutlineCircuitOpenException : public OutlineNetworkException {
+ public:
+  explicit OutlineCircuitOpenException(const std::string& host)
+      : OutlineNetworkException("Circuit open for " + host) {}
+};
+
+/**
+ * @brief Исключение, которое говорит о том, что сертификат сервера не совпал
+ *        с закреплённым отпечатком (certSha256).
+ */
+class OutlineCertificateException : public OutlineNetworkException {
+ public:
+  explicit OutlineCertificateException(const std::string& host)
+      : OutlineNetworkException("Certificate of " + host +
+                                " does not match the pinned fingerprint") {}
+};
+
 /**
  * @brief Исключение, которое говорит о превышении времени ожидания (таймаут).
  */
@@ -52,6 +73,26 @@ class OutlineServerErrorException : public OutlineException {
       : OutlineException("Server Error: " + message) {}
 };
 
+/**
+ * @brief Исключение, которое говорит о том, что клиент остановлен: запрос
+ *        отклонён после shutdownAsync() или отменён по истечении его срока.
+ */
+class OutlineShutdownException : public OutlineException {
+ public:
+  explicit OutlineShutdownException(const std::string& message)
+      : OutlineException("Shutdown: " + message) {}
+};
+
+/**
+ * @brief Исключение, которое говорит о том, что запрос отменён через
+ *        CancellationSignal своего RequestScope.
+ */
+class OutlineCancelledException : public OutlineException {
+ public:
+  explicit OutlineCancelledException(const std::string& message)
+      : OutlineException("Cancelled: " + message) {}
+};
+
 }  // namespace outline
 
 #endif  // OUTLINE_EXCEPTIONS_H
@@ -0,0 +1,31 @@
+#ifndef OUTLINE_MODELS_ACCESS_KEY_H
+#define OUTLINE_MODELS_ACCESS_KEY_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <boost/json/fwd.hpp>
+#include <boost/json/value_to.hpp>
+
+namespace outline {
+
+/**
+ * @brief Access key as returned by /access-keys.
+ */
+struct AccessKey {
+  std::string id;
+  std::string name;
+  std::string password;
+  int port = 0;
+  std::string method;
+  std::string accessUrl;
+  std::optional<std::int64_t> dataLimitBytes;
+};
+
+AccessKey tag_invoke(boost::json::value_to_tag<AccessKey>,
+                     const boost::json::value& jv);
+
+}  // namespace outline
+
+#endif  // OUTLINE_MODELS_ACCESS_KEY_H
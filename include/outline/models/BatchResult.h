@@ -0,0 +1,58 @@
+#ifndef OUTLINE_MODELS_BATCH_RESULT_H
+#define OUTLINE_MODELS_BATCH_RESULT_H
+
+#include <exception>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace outline {
+
+/**
+ * @brief Outcome of one item of a batch call: its value or the exception it
+ *        failed with.
+ */
+template <typename T>
+struct BatchItemResult {
+  std::optional<T> value;
+  std::exception_ptr error;
+
+  bool ok() const { return !error; }
+  /**
+   * @brief Returns the value or rethrows the item's exception.
+   */
+  const T& get() const {
+    if (error)
+      std::rethrow_exception(error);
+    return *value;
+  }
+};
+
+template <>
+struct BatchItemResult<void> {
+  std::exception_ptr error;
+
+  bool ok() const { return !error; }
+  void get() const {
+    if (error)
+      std::rethrow_exception(error);
+  }
+};
+
+/**
+ * @brief Per-item results of a batch call, in the order of its input.
+ */
+template <typename T>
+using BatchResult = std::vector<BatchItemResult<T>>;
+
+/**
+ * @brief One entry of setDataLimitsBatch.
+ */
+struct DataLimitUpdate {
+  std::string accessKeyId;
+  int dataLimitBytes = 0;
+};
+
+}  // namespace outline
+
+#endif  // OUTLINE_MODELS_BATCH_RESULT_H
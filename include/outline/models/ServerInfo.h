@@ -0,0 +1,32 @@
+#ifndef OUTLINE_MODELS_SERVER_INFO_H
+#define OUTLINE_MODELS_SERVER_INFO_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <boost/json/fwd.hpp>
+#include <boost/json/value_to.hpp>
+
+namespace outline {
+
+/**
+ * @brief Server information as returned by /server.
+ */
+struct ServerInfo {
+  std::string name;
+  std::string serverId;
+  bool metricsEnabled = false;
+  std::int64_t createdTimestampMs = 0;
+  std::string version;
+  std::optional<std::int64_t> accessKeyDataLimitBytes;
+  std::optional<int> portForNewAccessKeys;
+  std::string hostnameForAccessKeys;
+};
+
+ServerInfo tag_invoke(boost::json::value_to_tag<ServerInfo>,
+                      const boost::json::value& jv);
+
+}  // namespace outline
+
+#endif  // OUTLINE_MODELS_SERVER_INFO_H
@@ -0,0 +1,25 @@
+#ifndef OUTLINE_MODELS_TRANSFER_METRICS_H
+#define OUTLINE_MODELS_TRANSFER_METRICS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include <boost/json/fwd.hpp>
+#include <boost/json/value_to.hpp>
+
+namespace outline {
+
+/**
+ * @brief Transferred bytes per access key as returned by /metrics/transfer.
+ */
+struct TransferMetrics {
+  std::unordered_map<std::string, std::uint64_t> bytesTransferredByUserId;
+};
+
+TransferMetrics tag_invoke(boost::json::value_to_tag<TransferMetrics>,
+                           const boost::json::value& jv);
+
+}  // namespace outline
+
+#endif  // OUTLINE_MODELS_TRANSFER_METRICS_H
@@ -0,0 +1,88 @@
+#ifndef OUTLINE_NETWORK_CANCELLATION_SIGNAL_H
+#define OUTLINE_NETWORK_CANCELLATION_SIGNAL_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/asio.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief One-shot cancellation shared by whoever cancels and the operations
+ *        that should stop.
+ *
+ * Operations connect() a handler that makes them fail fast, such as closing
+ * their socket or waking their timer. emit() runs every connected handler,
+ * each on its own executor; the signal stays emitted, so handlers connected
+ * later run right away. Thread safe.
+ */
+class CancellationSignal {
+ public:
+  /**
+   * @brief Keeps a handler connected while it lives. Must be destroyed on
+   *        the executor the handler was connected with.
+   */
+  class Slot {
+   public:
+    Slot() = default;
+    Slot(Slot&& other) noexcept;
+    Slot& operator=(Slot&& other) noexcept;
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+    ~Slot();
+
+   private:
+    friend class CancellationSignal;
+
+    Slot(CancellationSignal* signal, std::uint64_t id);
+    void reset();
+
+    CancellationSignal* m_signal = nullptr;
+    std::uint64_t m_id = 0;
+  };
+
+  CancellationSignal() = default;
+  CancellationSignal(const CancellationSignal&) = delete;
+  CancellationSignal& operator=(const CancellationSignal&) = delete;
+
+  /**
+   * @brief Runs every connected handler and every one connected later.
+   */
+  void emit();
+  bool emitted() const;
+
+  /**
+   * @brief Connects handler to run on the executor when emit() is called,
+   *        right away if it has been called already.
+   */
+  Slot connect(const boost::asio::any_io_executor& executor,
+               std::function<void()> handler);
+
+ private:
+  struct Handler {
+    explicit Handler(boost::asio::any_io_executor executor)
+        : executor(std::move(executor)) {}
+
+    boost::asio::any_io_executor executor;
+    std::function<void()> run;
+    bool active = true;
+  };
+
+  static void post(std::shared_ptr<Handler> handler);
+  void disconnect(std::uint64_t id);
+
+  mutable std::mutex m_mutex;
+  bool m_emitted = false;
+  std::uint64_t m_nextId = 1;
+  std::unordered_map<std::uint64_t, std::shared_ptr<Handler>> m_handlers;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_CANCELLATION_SIGNAL_H
@@ -0,0 +1,53 @@
+#ifndef OUTLINE_NETWORK_CERTIFICATE_PIN_H
+#define OUTLINE_NETWORK_CERTIFICATE_PIN_H
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief SHA-256 of a certificate in DER form, like Outline's certSha256.
+ */
+using Fingerprint = std::array<unsigned char, 32>;
+
+/**
+ * @brief Parses a fingerprint written in hex. Case doesn't matter and
+ *        colons or spaces between the digits are ignored.
+ * @return nothing if it isn't 32 bytes of hex.
+ */
+std::optional<Fingerprint> parseFingerprint(std::string_view hex);
+
+/**
+ * @brief Returns the fingerprint in upper-case hex without separators.
+ */
+std::string toHex(const Fingerprint& fingerprint);
+
+/**
+ * @brief Returns the fingerprint of the certificate the server presented on
+ *        the connection, also when its session was resumed; nothing if it
+ *        presented none.
+ */
+std::optional<Fingerprint> peerFingerprint(SSL* ssl);
+
+/**
+ * @brief Makes the stream's handshakes accept only a leaf certificate with
+ *        the pinned fingerprint. The chain is not checked against any CA
+ *        store, so self-signed certificates like Outline's pass.
+ * @param seen - receives the fingerprint of the leaf the server presented;
+ *        must outlive the stream's handshakes.
+ */
+void pinCertificate(
+    boost::asio::ssl::stream<boost::asio::ip::tcp::socket>& stream,
+    const Fingerprint& pin, std::optional<Fingerprint>& seen);
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_CERTIFICATE_PIN_H
@@ -0,0 +1,190 @@
+#ifndef OUTLINE_NETWORK_CONNECTION_POOL_H
+#define OUTLINE_NETWORK_CONNECTION_POOL_H
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include "outline/network/CertificatePin.h"
+#include "outline/network/RequestContext.h"
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Limits of the keep-alive connection pool.
+ */
+struct ConnectionPoolOptions {
+  // Maximum number of idle keep-alive connections kept per host.
+  std::size_t maxIdlePerHost = 4;
+  // Maximum number of open (idle and in use) connections per host.
+  std::size_t maxPerHost = 16;
+  // Idle connections older than this are closed instead of being reused.
+  std::chrono::seconds idleTimeout{30};
+};
+
+/**
+ * @brief TLS connection owned by the pool together with its read buffer.
+ */
+struct PooledConnection {
+  PooledConnection(const boost::asio::any_io_executor& executor,
+                   boost::asio::ssl::context& sslContext)
+      : stream(executor, sslContext) {}
+
+  boost::asio::ssl::stream<boost::asio::ip::tcp::socket> stream;
+  boost::beast::flat_buffer buffer;
+  // "host:port" the connection belongs to.
+  std::string key;
+  std::chrono::steady_clock::time_point lastUsed;
+  bool connected = false;
+  // Certificate the server presented, checked by the handshake of a client
+  // that pins one; kept for the connection's lifetime.
+  std::optional<Fingerprint> peerFingerprint;
+};
+
+class ConnectionPool;
+
+/**
+ * @brief Exclusive handle on a pooled connection.
+ *
+ * The connection goes back to the pool when the lease is destroyed, but only
+ * if markReusable() was called; otherwise it is closed and its slot is freed.
+ */
+class ConnectionLease {
+ public:
+  ConnectionLease() = default;
+  ConnectionLease(ConnectionLease&& other) noexcept;
+  ConnectionLease& operator=(ConnectionLease&& other) noexcept;
+  ConnectionLease(const ConnectionLease&) = delete;
+  ConnectionLease& operator=(const ConnectionLease&) = delete;
+  ~ConnectionLease();
+
+  PooledConnection* operator->() const { return m_connection.get(); }
+  PooledConnection& operator*() const { return *m_connection; }
+
+  /**
+   * @brief Returns true if the connection was taken from the idle list.
+   */
+  bool reused() const { return m_reused; }
+  /**
+   * @brief Allows the connection to be kept alive after the lease ends.
+   */
+  void markReusable() { m_reusable = true; }
+  /**
+   * @brief Gives the connection back to the pool right away.
+   */
+  void release();
+
+ private:
+  friend class ConnectionPool;
+
+  ConnectionLease(std::shared_ptr<ConnectionPool> pool, std::string key,
+                  std::unique_ptr<PooledConnection> connection, bool reused);
+
+  std::shared_ptr<ConnectionPool> m_pool;
+  std::string m_key;
+  std::unique_ptr<PooledConnection> m_connection;
+  bool m_reused = false;
+  bool m_reusable = false;
+};
+
+/**
+ * @brief Per-host pool of idle keep-alive TLS connections.
+ *
+ * Keys are "host:port" strings. The pool is thread safe; connections handed
+ * out by acquireAsync() are used by a single coroutine at a time.
+ */
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool> {
+ public:
+  static std::shared_ptr<ConnectionPool> create(
+      const ConnectionPoolOptions& options = {}) {
+    return std::shared_ptr<ConnectionPool>(new ConnectionPool(options));
+  }
+
+  /**
+   * @brief Returns an idle connection that is still alive or a fresh,
+   *        not yet connected one. Waits while the host is at maxPerHost,
+   *        queued by the request's priority.
+   * @param key - the "host:port" key of the connection.
+   * @param sslContext - the context used for new connections.
+   * @param timeout - limit for the wait, fails with error::timed_out.
+   * @param context - priority and cancellation of the request, null for
+   *        an interactive one; a cancelled wait fails with
+   *        error::operation_aborted.
+   */
+  boost::asio::awaitable<ConnectionLease> acquireAsync(
+      const std::string& key, boost::asio::ssl::context& sslContext,
+      std::chrono::steady_clock::duration timeout,
+      const RequestContext* context = nullptr);
+
+  /**
+   * @brief Closes all idle connections.
+   */
+  void clear();
+  /**
+   * @brief Closes all idle connections like clear(), but first sends each a
+   *        TLS close_notify, waiting up to timeout for the peers to answer.
+   */
+  boost::asio::awaitable<void> closeAsync(
+      std::chrono::steady_clock::duration timeout);
+
+  /**
+   * @brief Returns the number of idle connections for the key.
+   */
+  std::size_t idleCount(const std::string& key) const;
+
+  const ConnectionPoolOptions& options() const { return m_options; }
+
+ private:
+  friend class ConnectionLease;
+
+  struct Waiter {
+    Waiter(const boost::asio::any_io_executor& executor,
+           RequestPriority priority)
+        : timer(executor), priority(priority) {}
+
+    boost::asio::steady_timer timer;
+    RequestPriority priority;
+    bool granted = false;
+    std::unique_ptr<PooledConnection> connection;
+  };
+
+  struct HostState {
+    std::vector<std::unique_ptr<PooledConnection>> idle;
+    std::size_t open = 0;
+    std::deque<std::shared_ptr<Waiter>> waiters;
+  };
+
+  explicit ConnectionPool(const ConnectionPoolOptions& options);
+
+  void release(const std::string& key,
+               std::unique_ptr<PooledConnection> connection, bool reusable);
+  void freeSlotLocked(HostState& host);
+  static void enqueue(std::deque<std::shared_ptr<Waiter>>& waiters,
+                      std::shared_ptr<Waiter> waiter);
+  void grantLocked(HostState& host,
+                   std::unique_ptr<PooledConnection> connection);
+  std::vector<std::unique_ptr<PooledConnection>> takeIdle();
+
+  static bool isAlive(PooledConnection& connection);
+  static void close(PooledConnection& connection);
+
+  ConnectionPoolOptions m_options;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, HostState> m_hosts;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_CONNECTION_POOL_H
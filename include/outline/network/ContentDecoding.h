@@ -0,0 +1,141 @@
+#ifndef OUTLINE_NETWORK_CONTENT_DECODING_H
+#define OUTLINE_NETWORK_CONTENT_DECODING_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <boost/beast/core/buffers_range.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Incremental decoder of a gzip or deflate response body.
+ *
+ * Input is decoded as it arrives, so compressed bodies are never held in
+ * full. Errors are reported as boost::system::errc::bad_message.
+ */
+class ContentDecoder {
+ public:
+  enum class Coding { Identity, Gzip, Deflate };
+
+  // Accept-Encoding value listing the codings decoded here.
+  static constexpr std::string_view kAcceptEncoding = "gzip, deflate";
+
+  /**
+   * @brief Returns the coding of a Content-Encoding value, or nothing if it
+   *        isn't supported.
+   */
+  static std::optional<Coding> parse(std::string_view contentEncoding);
+
+  explicit ContentDecoder(Coding coding = Coding::Identity);
+  ~ContentDecoder();
+  ContentDecoder(const ContentDecoder&) = delete;
+  ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+  Coding coding() const { return m_coding; }
+  /**
+   * @brief Appends the decoded input to out.
+   */
+  boost::system::error_code decode(std::string_view input, std::string& out);
+  /**
+   * @brief Fails if a compressed body ended before its stream did.
+   */
+  boost::system::error_code finish() const;
+
+ private:
+  struct Stream;
+
+  Coding m_coding;
+  std::unique_ptr<Stream> m_stream;
+};
+
+/**
+ * @brief Beast body of a response held as a string and decoded while it is
+ *        read, according to its Content-Encoding.
+ *
+ * With discard set before the read, the body is read off the connection and
+ * dropped, for calls that only need the status.
+ */
+struct DecodingBody {
+  struct value_type {
+    std::string data;
+    bool discard = false;
+  };
+
+  class reader {
+   public:
+    // Made with the parser; the header is only complete by init().
+    template <bool isRequest, class Fields>
+    reader(boost::beast::http::header<isRequest, Fields>& header,
+           value_type& body)
+        : m_header(&header),
+          m_encodingOf(&encodingOf<isRequest, Fields>),
+          m_body(body) {}
+
+    void init(const boost::optional<std::uint64_t>& length,
+              boost::system::error_code& ec) {
+      ec = {};
+      if (m_body.discard)
+        return;
+      auto coding = ContentDecoder::parse(m_encodingOf(m_header));
+      if (!coding) {
+        ec = boost::system::errc::make_error_code(
+            boost::system::errc::not_supported);
+        return;
+      }
+      m_decoder.emplace(*coding);
+      // A compressed body's length only bounds its decoded size from below.
+      if (length)
+        m_body.data.reserve(static_cast<std::size_t>(*length));
+    }
+
+    template <class ConstBufferSequence>
+    std::size_t put(const ConstBufferSequence& buffers,
+                    boost::system::error_code& ec) {
+      ec = {};
+      std::size_t size = 0;
+      for (auto buffer : boost::beast::buffers_range_ref(buffers)) {
+        size += buffer.size();
+        if (m_body.discard)
+          continue;
+        ec = m_decoder->decode(
+            std::string_view(static_cast<const char*>(buffer.data()),
+                             buffer.size()),
+            m_body.data);
+        if (ec)
+          break;
+      }
+      return size;
+    }
+
+    void finish(boost::system::error_code& ec) {
+      ec = m_decoder ? m_decoder->finish() : boost::system::error_code{};
+    }
+
+   private:
+    template <bool isRequest, class Fields>
+    static std::string_view encodingOf(const void* header) {
+      using Header = boost::beast::http::header<isRequest, Fields>;
+      const auto& fields = *static_cast<const Header*>(header);
+      auto value = fields[boost::beast::http::field::content_encoding];
+      return std::string_view(value.data(), value.size());
+    }
+
+    const void* m_header;
+    std::string_view (*m_encodingOf)(const void*);
+    value_type& m_body;
+    std::optional<ContentDecoder> m_decoder;
+  };
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_CONTENT_DECODING_H
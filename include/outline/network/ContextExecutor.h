@@ -0,0 +1,81 @@
+#ifndef OUTLINE_NETWORK_CONTEXT_EXECUTOR_H
+#define OUTLINE_NETWORK_CONTEXT_EXECUTOR_H
+
+#include <memory>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Executor running every handler of the inner executor with a
+ *        per-request Context active on the thread.
+ *
+ * Context must have a nested Scope that makes a Context* active for its
+ * lifetime, like TraceContext and RequestContext. Wrappers nest, so one
+ * strand can carry several contexts.
+ */
+template <typename Context>
+class ContextExecutor {
+ public:
+  ContextExecutor(boost::asio::any_io_executor inner,
+                  std::shared_ptr<Context> context)
+      : m_inner(std::move(inner)), m_context(std::move(context)) {}
+
+  // The wrapped executor, e.g. to rewrap it with another context.
+  const boost::asio::any_io_executor& inner() const noexcept {
+    return m_inner;
+  }
+
+  template <typename Function>
+  void execute(Function function) const {
+    m_inner.execute(
+        [context = m_context, function = std::move(function)]() mutable {
+          typename Context::Scope scope(context.get());
+          function();
+        });
+  }
+
+  boost::asio::execution_context& query(
+      boost::asio::execution::context_t) const noexcept {
+    return boost::asio::query(m_inner, boost::asio::execution::context);
+  }
+
+  template <typename Property>
+  auto query(const Property& property) const
+      -> decltype(boost::asio::query(std::declval<
+                                         const boost::asio::any_io_executor&>(),
+                                     property)) {
+    return boost::asio::query(m_inner, property);
+  }
+
+  ContextExecutor require(
+      boost::asio::execution::blocking_t::never_t property) const {
+    return {boost::asio::require(m_inner, property), m_context};
+  }
+
+  template <typename Property>
+  ContextExecutor prefer(const Property& property) const {
+    return {boost::asio::prefer(m_inner, property), m_context};
+  }
+
+  friend bool operator==(const ContextExecutor& a,
+                         const ContextExecutor& b) noexcept {
+    return a.m_inner == b.m_inner && a.m_context == b.m_context;
+  }
+  friend bool operator!=(const ContextExecutor& a,
+                         const ContextExecutor& b) noexcept {
+    return !(a == b);
+  }
+
+ private:
+  boost::asio::any_io_executor m_inner;
+  std::shared_ptr<Context> m_context;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_CONTEXT_EXECUTOR_H
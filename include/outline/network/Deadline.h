@@ -0,0 +1,50 @@
+#ifndef OUTLINE_NETWORK_DEADLINE_H
+#define OUTLINE_NETWORK_DEADLINE_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include <boost/asio.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Scoped deadline of one network phase.
+ *
+ * When the timeout passes before the guard is destroyed, onExpire is called
+ * (typically cancelling the socket or resolver) and expired() turns true.
+ * The timer runs on the given executor, which must be the strand of the
+ * coroutine that owns the guarded object.
+ */
+class Deadline {
+ public:
+  Deadline(const boost::asio::any_io_executor& executor,
+           std::chrono::steady_clock::duration timeout,
+           std::function<void()> onExpire);
+  ~Deadline();
+
+  Deadline(const Deadline&) = delete;
+  Deadline& operator=(const Deadline&) = delete;
+
+  bool expired() const { return m_state->expired; }
+
+ private:
+  struct State {
+    explicit State(const boost::asio::any_io_executor& executor)
+        : timer(executor) {}
+
+    boost::asio::steady_timer timer;
+    std::function<void()> onExpire;
+    bool active = true;
+    bool expired = false;
+  };
+
+  std::shared_ptr<State> m_state;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_DEADLINE_H
@@ -0,0 +1,65 @@
+#ifndef OUTLINE_NETWORK_HEDGING_H
+#define OUTLINE_NETWORK_HEDGING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Settings of hedged GET requests.
+ *
+ * A GET that got no answer within the given latency percentile of its
+ * endpoint is sent a second time on another pooled connection; the first
+ * answer wins and the other request is cancelled. Streaming GETs are never
+ * hedged, since their chunks are handed out as they arrive.
+ */
+struct HedgeOptions {
+  // Off by default.
+  bool enabled = false;
+  // Latency percentile of the endpoint after which the hedge is sent.
+  double percentile = 0.95;
+  // Requests of an endpoint that must have finished before it is hedged.
+  std::uint64_t minSamples = 20;
+  // Bounds of the delay before the hedge.
+  std::chrono::milliseconds minDelay{5};
+  std::chrono::milliseconds maxDelay{2000};
+  // Every GET adds budgetRatio tokens, up to budgetTokens, and every hedge
+  // takes one, so at most about budgetRatio of the GETs are hedged.
+  double budgetTokens = 10;
+  double budgetRatio = 0.1;
+};
+
+/**
+ * @brief Returns how long to wait for an answer before hedging, given the
+ *        endpoint's latency percentile in microseconds.
+ */
+std::chrono::microseconds hedgeDelay(const HedgeOptions& options,
+                                     std::uint64_t percentileMicros);
+
+/**
+ * @brief Token bucket limiting hedges to a fraction of the GETs. Lock free.
+ */
+class HedgeBudget {
+ public:
+  HedgeBudget(double maxTokens, double tokenRatio);
+
+  void recordRequest();
+  /**
+   * @brief Takes a token; returns false if none is left.
+   */
+  bool trySpend();
+
+ private:
+  // Tokens in thousandths, so they fit an atomic integer.
+  std::int64_t m_max;
+  std::int64_t m_ratio;
+  std::atomic<std::int64_t> m_tokens;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_HEDGING_H
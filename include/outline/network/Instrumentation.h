@@ -0,0 +1,228 @@
+#ifndef OUTLINE_NETWORK_INSTRUMENTATION_H
+#define OUTLINE_NETWORK_INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Parts of a request that are timed separately.
+ */
+enum class Phase { Resolve, Connect, Handshake, Write, Read, Parse };
+inline constexpr std::size_t kPhaseCount = 6;
+
+/**
+ * @brief Kinds of failed requests.
+ */
+enum class ErrorClass {
+  Timeout,
+  Network,
+  Tls,
+  CircuitOpen,
+  // 4xx and 5xx responses.
+  ClientError,
+  ServerError,
+  Parse,
+  Other
+};
+inline constexpr std::size_t kErrorClassCount = 8;
+
+std::string_view toString(Phase phase);
+std::string_view toString(ErrorClass errorClass);
+
+/**
+ * @brief Copy of a LatencyHistogram. Values are in microseconds.
+ */
+struct HistogramSnapshot {
+  std::uint64_t count = 0;
+  std::uint64_t sum = 0;
+  std::uint64_t max = 0;
+  // Count of every bucket, see LatencyHistogram::bucketUpperBound().
+  std::vector<std::uint64_t> buckets;
+
+  /**
+   * @brief Returns the value below which the fraction q of the samples
+   *        lie, accurate to the bucket width (about 6%).
+   */
+  std::uint64_t percentile(double q) const;
+};
+
+/**
+ * @brief Lock-free latency histogram with HDR-style log-linear buckets.
+ *
+ * Every power of two of microseconds is split into 16 buckets, so a value is
+ * known to within 1/16 of itself; values up to about 9 hours are kept
+ * apart. record() is a few relaxed atomic adds.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t kSubBuckets = 16;
+  static constexpr std::size_t kBuckets = 512;
+
+  void record(std::chrono::steady_clock::duration value);
+  HistogramSnapshot snapshot() const;
+  /**
+   * @brief Returns the percentile q like HistogramSnapshot::percentile()
+   *        without copying the buckets to the heap; count receives the
+   *        number of samples.
+   */
+  std::uint64_t percentile(double q, std::uint64_t& count) const;
+
+  static std::size_t bucketIndex(std::uint64_t micros);
+  static std::uint64_t bucketUpperBound(std::size_t index);
+
+ private:
+  std::array<std::atomic<std::uint64_t>, kBuckets> m_buckets{};
+  std::atomic<std::uint64_t> m_sum{0};
+  std::atomic<std::uint64_t> m_max{0};
+};
+
+/**
+ * @brief Latency of one endpoint, e.g. "GET" "/access-keys/{key_id}".
+ */
+struct EndpointLatency {
+  std::string method;
+  std::string endpoint;
+  HistogramSnapshot latency;
+};
+
+/**
+ * @brief Point-in-time copy of the client's counters and histograms.
+ */
+struct InstrumentationSnapshot {
+  std::uint64_t requests = 0;
+  std::int64_t inFlight = 0;
+  std::uint64_t bytesSent = 0;
+  std::uint64_t bytesReceived = 0;
+  // Second requests sent by hedging, and those that answered first.
+  std::uint64_t hedgesSent = 0;
+  std::uint64_t hedgesWon = 0;
+  std::array<std::uint64_t, kErrorClassCount> errors{};
+  std::array<HistogramSnapshot, kPhaseCount> phases;
+  std::vector<EndpointLatency> endpoints;
+
+  std::uint64_t errorCount(ErrorClass errorClass) const {
+    return errors[static_cast<std::size_t>(errorClass)];
+  }
+  const HistogramSnapshot& phase(Phase phase) const {
+    return phases[static_cast<std::size_t>(phase)];
+  }
+
+  /**
+   * @brief Formats the snapshot in the Prometheus text exposition format;
+   *        histograms become summaries with 0.5, 0.9, 0.99 and 0.999
+   *        quantiles in seconds.
+   */
+  std::string toPrometheus(std::string_view prefix = "outline_client") const;
+};
+
+/**
+ * @brief Counters and latency histograms of the requests of a client.
+ *
+ * All recording is lock free. Endpoint histograms are created on first use
+ * for up to kMaxEndpoints method and endpoint pairs; method and endpoint
+ * must be string literals or other strings that are never freed, like the
+ * api::Endpoints constants.
+ */
+class Instrumentation {
+ public:
+  static constexpr std::size_t kMaxEndpoints = 32;
+
+  /**
+   * @brief Times a phase from construction to destruction.
+   */
+  class PhaseTimer {
+   public:
+    PhaseTimer(Instrumentation& instrumentation, Phase phase)
+        : m_instrumentation(instrumentation),
+          m_phase(phase),
+          m_start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+      m_instrumentation.recordPhase(
+          m_phase, std::chrono::steady_clock::now() - m_start);
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+   private:
+    Instrumentation& m_instrumentation;
+    Phase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  Instrumentation() = default;
+  Instrumentation(const Instrumentation&) = delete;
+  Instrumentation& operator=(const Instrumentation&) = delete;
+
+  void recordPhase(Phase phase, std::chrono::steady_clock::duration duration) {
+    m_phases[static_cast<std::size_t>(phase)].record(duration);
+  }
+  void recordError(ErrorClass errorClass) {
+    m_errors[static_cast<std::size_t>(errorClass)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+  void addBytesSent(std::uint64_t bytes) {
+    m_bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  void addBytesReceived(std::uint64_t bytes) {
+    m_bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void requestStarted() {
+    m_requests.fetch_add(1, std::memory_order_relaxed);
+    m_inFlight.fetch_add(1, std::memory_order_relaxed);
+  }
+  void requestFinished(std::string_view method, std::string_view endpoint,
+                       std::chrono::steady_clock::duration latency);
+  void hedgeSent() { m_hedgesSent.fetch_add(1, std::memory_order_relaxed); }
+  void hedgeWon() { m_hedgesWon.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Returns the latency percentile q of the endpoint's requests in
+   *        microseconds, or nothing while fewer than minSamples of them
+   *        finished. Doesn't allocate.
+   */
+  std::optional<std::uint64_t> endpointPercentile(
+      std::string_view method, std::string_view endpoint, double q,
+      std::uint64_t minSamples) const;
+
+  InstrumentationSnapshot snapshot() const;
+
+ private:
+  struct EndpointSlot {
+    // 0 free, 1 being claimed, 2 ready.
+    std::atomic<int> state{0};
+    std::string_view method;
+    std::string_view endpoint;
+    std::unique_ptr<LatencyHistogram> latency;
+  };
+
+  LatencyHistogram* endpointHistogram(std::string_view method,
+                                      std::string_view endpoint);
+
+  std::atomic<std::uint64_t> m_requests{0};
+  std::atomic<std::int64_t> m_inFlight{0};
+  std::atomic<std::uint64_t> m_bytesSent{0};
+  std::atomic<std::uint64_t> m_bytesReceived{0};
+  std::atomic<std::uint64_t> m_hedgesSent{0};
+  std::atomic<std::uint64_t> m_hedgesWon{0};
+  std::array<std::atomic<std::uint64_t>, kErrorClassCount> m_errors{};
+  std::array<LatencyHistogram, kPhaseCount> m_phases;
+  std::array<EndpointSlot, kMaxEndpoints> m_endpoints;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_INSTRUMENTATION_H
@@ -0,0 +1,218 @@
+#ifndef OUTLINE_NETWORK_PERIODIC_POLLER_H
+#define OUTLINE_NETWORK_PERIODIC_POLLER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Schedule of one subscription.
+ */
+struct PollOptions {
+  std::chrono::milliseconds interval{std::chrono::seconds(30)};
+  // Each wait is randomly stretched or shortened by up to this fraction of
+  // the interval, so many clients don't poll in lockstep.
+  double jitter = 0.1;
+  // Poll right away instead of after the first interval.
+  bool immediate = true;
+};
+
+/**
+ * @brief Fetches a resource on a timer and hands every result to all
+ *        subscribers.
+ *
+ * One fetch serves all subscribers; it runs at the shortest interval any of
+ * them asked for. The loop only runs while there are subscribers. Callbacks
+ * run on the poller's executor, one at a time; exceptions they throw are
+ * dropped.
+ */
+template <typename T>
+class PeriodicPoller : public std::enable_shared_from_this<PeriodicPoller<T>> {
+ public:
+  // Called with the poller's lock held, so it should only create the
+  // awaitable; the fetch runs when the loop awaits it.
+  using Fetch = std::function<boost::asio::awaitable<T>()>;
+  using Callback =
+      std::function<void(std::shared_ptr<const T>, std::exception_ptr)>;
+
+  /**
+   * @param executor - a strand; the timer and callbacks run on it.
+   */
+  static std::shared_ptr<PeriodicPoller> create(
+      boost::asio::any_io_executor executor, Fetch fetch) {
+    return std::shared_ptr<PeriodicPoller>(
+        new PeriodicPoller(std::move(executor), std::move(fetch)));
+  }
+
+  /**
+   * @return false once the poller is stopped; the callback is never called.
+   */
+  bool subscribe(std::uint64_t id, Callback callback,
+                 const PollOptions& options) {
+    auto now = std::chrono::steady_clock::now();
+    bool start = false;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopped)
+        return false;
+      m_subscribers[id] = Subscriber{std::move(callback), options};
+      auto due = options.immediate ? now : now + jitteredLocked(options);
+      m_nextPoll = std::min(m_nextPoll, due);
+      start = !m_running;
+      m_running = true;
+    }
+    if (start) {
+      boost::asio::co_spawn(m_executor, run(this->shared_from_this()),
+                            boost::asio::detached);
+    } else {
+      wake();
+    }
+    return true;
+  }
+
+  /**
+   * @return false if the id isn't subscribed.
+   */
+  bool unsubscribe(std::uint64_t id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_subscribers.erase(id) > 0;
+  }
+
+  /**
+   * @brief Drops all subscribers and ends the loop for good. A fetch already
+   *        running finishes, but once stop() returns no fetch is started.
+   */
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopped = true;
+      m_subscribers.clear();
+    }
+    wake();
+  }
+
+ private:
+  struct Subscriber {
+    Callback callback;
+    PollOptions options;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  PeriodicPoller(boost::asio::any_io_executor executor, Fetch fetch)
+      : m_executor(executor),
+        m_timer(executor),
+        m_fetch(std::move(fetch)),
+        m_random(std::random_device{}()) {}
+
+  // Interrupts the current wait so the loop looks at the schedule again.
+  void wake() {
+    auto self = this->shared_from_this();
+    boost::asio::post(m_executor, [self]() { self->m_timer.cancel(); });
+  }
+
+  Clock::duration jitteredLocked(const PollOptions& options) {
+    std::uniform_real_distribution<double> spread(-options.jitter,
+                                                  options.jitter);
+    auto interval = std::chrono::duration<double, std::milli>(options.interval);
+    return std::chrono::duration_cast<Clock::duration>(
+        interval * (1.0 + spread(m_random)));
+  }
+
+  // Owns a reference to the poller so it outlives the loop.
+  static boost::asio::awaitable<void> run(
+      std::shared_ptr<PeriodicPoller> self) {
+    for (;;) {
+      Clock::time_point due;
+      {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        if (self->m_stopped || self->m_subscribers.empty()) {
+          self->m_running = false;
+          self->m_nextPoll = Clock::time_point::max();
+          co_return;
+        }
+        due = self->m_nextPoll;
+      }
+      if (Clock::now() < due) {
+        self->m_timer.expires_at(due);
+        boost::system::error_code ec;
+        co_await self->m_timer.async_wait(
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        // Woken early, or the schedule changed: look again.
+        continue;
+      }
+
+      std::optional<boost::asio::awaitable<T>> fetch;
+      {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        if (self->m_stopped)
+          continue;
+        // Subscribers asking for an immediate poll while this one runs set
+        // the next due time; it is kept below.
+        self->m_nextPoll = Clock::time_point::max();
+        fetch.emplace(self->m_fetch());
+      }
+      std::shared_ptr<const T> value;
+      std::exception_ptr error;
+      try {
+        value = std::make_shared<const T>(co_await std::move(*fetch));
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::vector<Callback> callbacks;
+      {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        auto interval = std::chrono::milliseconds::max();
+        const PollOptions* shortest = nullptr;
+        for (const auto& [id, subscriber] : self->m_subscribers) {
+          callbacks.push_back(subscriber.callback);
+          if (subscriber.options.interval < interval) {
+            interval = subscriber.options.interval;
+            shortest = &subscriber.options;
+          }
+        }
+        if (shortest) {
+          self->m_nextPoll =
+              std::min(self->m_nextPoll,
+                       Clock::now() + self->jitteredLocked(*shortest));
+        }
+      }
+      for (auto& callback : callbacks) {
+        try {
+          callback(value, error);
+        } catch (...) {
+        }
+      }
+    }
+  }
+
+  boost::asio::any_io_executor m_executor;
+  boost::asio::steady_timer m_timer;
+  Fetch m_fetch;
+
+  std::mutex m_mutex;
+  std::map<std::uint64_t, Subscriber> m_subscribers;
+  Clock::time_point m_nextPoll = Clock::time_point::max();
+  std::mt19937 m_random;
+  bool m_running = false;
+  bool m_stopped = false;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_PERIODIC_POLLER_H
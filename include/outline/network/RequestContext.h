@@ -0,0 +1,100 @@
+#ifndef OUTLINE_NETWORK_REQUEST_CONTEXT_H
+#define OUTLINE_NETWORK_REQUEST_CONTEXT_H
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "outline/network/CancellationSignal.h"
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Scheduling class of a request. Waiters for pooled connections and
+ *        concurrency slots are served in this order, oldest first within a
+ *        class.
+ */
+enum class RequestPriority {
+  // Single calls a user is waiting on; the default.
+  Interactive,
+  // Batch and reconcile calls.
+  Bulk,
+  // Background metrics and key-list polls.
+  Polling,
+};
+
+/**
+ * @brief Priority and cancellation of one request, or of the calls started
+ *        under a RequestScope.
+ *
+ * The client makes the request's context active while a handler of its
+ * strand runs, so the pool and the limiter pick it up without passing it
+ * along. Requests with the default priority and no signal run without one.
+ */
+struct RequestContext {
+  // Unset in a RequestScope that leaves each call its default class.
+  std::optional<RequestPriority> priority;
+  std::shared_ptr<CancellationSignal> cancellation;
+
+  RequestPriority effectivePriority() const {
+    return priority.value_or(RequestPriority::Interactive);
+  }
+  bool cancelled() const { return cancellation && cancellation->emitted(); }
+
+  static RequestContext* active() { return s_active; }
+  static RequestPriority activePriority() {
+    return s_active ? s_active->effectivePriority()
+                    : RequestPriority::Interactive;
+  }
+
+  /**
+   * @brief Makes the context active on this thread for the scope.
+   */
+  class Scope {
+   public:
+    explicit Scope(RequestContext* context) : m_previous(s_active) {
+      s_active = context;
+    }
+    ~Scope() { s_active = m_previous; }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    RequestContext* m_previous;
+  };
+
+ private:
+  static inline thread_local RequestContext* s_active = nullptr;
+};
+
+/**
+ * @brief Applies a priority and a cancellation signal to the client calls
+ *        started on this thread while it lives.
+ *
+ * Emitting the signal makes the calls fail with OutlineCancelledException:
+ * queued ones leave their queue, running ones have their connection
+ * closed, and calls started after the emit fail right away.
+ */
+class RequestScope {
+ public:
+  explicit RequestScope(
+      RequestPriority priority,
+      std::shared_ptr<CancellationSignal> cancellation = nullptr)
+      : m_context{priority, std::move(cancellation)} {}
+  explicit RequestScope(std::shared_ptr<CancellationSignal> cancellation)
+      : m_context{std::nullopt, std::move(cancellation)} {}
+
+  RequestScope(const RequestScope&) = delete;
+  RequestScope& operator=(const RequestScope&) = delete;
+
+ private:
+  RequestContext m_context;
+  RequestContext::Scope m_scope{&m_context};
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_REQUEST_CONTEXT_H
@@ -0,0 +1,186 @@
+#ifndef OUTLINE_NETWORK_REQUEST_LIMITER_H
+#define OUTLINE_NETWORK_REQUEST_LIMITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/asio.hpp>
+
+#include "outline/network/RequestContext.h"
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Settings of the per-host request limiter.
+ */
+struct LimiterOptions {
+  // Concurrent requests per host start at initialLimit and adapt between
+  // minLimit and maxLimit: a response within latencyTolerance times the
+  // host's baseline latency raises the limit by 1/limit, a slower one or a
+  // failure multiplies it by backoffRatio. maxLimit 0 disables the limit.
+  std::size_t initialLimit = 8;
+  std::size_t minLimit = 1;
+  std::size_t maxLimit = 64;
+  double latencyTolerance = 2.0;
+  double backoffRatio = 0.9;
+  // Requests started per second per host, in bursts of up to burst;
+  // 0 disables rate limiting.
+  double ratePerSecond = 0;
+  std::size_t burst = 10;
+};
+
+/**
+ * @brief AIMD concurrency limit driven by observed latency.
+ *
+ * The baseline is the lowest latency of the previous window of samples, so
+ * it follows the server when its normal latency drifts. Not thread safe.
+ */
+class AdaptiveLimit {
+ public:
+  explicit AdaptiveLimit(const LimiterOptions& options);
+
+  /**
+   * @brief Records a finished request.
+   * @param inFlight - requests in flight when it finished, itself included.
+   */
+  void record(std::chrono::steady_clock::duration latency, bool success,
+              std::size_t inFlight);
+
+  std::size_t current() const { return static_cast<std::size_t>(m_limit); }
+
+ private:
+  static constexpr std::size_t kWindow = 100;
+
+  double m_limit;
+  double m_min;
+  double m_max;
+  double m_tolerance;
+  double m_backoff;
+  std::chrono::steady_clock::duration m_baseline{};
+  std::chrono::steady_clock::duration m_windowMin;
+  std::size_t m_samples = 0;
+};
+
+/**
+ * @brief Token bucket. Not thread safe.
+ */
+class TokenBucket {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  TokenBucket(double ratePerSecond, std::size_t burst,
+              Clock::time_point now = Clock::now());
+
+  /**
+   * @brief Takes a token and returns how long to wait until it is due; the
+   *        token is reserved, so later callers queue behind.
+   */
+  Clock::duration reserve(Clock::time_point now = Clock::now());
+
+ private:
+  double m_rate;
+  double m_burst;
+  // Tokens at m_updated; negative while tokens are reserved ahead.
+  double m_tokens;
+  Clock::time_point m_updated;
+};
+
+/**
+ * @brief Queues requests per host so that only an adaptive number of them
+ *        run at once and they start at a bounded rate.
+ *
+ * Keys are "host:port" strings like in ConnectionPool. Waiters are served by
+ * RequestPriority, in arrival order within a class. Thread safe.
+ */
+class RequestLimiter : public std::enable_shared_from_this<RequestLimiter> {
+ public:
+  /**
+   * @brief Slot of one running request. Call finish() with the outcome;
+   *        a permit destroyed without it frees the slot without a sample.
+   */
+  class Permit {
+   public:
+    Permit() = default;
+    Permit(Permit&& other) noexcept;
+    Permit& operator=(Permit&& other) noexcept;
+    Permit(const Permit&) = delete;
+    Permit& operator=(const Permit&) = delete;
+    ~Permit();
+
+    void finish(bool success);
+
+   private:
+    friend class RequestLimiter;
+
+    Permit(std::shared_ptr<RequestLimiter> limiter, std::string key);
+
+    std::shared_ptr<RequestLimiter> m_limiter;
+    std::string m_key;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  static std::shared_ptr<RequestLimiter> create(
+      const LimiterOptions& options = {}) {
+    return std::shared_ptr<RequestLimiter>(new RequestLimiter(options));
+  }
+
+  /**
+   * @brief Waits for the host's rate and concurrency limits.
+   * @param timeout - limit for the wait, fails with error::timed_out.
+   * @param context - priority and cancellation of the request, null for
+   *        an interactive one; a cancelled wait fails with
+   *        error::operation_aborted.
+   */
+  boost::asio::awaitable<Permit> acquireAsync(
+      const std::string& key, std::chrono::steady_clock::duration timeout,
+      const RequestContext* context = nullptr);
+
+  /**
+   * @brief Returns the current concurrency limit of the host.
+   */
+  std::size_t limit(const std::string& key) const;
+
+ private:
+  struct Waiter {
+    Waiter(const boost::asio::any_io_executor& executor,
+           RequestPriority priority)
+        : timer(executor), priority(priority) {}
+
+    boost::asio::steady_timer timer;
+    RequestPriority priority;
+    bool granted = false;
+  };
+
+  struct HostState {
+    explicit HostState(const LimiterOptions& options)
+        : limit(options), bucket(options.ratePerSecond, options.burst) {}
+
+    AdaptiveLimit limit;
+    TokenBucket bucket;
+    std::size_t inFlight = 0;
+    std::deque<std::shared_ptr<Waiter>> waiters;
+  };
+
+  explicit RequestLimiter(const LimiterOptions& options)
+      : m_options(options) {}
+
+  HostState& hostLocked(const std::string& key);
+  void release(const std::string& key,
+               std::chrono::steady_clock::duration latency, bool sample,
+               bool success);
+
+  LimiterOptions m_options;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, HostState> m_hosts;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_REQUEST_LIMITER_H
@@ -0,0 +1,95 @@
+#ifndef OUTLINE_NETWORK_RESOLVER_CACHE_H
+#define OUTLINE_NETWORK_RESOLVER_CACHE_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Settings of the DNS resolution cache.
+ */
+struct ResolverCacheOptions {
+  // How long resolved endpoints are used before resolving again.
+  std::chrono::seconds ttl{60};
+  // Serve expired endpoints and refresh them in the background instead of
+  // making the request wait for the resolver.
+  bool backgroundRefresh = false;
+  // Delay before the next address is tried in parallel when connecting.
+  std::chrono::milliseconds connectAttemptDelay{250};
+};
+
+/**
+ * @brief TTL cache in front of tcp::resolver, keyed by "host:port".
+ *
+ * Endpoints are stored in happy-eyeballs order (address families
+ * interleaved, IPv6 first) so they can go straight to connectRacingAsync().
+ */
+class ResolverCache : public std::enable_shared_from_this<ResolverCache> {
+ public:
+  using Endpoints = std::vector<boost::asio::ip::tcp::endpoint>;
+
+  static std::shared_ptr<ResolverCache> create(
+      const ResolverCacheOptions& options = {}) {
+    return std::shared_ptr<ResolverCache>(new ResolverCache(options));
+  }
+
+  /**
+   * @brief Returns the endpoints of the host, resolving them if needed.
+   * @param timeout - limit for the resolver, fails with error::timed_out.
+   */
+  boost::asio::awaitable<Endpoints> resolveAsync(
+      const std::string& host, const std::string& port,
+      std::chrono::steady_clock::duration timeout);
+  /**
+   * @brief Forgets the endpoints of the host, e.g. after a failed connect.
+   */
+  void invalidate(const std::string& host, const std::string& port);
+
+  const ResolverCacheOptions& options() const { return m_options; }
+
+ private:
+  struct Entry {
+    Endpoints endpoints;
+    std::chrono::steady_clock::time_point expiresAt;
+    bool refreshing = false;
+  };
+
+  explicit ResolverCache(const ResolverCacheOptions& options)
+      : m_options(options) {}
+
+  boost::asio::awaitable<Endpoints> lookupAsync(
+      std::string host, std::string port,
+      std::chrono::steady_clock::duration timeout);
+  void store(const std::string& key, const Endpoints& endpoints);
+
+  ResolverCacheOptions m_options;
+  std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_entries;
+};
+
+/**
+ * @brief Connects the socket to one of the endpoints, happy-eyeballs style.
+ *
+ * Attempts start in order; when one hasn't finished after attemptDelay (or
+ * has failed) the next one is started in parallel. The first successful
+ * connection wins and the others are cancelled. Fails with error::timed_out
+ * when no attempt succeeded within timeout.
+ */
+boost::asio::awaitable<void> connectRacingAsync(
+    boost::asio::ip::tcp::socket& socket,
+    const ResolverCache::Endpoints& endpoints,
+    std::chrono::milliseconds attemptDelay,
+    std::chrono::steady_clock::duration timeout);
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_RESOLVER_CACHE_H
@@ -0,0 +1,80 @@
+#ifndef OUTLINE_NETWORK_RESPONSE_CACHE_H
+#define OUTLINE_NETWORK_RESPONSE_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Settings of the response cache.
+ */
+struct ResponseCacheOptions {
+  // How long a cached response body is served; 0 disables the cache.
+  std::chrono::milliseconds ttl{0};
+};
+
+/**
+ * @brief Counters of cache lookups.
+ */
+struct ResponseCacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+};
+
+/**
+ * @brief TTL cache of response bodies keyed by endpoint path.
+ *
+ * A body fetched before an invalidation is not stored, so a read racing
+ * with a write can't bring back the old state: take generation() before
+ * the request and pass it to put(). Thread safe.
+ */
+class ResponseCache {
+ public:
+  using Body = std::shared_ptr<const std::string>;
+
+  explicit ResponseCache(const ResponseCacheOptions& options = {})
+      : m_options(options) {}
+
+  bool enabled() const { return m_options.ttl.count() > 0; }
+
+  /**
+   * @brief Returns the fresh body cached for the key, or nullptr.
+   */
+  Body get(const std::string& key);
+  /**
+   * @brief Returns the current invalidation generation.
+   */
+  std::uint64_t generation() const;
+  /**
+   * @brief Caches the body unless the cache was invalidated after
+   *        generation was taken.
+   */
+  void put(const std::string& key, Body body, std::uint64_t generation);
+  void invalidate(const std::string& key);
+  void clear();
+
+  ResponseCacheStats stats() const;
+
+ private:
+  struct Entry {
+    Body body;
+    std::chrono::steady_clock::time_point expiresAt;
+  };
+
+  ResponseCacheOptions m_options;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_entries;
+  std::uint64_t m_generation = 0;
+  ResponseCacheStats m_stats;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_RESPONSE_CACHE_H
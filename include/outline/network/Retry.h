@@ -0,0 +1,124 @@
+#ifndef OUTLINE_NETWORK_RETRY_H
+#define OUTLINE_NETWORK_RETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Settings of automatic retries and circuit breaking.
+ *
+ * GET, PUT and DELETE requests are retried after transport errors, timeouts
+ * and 429/502/503/504 responses. POST /access-keys creates a key each time
+ * it reaches the server, so it is only retried with retryCreateAccessKey.
+ */
+struct RetryOptions {
+  // Tries per request, the first one included; 1 disables retries. The
+  // streaming GETs of the key list and the metrics are tried once, since
+  // part of the body may already be delivered; the breaker still applies.
+  int maxAttempts = 3;
+  // Waits between tries follow decorrelated jitter: a random value between
+  // baseDelay and three times the previous wait, capped at maxDelay.
+  std::chrono::milliseconds baseDelay{50};
+  std::chrono::milliseconds maxDelay{2000};
+  // Every failed try takes a token, every successful one returns
+  // budgetRatio; retries stop while less than half of budgetTokens are
+  // left, so a struggling server sees little more than the normal load.
+  double budgetTokens = 10;
+  double budgetRatio = 0.1;
+  bool retryCreateAccessKey = false;
+  // Failures in a row after which a host is skipped for breakerOpenTime;
+  // 0 disables the breaker.
+  int breakerThreshold = 5;
+  std::chrono::milliseconds breakerOpenTime{std::chrono::seconds(10)};
+};
+
+/**
+ * @brief Decorrelated-jitter backoff of one request.
+ */
+class Backoff {
+ public:
+  Backoff(std::chrono::milliseconds base, std::chrono::milliseconds cap);
+
+  /**
+   * @brief Returns how long to wait before the next try.
+   */
+  std::chrono::milliseconds next();
+
+ private:
+  std::chrono::milliseconds m_base;
+  std::chrono::milliseconds m_cap;
+  std::chrono::milliseconds m_previous;
+};
+
+/**
+ * @brief Token bucket limiting retries to a fraction of the successful
+ *        requests. Lock free.
+ */
+class RetryBudget {
+ public:
+  RetryBudget(double maxTokens, double tokenRatio);
+
+  void recordSuccess();
+  void recordFailure();
+  /**
+   * @brief Returns true while more than half of the tokens are left.
+   */
+  bool canRetry() const;
+
+ private:
+  // Tokens in thousandths, so they fit an atomic integer.
+  std::int64_t m_max;
+  std::int64_t m_ratio;
+  std::atomic<std::int64_t> m_tokens;
+};
+
+/**
+ * @brief Per-host circuit breaker.
+ *
+ * After threshold failures in a row a host is open: requests to it fail
+ * right away until openTime passed. Then one request is let through as a
+ * probe; its success closes the circuit, its failure opens it again. Thread
+ * safe.
+ */
+class CircuitBreaker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  CircuitBreaker(int threshold, std::chrono::milliseconds openTime);
+
+  /**
+   * @brief Returns false if requests to the host must not be sent now.
+   */
+  bool allow(const std::string& host, Clock::time_point now = Clock::now());
+  void recordSuccess(const std::string& host);
+  void recordFailure(const std::string& host,
+                     Clock::time_point now = Clock::now());
+
+ private:
+  struct Host {
+    int failures = 0;
+    Clock::time_point openUntil;
+    bool probing = false;
+  };
+
+  int m_threshold;
+  std::chrono::milliseconds m_openTime;
+  // Size of m_hosts, so healthy hosts skip the lock.
+  std::atomic<std::size_t> m_tracked{0};
+  std::mutex m_mutex;
+  std::unordered_map<std::string, Host> m_hosts;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_RETRY_H
@@ -0,0 +1,128 @@
+#ifndef OUTLINE_NETWORK_SHUTDOWN_GATE_H
+#define OUTLINE_NETWORK_SHUTDOWN_GATE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "outline/network/CancellationSignal.h"
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Admits requests until it is closed, counts the ones in flight and
+ *        cancels them on demand.
+ *
+ * Requests enter() before they start and leave() when they finish, or hold
+ * the Ticket of admit(). After close() no request enters, and drainAsync()
+ * and wait() wait for the count to reach zero. cancel() runs every callback
+ * registered with onCancel(), each on its own executor, to make the
+ * stragglers fail fast. Thread safe.
+ */
+class ShutdownGate {
+ public:
+  /**
+   * @brief Keeps an onCancel() callback registered while it lives. Must be
+   *        destroyed on the executor the callback was registered with.
+   */
+  using Registration = CancellationSignal::Slot;
+
+  /**
+   * @brief Counts one request in until it is destroyed; empty if the gate
+   *        was closed. A coroutine taking it by value leaves the gate even
+   *        when its frame is destroyed before it ran.
+   */
+  class Ticket {
+   public:
+    Ticket() = default;
+    Ticket(Ticket&& other) noexcept
+        : m_gate(std::exchange(other.m_gate, nullptr)) {}
+    Ticket& operator=(Ticket&& other) noexcept {
+      if (this != &other) {
+        reset();
+        m_gate = std::exchange(other.m_gate, nullptr);
+      }
+      return *this;
+    }
+    Ticket(const Ticket&) = delete;
+    Ticket& operator=(const Ticket&) = delete;
+    ~Ticket() { reset(); }
+
+    explicit operator bool() const { return m_gate != nullptr; }
+
+   private:
+    friend class ShutdownGate;
+
+    explicit Ticket(ShutdownGate* gate) : m_gate(gate) {}
+    void reset() {
+      if (m_gate)
+        std::exchange(m_gate, nullptr)->leave();
+    }
+
+    ShutdownGate* m_gate = nullptr;
+  };
+
+  /**
+   * @brief Counts a request in; returns false once the gate is closed.
+   */
+  bool enter();
+  void leave();
+  Ticket admit() { return enter() ? Ticket(this) : Ticket(); }
+
+  /**
+   * @brief Stops admitting requests.
+   * @return false if the gate was already closed.
+   */
+  bool close();
+  bool closed() const;
+
+  /**
+   * @brief Runs every registered callback and every one registered later.
+   */
+  void cancel() { m_cancellation.emit(); }
+  bool cancelled() const { return m_cancellation.emitted(); }
+
+  std::size_t inFlight() const;
+
+  /**
+   * @brief Registers onCancel to run on the executor when cancel() is
+   *        called, right away if it has been called already.
+   */
+  Registration onCancel(const boost::asio::any_io_executor& executor,
+                        std::function<void()> onCancel) {
+    return m_cancellation.connect(executor, std::move(onCancel));
+  }
+
+  /**
+   * @brief Waits until no request is in flight or the deadline passes.
+   * @return true if every request has finished.
+   */
+  boost::asio::awaitable<bool> drainAsync(
+      std::chrono::steady_clock::time_point deadline);
+  /**
+   * @brief Blocks until no request is in flight. Must not run on a thread
+   *        the requests need to finish.
+   */
+  void wait();
+
+ private:
+  mutable std::mutex m_mutex;
+  std::size_t m_inFlight = 0;
+  std::condition_variable m_idle;
+  bool m_closed = false;
+  CancellationSignal m_cancellation;
+  // Timer of the drainAsync() waiting for the last request.
+  std::shared_ptr<boost::asio::steady_timer> m_drainWaiter;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_SHUTDOWN_GATE_H
@@ -0,0 +1,161 @@
+#ifndef OUTLINE_NETWORK_SINGLE_FLIGHT_H
+#define OUTLINE_NETWORK_SINGLE_FLIGHT_H
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "outline/network/ContextExecutor.h"
+#include "outline/network/RequestContext.h"
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Coalesces concurrent fetches of the same resource into one.
+ *
+ * The first caller of run() starts the fetch; callers arriving while it is
+ * in flight wait for it too and share its result or exception. The next
+ * call after it finished fetches again, so nothing is cached.
+ *
+ * The fetch runs on a RequestContext of its own rather than in the caller
+ * that started it: it runs at the highest priority of the callers waiting
+ * for it, and a caller whose cancellation signal is emitted stops waiting
+ * without cancelling it for the others.
+ */
+template <typename T>
+class SingleFlight {
+ public:
+  using Result = std::shared_ptr<const T>;
+
+  SingleFlight() : m_state(std::make_shared<State>()) {}
+
+  /**
+   * @param fetch - callable returning boost::asio::awaitable<T>, called by
+   *        the caller starting the flight. The awaitable may outlive that
+   *        call, so it must not refer to the callable.
+   * @param makeExecutor - callable returning the executor the fetch runs
+   *        on, e.g. a new request strand.
+   */
+  template <typename Fetch, typename MakeExecutor>
+  boost::asio::awaitable<Result> run(Fetch fetch, MakeExecutor makeExecutor) {
+    auto executor = co_await boost::asio::this_coro::executor;
+    const RequestContext* caller = RequestContext::active();
+    const RequestPriority priority =
+        caller ? caller->effectivePriority() : RequestPriority::Interactive;
+    // Woken by a cancel posted to this coroutine's executor, so the wake-up
+    // can't overtake the wait.
+    auto waiter = std::make_shared<boost::asio::steady_timer>(
+        executor, std::chrono::steady_clock::time_point::max());
+    std::shared_ptr<Flight> flight;
+    bool start = false;
+    bool raise = false;
+    {
+      std::lock_guard<std::mutex> lock(m_state->mutex);
+      if (!m_state->flight) {
+        auto context = std::make_shared<RequestContext>(
+            RequestContext{priority, nullptr});
+        m_state->flight = std::make_shared<Flight>(Flight{
+            context, ContextExecutor<RequestContext>(makeExecutor(), context),
+            priority});
+        start = true;
+      } else if (priority < m_state->flight->priority) {
+        m_state->flight->priority = priority;
+        raise = true;
+      }
+      flight = m_state->flight;
+      flight->waiters.push_back(waiter);
+    }
+
+    if (start) {
+      boost::asio::co_spawn(flight->executor, fly(m_state, flight, fetch()),
+                            boost::asio::detached);
+    } else if (raise) {
+      // The pool and the limiter read the priority on the fetch's strand.
+      boost::asio::post(flight->executor,
+                        [context = flight->context, priority]() {
+                          context->priority =
+                              std::min(context->effectivePriority(), priority);
+                        });
+    }
+
+    CancellationSignal::Slot cancel;
+    if (caller && caller->cancellation) {
+      cancel = caller->cancellation->connect(
+          executor, [waiter]() { waiter->cancel(); });
+    }
+    boost::system::error_code ec;
+    co_await waiter->async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+    {
+      std::lock_guard<std::mutex> lock(m_state->mutex);
+      if (!flight->done) {
+        // Only this caller's cancellation wakes it early.
+        auto& waiters = flight->waiters;
+        waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter),
+                      waiters.end());
+        throw boost::system::system_error(
+            boost::asio::error::operation_aborted);
+      }
+    }
+    if (flight->error)
+      std::rethrow_exception(flight->error);
+    co_return flight->result;
+  }
+
+ private:
+  struct Flight {
+    std::shared_ptr<RequestContext> context;
+    boost::asio::any_io_executor executor;
+    // Highest priority of the callers so far; guarded by State::mutex.
+    RequestPriority priority = RequestPriority::Interactive;
+    std::vector<std::shared_ptr<boost::asio::steady_timer>> waiters;
+    bool done = false;
+    // Written before done is set.
+    Result result;
+    std::exception_ptr error;
+  };
+
+  // Shared with the running fetch, which may finish after the last caller
+  // stopped waiting.
+  struct State {
+    std::mutex mutex;
+    std::shared_ptr<Flight> flight;
+  };
+
+  static boost::asio::awaitable<void> fly(std::shared_ptr<State> state,
+                                          std::shared_ptr<Flight> flight,
+                                          boost::asio::awaitable<T> fetch) {
+    Result result;
+    std::exception_ptr error;
+    try {
+      result = std::make_shared<const T>(co_await std::move(fetch));
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::vector<std::shared_ptr<boost::asio::steady_timer>> waiters;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      flight->result = std::move(result);
+      flight->error = error;
+      flight->done = true;
+      state->flight.reset();
+      waiters.swap(flight->waiters);
+    }
+    for (auto& w : waiters)
+      boost::asio::post(w->get_executor(), [w]() { w->cancel(); });
+  }
+
+  std::shared_ptr<State> m_state;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_SINGLE_FLIGHT_H
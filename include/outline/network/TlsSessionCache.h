@@ -0,0 +1,80 @@
+#ifndef OUTLINE_NETWORK_TLS_SESSION_CACHE_H
+#define OUTLINE_NETWORK_TLS_SESSION_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/asio/ssl.hpp>
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Counters of completed TLS handshakes.
+ */
+struct TlsSessionStats {
+  std::uint64_t resumedHandshakes = 0;
+  std::uint64_t fullHandshakes = 0;
+};
+
+/**
+ * @brief Client-side cache of TLS sessions keyed by "host:port".
+ *
+ * Sessions (including TLS 1.3 tickets, which arrive after the handshake) are
+ * captured through the new-session callback of the SSL context and applied
+ * to new connections to the same host, so reconnects use an abbreviated
+ * handshake.
+ */
+class TlsSessionCache {
+ public:
+  /**
+   * @brief Installs the session callbacks on the context.
+   */
+  explicit TlsSessionCache(boost::asio::ssl::context& sslContext);
+  /**
+   * @brief Detaches from the context and frees all cached sessions.
+   */
+  ~TlsSessionCache();
+
+  TlsSessionCache(const TlsSessionCache&) = delete;
+  TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+  /**
+   * @brief Tags the connection with its key and offers the cached session.
+   * @param ssl - the connection, not yet handshaken.
+   * @param key - the "host:port" key, must outlive the connection.
+   */
+  void prepare(SSL* ssl, const std::string& key);
+  /**
+   * @brief Counts the finished handshake as resumed or full.
+   */
+  void recordHandshake(SSL* ssl);
+  /**
+   * @brief Drops the session of the key, e.g. after a failed handshake.
+   */
+  void invalidate(const std::string& key);
+
+  TlsSessionStats stats() const;
+
+ private:
+  static int onNewSession(SSL* ssl, SSL_SESSION* session);
+  static int sslKeyIndex();
+  static int contextIndex();
+
+  void store(const std::string& key, SSL_SESSION* session);
+
+  SSL_CTX* m_context;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, SSL_SESSION*> m_sessions;
+  std::atomic<std::uint64_t> m_resumed{0};
+  std::atomic<std::uint64_t> m_full{0};
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_TLS_SESSION_CACHE_H
@@ -0,0 +1,179 @@
+#ifndef OUTLINE_NETWORK_TRACING_H
+#define OUTLINE_NETWORK_TRACING_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "outline/network/ContextExecutor.h"
+
+namespace outline {
+namespace network {
+
+/**
+ * @brief Span of an installed Tracer. The span ends when it is destroyed.
+ */
+class Span {
+ public:
+  virtual ~Span() = default;
+
+  virtual void setAttribute(std::string_view key, std::string_view value) = 0;
+  virtual void setAttribute(std::string_view key, std::int64_t value) = 0;
+  virtual void setError(std::string_view message) = 0;
+};
+
+/**
+ * @brief Adapter to a tracing system such as OpenTelemetry.
+ *
+ * A client with a tracer opens a span per request, named after its method
+ * and api::Endpoints template, with child spans for the resolve, connect,
+ * handshake, write, read and parse phases. Spans are started and ended on
+ * the client's io threads.
+ */
+class Tracer {
+ public:
+  virtual ~Tracer() = default;
+
+  /**
+   * @brief Returns the span active on the calling thread, or null. Called
+   *        on the caller's thread when a call starts; its spans become
+   *        children of the returned span.
+   */
+  virtual std::shared_ptr<Span> activeSpan() { return nullptr; }
+
+  /**
+   * @param parent - parent span, null for a root span.
+   * @param start - start time, earlier than now for phases that are
+   *        reported after they finished.
+   */
+  virtual std::unique_ptr<Span> startSpan(
+      std::string_view name, Span* parent,
+      std::chrono::system_clock::time_point start) = 0;
+};
+
+/**
+ * @brief Tracing state of one request strand.
+ *
+ * TracingExecutor makes it the active context of the thread while a handler
+ * of the strand runs, so spans opened anywhere in the request's coroutines
+ * find their tracer and parent without passing them along.
+ */
+struct TraceContext {
+  TraceContext(std::shared_ptr<Tracer> tracer, std::shared_ptr<Span> caller)
+      : tracer(std::move(tracer)), caller(std::move(caller)) {}
+
+  std::shared_ptr<Tracer> tracer;
+  // Span of the caller that started the request, kept alive until it ends.
+  std::shared_ptr<Span> caller;
+  // Innermost open span of the request.
+  Span* current = nullptr;
+
+  Span* parent() const { return current ? current : caller.get(); }
+
+  static TraceContext* active() { return s_active; }
+
+  /**
+   * @brief Makes the context active on this thread for the scope.
+   */
+  class Scope {
+   public:
+    explicit Scope(TraceContext* context) : m_previous(s_active) {
+      s_active = context;
+    }
+    ~Scope() { s_active = m_previous; }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    TraceContext* m_previous;
+  };
+
+ private:
+  static inline thread_local TraceContext* s_active = nullptr;
+};
+
+/**
+ * @brief Executor running every handler with a TraceContext active.
+ *
+ * Wraps the strand of a traced request. Only created when a tracer is
+ * installed, so untraced requests run on the plain strand.
+ */
+using TracingExecutor = ContextExecutor<TraceContext>;
+
+/**
+ * @brief Scoped span, a child of the innermost open span of the request.
+ *
+ * Does nothing unless the thread runs a traced request; building with
+ * OUTLINE_DISABLE_TRACING removes it completely.
+ */
+class TraceSpan {
+ public:
+  /**
+   * @param suffix - appended to name after a space, e.g. the endpoint.
+   */
+  explicit TraceSpan(std::string_view name, std::string_view suffix = {}) {
+#ifndef OUTLINE_DISABLE_TRACING
+    if (auto* context = TraceContext::active())
+      start(*context, name, suffix, std::chrono::system_clock::now());
+#endif
+  }
+  ~TraceSpan() {
+#ifndef OUTLINE_DISABLE_TRACING
+    if (m_context)
+      m_context->current = m_parent;
+#endif
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  /**
+   * @brief Reports a phase that already finished as a child span.
+   * @param error - error of a failed phase, empty on success.
+   */
+  static void completed(std::string_view name,
+                        std::chrono::steady_clock::duration duration,
+                        std::string_view error = {}) {
+#ifndef OUTLINE_DISABLE_TRACING
+    if (auto* context = TraceContext::active())
+      report(*context, name, duration, error);
+#endif
+  }
+
+  explicit operator bool() const { return m_span != nullptr; }
+
+  void setAttribute(std::string_view key, std::string_view value) {
+    if (m_span)
+      m_span->setAttribute(key, value);
+  }
+  void setAttribute(std::string_view key, std::int64_t value) {
+    if (m_span)
+      m_span->setAttribute(key, value);
+  }
+  void setError(std::string_view message) {
+    if (m_span)
+      m_span->setError(message);
+  }
+
+ private:
+  void start(TraceContext& context, std::string_view name,
+             std::string_view suffix,
+             std::chrono::system_clock::time_point now);
+  static void report(TraceContext& context, std::string_view name,
+                     std::chrono::steady_clock::duration duration,
+                     std::string_view error);
+
+  TraceContext* m_context = nullptr;
+  Span* m_parent = nullptr;
+  std::unique_ptr<Span> m_span;
+};
+
+}  // namespace network
+}  // namespace outline
+
+#endif  // OUTLINE_NETWORK_TRACING_H
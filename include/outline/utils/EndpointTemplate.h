@@ -0,0 +1,130 @@
+#ifndef OUTLINE_UTILS_ENDPOINT_TEMPLATE_H
+#define OUTLINE_UTILS_ENDPOINT_TEMPLATE_H
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace outline {
+namespace utils {
+
+/**
+ * @brief Path and query of an API URL. The path prefixes every request
+ *        target; the query, empty or without its '?', follows the endpoint.
+ */
+struct TargetBase {
+  std::string_view path;
+  std::string_view query;
+};
+
+/**
+ * @brief Endpoint path like "/access-keys/{key_id}/name", split at compile
+ *        time into literal and parameter segments.
+ *
+ * An ill-formed pattern (an unclosed or empty "{}") fails to compile when
+ * the template is constexpr.
+ */
+class EndpointTemplate {
+ public:
+  static constexpr std::size_t kMaxSegments = 8;
+
+  struct Segment {
+    // Literal text, or the parameter name without braces.
+    std::string_view text;
+    bool parameter = false;
+  };
+
+  constexpr explicit EndpointTemplate(std::string_view pattern)
+      : m_pattern(pattern) {
+    std::size_t pos = 0;
+    while (pos < pattern.size()) {
+      std::size_t open = pattern.find('{', pos);
+      if (open != pos) {
+        std::size_t end =
+            open == std::string_view::npos ? pattern.size() : open;
+        add({pattern.substr(pos, end - pos), false});
+        m_literalSize += end - pos;
+        pos = end;
+        continue;
+      }
+      std::size_t close = pattern.find('}', open);
+      if (close == std::string_view::npos || close == open + 1)
+        throw std::invalid_argument("Malformed endpoint template");
+      add({pattern.substr(open + 1, close - open - 1), true});
+      ++m_parameterCount;
+      pos = close + 1;
+    }
+  }
+
+  constexpr std::string_view pattern() const { return m_pattern; }
+  constexpr std::size_t parameterCount() const { return m_parameterCount; }
+  constexpr const Segment* begin() const { return m_segments.data(); }
+  constexpr const Segment* end() const { return m_segments.data() + m_count; }
+
+  /**
+   * @brief Appends base.path, the path with the values, percent-encoded, in
+   *        place of the parameters and then base.query to out. Reserves the
+   *        space up front, so a reused buffer doesn't allocate.
+   *
+   * @throws std::invalid_argument if the number of values doesn't match.
+   */
+  void expandInto(std::string& out, const TargetBase& base,
+                  std::initializer_list<std::string_view> values) const;
+  void expandInto(std::string& out, std::string_view basePath,
+                  std::initializer_list<std::string_view> values) const {
+    expandInto(out, TargetBase{basePath, {}}, values);
+  }
+
+ private:
+  constexpr void add(Segment segment) {
+    if (m_count == kMaxSegments)
+      throw std::invalid_argument("Endpoint template has too many segments");
+    m_segments[m_count++] = segment;
+  }
+
+  std::string_view m_pattern;
+  std::array<Segment, kMaxSegments> m_segments{};
+  std::size_t m_count = 0;
+  std::size_t m_parameterCount = 0;
+  std::size_t m_literalSize = 0;
+};
+
+/**
+ * @brief The parsed template of an api::Endpoints constant.
+ */
+template <const std::string_view& Pattern>
+inline constexpr EndpointTemplate endpointTemplate{Pattern};
+
+/**
+ * @brief Appends percent-encoded value to out, keeping only RFC 3986
+ *        unreserved characters.
+ */
+void appendPercentEncoded(std::string& out, std::string_view value);
+
+/**
+ * @brief Returns the request target of the endpoint under base, with a
+ *        value for each of its parameters. The parameter count is checked
+ *        at compile time.
+ */
+template <const std::string_view& Pattern, typename... Values>
+std::string buildTarget(const TargetBase& base, const Values&... values) {
+  static_assert(
+      endpointTemplate<Pattern>.parameterCount() == sizeof...(Values),
+      "wrong number of values for the endpoint's parameters");
+  std::string target;
+  endpointTemplate<Pattern>.expandInto(target, base,
+                                       {std::string_view(values)...});
+  return target;
+}
+template <const std::string_view& Pattern, typename... Values>
+std::string buildTarget(std::string_view basePath, const Values&... values) {
+  return buildTarget<Pattern>(TargetBase{basePath, {}}, values...);
+}
+
+}  // namespace utils
+}  // namespace outline
+
+#endif  // OUTLINE_UTILS_ENDPOINT_TEMPLATE_H
@@ -0,0 +1,109 @@
+#ifndef OUTLINE_UTILS_JSON_ARENA_H
+#define OUTLINE_UTILS_JSON_ARENA_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <boost/json.hpp>
+
+namespace outline {
+namespace utils {
+
+/**
+ * @brief Monotonic arena for the JSON of one request.
+ *
+ * Documents parsed or built with storage() live in a preallocated buffer, so
+ * a parse-and-respond cycle doesn't go through the heap unless the buffer
+ * overflows. reset() frees everything at once and keeps the buffer.
+ */
+class JsonArena {
+ public:
+  explicit JsonArena(std::size_t size);
+
+  JsonArena(const JsonArena&) = delete;
+  JsonArena& operator=(const JsonArena&) = delete;
+
+  boost::json::storage_ptr storage() { return &m_resource; }
+  /**
+   * @brief Parses the body into the arena.
+   * @throws OutlineParseException if the body isn't valid JSON.
+   */
+  boost::json::value parse(std::string_view body, std::string_view what);
+  /**
+   * @brief Frees everything allocated from the arena.
+   */
+  void reset();
+
+ private:
+  std::unique_ptr<unsigned char[]> m_buffer;
+  boost::json::monotonic_resource m_resource;
+  // Scratch space of the parser, reused between parses.
+  unsigned char m_parserBuffer[2048];
+  boost::json::parser m_parser;
+};
+
+/**
+ * @brief Free list of arenas shared by the requests of a client.
+ *
+ * An arena is taken for the duration of one request and recycled afterwards.
+ * A disabled pool hands out empty leases that parse on the default heap.
+ */
+class JsonArenaPool {
+ public:
+  // Called after every parse with its duration and whether it succeeded.
+  using ParseObserver =
+      std::function<void(std::chrono::steady_clock::duration, bool)>;
+
+  class Lease {
+   public:
+    Lease() = default;
+    Lease(Lease&& other) noexcept;
+    Lease& operator=(Lease&& other) noexcept;
+    ~Lease();
+
+    boost::json::storage_ptr storage() const;
+    boost::json::value parse(std::string_view body,
+                             std::string_view what) const;
+
+   private:
+    friend class JsonArenaPool;
+    Lease(JsonArenaPool* pool, std::unique_ptr<JsonArena> arena);
+
+    JsonArenaPool* m_pool = nullptr;
+    std::unique_ptr<JsonArena> m_arena;
+  };
+
+  /**
+   * @param arenaSize - initial buffer of every arena, 0 disables arenas.
+   * @param maxCached - how many idle arenas are kept for reuse.
+   */
+  JsonArenaPool(std::size_t arenaSize, std::size_t maxCached);
+
+  Lease acquire();
+  bool enabled() const { return m_arenaSize > 0; }
+  /**
+   * @brief Sets the observer of all parses; call before the first acquire().
+   */
+  void setParseObserver(ParseObserver observer) {
+    m_observer = std::move(observer);
+  }
+
+ private:
+  void recycle(std::unique_ptr<JsonArena> arena);
+
+  std::size_t m_arenaSize;
+  std::size_t m_maxCached;
+  ParseObserver m_observer;
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<JsonArena>> m_free;
+};
+
+}  // namespace utils
+}  // namespace outline
+
+#endif  // OUTLINE_UTILS_JSON_ARENA_H
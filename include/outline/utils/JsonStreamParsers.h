@@ -0,0 +1,74 @@
+#ifndef OUTLINE_UTILS_JSON_STREAM_PARSERS_H
+#define OUTLINE_UTILS_JSON_STREAM_PARSERS_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "outline/models/AccessKey.h"
+
+namespace outline {
+namespace utils {
+
+/**
+ * @brief Incremental parser of the /access-keys body.
+ *
+ * Body chunks can be written as they arrive; every complete element of
+ * "accessKeys" is passed to the callback right away, so memory use doesn't
+ * grow with the number of keys.
+ */
+class AccessKeyStreamParser {
+ public:
+  using Callback = std::function<void(AccessKey&&)>;
+
+  explicit AccessKeyStreamParser(Callback onAccessKey);
+  ~AccessKeyStreamParser();
+
+  /**
+   * @brief Feeds the next chunk of the body.
+   * @throws OutlineParseException if the body isn't valid JSON.
+   */
+  void write(std::string_view chunk);
+  /**
+   * @brief Signals the end of the body.
+   * @throws OutlineParseException if the body is incomplete.
+   */
+  void finish();
+  /**
+   * @brief Returns the number of access keys passed to the callback so far.
+   */
+  std::size_t count() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+/**
+ * @brief Incremental parser of the /metrics/transfer body.
+ *
+ * Every "bytesTransferredByUserId" entry is passed to the callback as soon
+ * as it has been parsed.
+ */
+class TransferMetricsStreamParser {
+ public:
+  using Callback = std::function<void(std::string_view accessKeyId,
+                                      std::uint64_t bytes)>;
+
+  explicit TransferMetricsStreamParser(Callback onBytes);
+  ~TransferMetricsStreamParser();
+
+  void write(std::string_view chunk);
+  void finish();
+  std::size_t count() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+}  // namespace utils
+}  // namespace outline
+
+#endif  // OUTLINE_UTILS_JSON_STREAM_PARSERS_H
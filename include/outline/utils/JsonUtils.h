@@ -0,0 +1,51 @@
+#ifndef OUTLINE_UTILS_JSON_UTILS_H
+#define OUTLINE_UTILS_JSON_UTILS_H
+
+#include <string>
+#include <string_view>
+
+#include <boost/json.hpp>
+
+#include "outline/exceptions/OutlineExceptions.h"
+
+namespace outline {
+namespace utils {
+
+/**
+ * @brief Parses a response body.
+ *
+ * @param body The JSON text.
+ * @param what What the body describes, used in the error message.
+ * @return The parsed document.
+ *
+ * @throws OutlineParseException if the body isn't valid JSON.
+ */
+boost::json::value parseJson(std::string_view body, std::string_view what);
+
+/**
+ * @brief Converts a parsed document into a typed result via value_to.
+ *
+ * @throws OutlineParseException if the document doesn't have the expected
+ *         structure.
+ */
+template <typename T>
+T jsonTo(const boost::json::value& value, std::string_view what) {
+  try {
+    return boost::json::value_to<T>(value);
+  } catch (const std::exception& e) {
+    throw OutlineParseException("Invalid JSON structure for " +
+                                std::string(what) + ": " + e.what());
+  }
+}
+
+/**
+ * @brief Returns the string member of the object or the fallback if it is
+ *        missing or not a string.
+ */
+std::string stringOr(const boost::json::object& obj, std::string_view key,
+                     std::string_view fallback = {});
+
+}  // namespace utils
+}  // namespace outline
+
+#endif  // OUTLINE_UTILS_JSON_UTILS_H
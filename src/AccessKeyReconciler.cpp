@@ -0,0 +1,107 @@
+#include "outline/AccessKeyReconciler.h"
+
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+namespace outline {
+
+AccessKeyReconciler::AccessKeyReconciler(const ReconcilerOptions& options)
+    : m_options(options) {}
+
+bool AccessKeyReconciler::resyncDue(Clock::time_point now) const {
+  return !m_lastResync || m_stale ||
+         now - *m_lastResync >= m_options.resyncInterval;
+}
+
+void AccessKeyReconciler::beginResync() {
+  m_incoming.clear();
+  m_incoming.reserve(m_snapshot.size());
+}
+
+void AccessKeyReconciler::update(AccessKey&& key) {
+  m_incoming.insert_or_assign(std::move(key.id),
+                              Entry{std::move(key.name), key.dataLimitBytes});
+}
+
+void AccessKeyReconciler::finishResync(Clock::time_point now) {
+  m_snapshot.swap(m_incoming);
+  m_incoming.clear();
+  m_lastResync = now;
+  m_stale = false;
+}
+
+std::vector<AccessKeyMutation> AccessKeyReconciler::plan(
+    const std::vector<DesiredAccessKey>& desired) const {
+  using Kind = AccessKeyMutation::Kind;
+  std::vector<AccessKeyMutation> mutations;
+  std::unordered_set<std::string_view> ids;
+  ids.reserve(desired.size());
+
+  for (const auto& key : desired) {
+    if (!ids.insert(key.id).second) {
+      throw std::invalid_argument("Duplicate access key id in desired set: " +
+                                  key.id);
+    }
+    auto it = m_snapshot.find(key.id);
+    if (it == m_snapshot.end()) {
+      mutations.push_back({Kind::Create, key.id, key.name, key.dataLimitBytes});
+      continue;
+    }
+    const Entry& current = it->second;
+    if (current.name != key.name)
+      mutations.push_back({Kind::Rename, key.id, key.name, std::nullopt});
+    if (current.dataLimitBytes != key.dataLimitBytes) {
+      if (key.dataLimitBytes) {
+        mutations.push_back(
+            {Kind::SetDataLimit, key.id, {}, key.dataLimitBytes});
+      } else {
+        mutations.push_back({Kind::RemoveDataLimit, key.id, {}, std::nullopt});
+      }
+    }
+  }
+
+  if (m_options.deleteUnlisted) {
+    for (const auto& [id, entry] : m_snapshot) {
+      if (!ids.count(id))
+        mutations.push_back({Kind::Delete, id, {}, std::nullopt});
+    }
+  }
+  return mutations;
+}
+
+void AccessKeyReconciler::commit(
+    const std::vector<AccessKeyMutation>& mutations,
+    const BatchResult<void>& results) {
+  using Kind = AccessKeyMutation::Kind;
+  for (std::size_t i = 0; i < mutations.size(); ++i) {
+    if (i >= results.size() || !results[i].ok()) {
+      m_stale = true;
+      continue;
+    }
+    const auto& mutation = mutations[i];
+    switch (mutation.kind) {
+      case Kind::Create:
+        m_snapshot.insert_or_assign(
+            mutation.accessKeyId,
+            Entry{mutation.name, mutation.dataLimitBytes});
+        break;
+      case Kind::Rename:
+        m_snapshot[mutation.accessKeyId].name = mutation.name;
+        break;
+      case Kind::SetDataLimit:
+        m_snapshot[mutation.accessKeyId].dataLimitBytes =
+            mutation.dataLimitBytes;
+        break;
+      case Kind::RemoveDataLimit:
+        m_snapshot[mutation.accessKeyId].dataLimitBytes.reset();
+        break;
+      case Kind::Delete:
+        m_snapshot.erase(mutation.accessKeyId);
+        break;
+    }
+  }
+}
+
+}  // namespace outline
@@ -0,0 +1,150 @@
+#include "outline/AccessKeySnapshot.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+namespace outline {
+
+namespace {
+
+constexpr std::size_t kMinCapacity = 16;
+
+// Smallest power of two keeping `keys` below a 70% load.
+std::size_t capacityFor(std::size_t keys) {
+  std::size_t capacity = kMinCapacity;
+  while (keys * 10 >= capacity * 7)
+    capacity *= 2;
+  return capacity;
+}
+
+}  // namespace
+
+AccessKeySnapshot::AccessKeySnapshot(std::size_t expectedKeys)
+    : m_index(capacityFor(expectedKeys), npos) {
+  m_ids.reserve(expectedKeys);
+  m_names.reserve(expectedKeys);
+  m_ports.reserve(expectedKeys);
+  m_dataLimits.reserve(expectedKeys);
+  m_bytes.reserve(expectedKeys);
+}
+
+AccessKeySnapshot::Row AccessKeySnapshot::add(const AccessKey& key) {
+  if ((size() + 1) * 10 >= m_index.size() * 7)
+    grow();
+  std::size_t slot = slotOf(key.id);
+  const std::int64_t limit = key.dataLimitBytes.value_or(kNoLimit);
+  const auto port = static_cast<std::uint16_t>(key.port);
+  if (Row row = m_index[slot]; row != npos) {
+    // The old name stays in the buffer until clear().
+    if (name(row) != key.name)
+      m_names[row] = append(key.name);
+    m_ports[row] = port;
+    m_dataLimits[row] = limit;
+    return row;
+  }
+
+  const auto row = static_cast<Row>(size());
+  m_index[slot] = row;
+  m_ids.push_back(append(key.id));
+  m_names.push_back(append(key.name));
+  m_ports.push_back(port);
+  m_dataLimits.push_back(limit);
+  m_bytes.push_back(0);
+  return row;
+}
+
+bool AccessKeySnapshot::setBytes(std::string_view accessKeyId,
+                                 std::uint64_t bytes) {
+  Row row = find(accessKeyId);
+  if (row == npos) {
+    m_unmatchedBytes += bytes;
+    return false;
+  }
+  m_bytes[row] = bytes;
+  return true;
+}
+
+void AccessKeySnapshot::clear() {
+  m_text.clear();
+  m_ids.clear();
+  m_names.clear();
+  m_ports.clear();
+  m_dataLimits.clear();
+  m_bytes.clear();
+  std::fill(m_index.begin(), m_index.end(), npos);
+  m_unmatchedBytes = 0;
+}
+
+AccessKeySnapshot::Row AccessKeySnapshot::find(
+    std::string_view accessKeyId) const {
+  return m_index[slotOf(accessKeyId)];
+}
+
+std::uint64_t AccessKeySnapshot::totalBytes() const {
+  return std::accumulate(m_bytes.begin(), m_bytes.end(), std::uint64_t{0});
+}
+
+std::vector<AccessKeySnapshot::Row> AccessKeySnapshot::topUsage(
+    std::size_t n) const {
+  std::vector<Row> rows(size());
+  std::iota(rows.begin(), rows.end(), Row{0});
+  n = std::min(n, rows.size());
+  auto more = [this](Row a, Row b) {
+    return m_bytes[a] != m_bytes[b] ? m_bytes[a] > m_bytes[b] : a < b;
+  };
+  std::partial_sort(rows.begin(), rows.begin() + n, rows.end(), more);
+  rows.resize(n);
+  return rows;
+}
+
+std::vector<AccessKeySnapshot::Row> AccessKeySnapshot::overLimit(
+    double ratio) const {
+  // A branch-free pass over the two columns first, so the compare
+  // vectorizes; only the hits are then collected.
+  const std::size_t count = size();
+  std::vector<std::uint8_t> hit(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const double threshold = static_cast<double>(m_dataLimits[i]) * ratio;
+    hit[i] = (m_dataLimits[i] != kNoLimit) &
+             (static_cast<double>(m_bytes[i]) >= threshold);
+  }
+  std::vector<Row> rows;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (hit[i])
+      rows.push_back(static_cast<Row>(i));
+  }
+  return rows;
+}
+
+AccessKeySnapshot::TextRef AccessKeySnapshot::append(std::string_view value) {
+  TextRef ref{static_cast<std::uint32_t>(m_text.size()),
+              static_cast<std::uint32_t>(value.size())};
+  m_text.append(value);
+  return ref;
+}
+
+std::size_t AccessKeySnapshot::slotOf(std::string_view accessKeyId) const {
+  const std::size_t mask = m_index.size() - 1;
+  std::size_t i = std::hash<std::string_view>{}(accessKeyId) & mask;
+  while (m_index[i] != npos && id(m_index[i]) != accessKeyId)
+    i = (i + 1) & mask;
+  return i;
+}
+
+void AccessKeySnapshot::grow() {
+  m_index.assign(m_index.size() * 2, npos);
+  indexRows();
+}
+
+void AccessKeySnapshot::reindex() {
+  m_index.assign(capacityFor(size()), npos);
+  indexRows();
+}
+
+void AccessKeySnapshot::indexRows() {
+  for (Row row = 0; row < size(); ++row)
+    m_index[slotOf(id(row))] = row;
+}
+
+}  // namespace outline
@@ -0,0 +1,125 @@
+#include "outline/MetricsDeltaEngine.h"
+
+#include <functional>
+#include <utility>
+
+namespace outline {
+
+namespace {
+
+constexpr std::size_t kMinCapacity = 16;
+
+// Smallest power of two keeping `keys` below a 70% load.
+std::size_t capacityFor(std::size_t keys) {
+  std::size_t capacity = kMinCapacity;
+  while (keys * 10 >= capacity * 7)
+    capacity *= 2;
+  return capacity;
+}
+
+}  // namespace
+
+MetricsDeltaEngine::MetricsDeltaEngine(std::size_t expectedKeys)
+    : m_slots(capacityFor(expectedKeys)) {}
+
+void MetricsDeltaEngine::begin(Clock::time_point now) {
+  m_report = MetricsDeltaReport{};
+  m_report.baseline = !m_lastPoll;
+  if (m_lastPoll)
+    m_report.interval = now - *m_lastPoll;
+  m_currentPoll = now;
+  ++m_poll;
+  m_seen = 0;
+}
+
+void MetricsDeltaEngine::update(std::string_view accessKeyId,
+                                std::uint64_t bytes) {
+  if ((m_size + 1) * 10 >= m_slots.size() * 7)
+    grow();
+  Slot& slot = m_slots[find(accessKeyId)];
+
+  MetricsDelta delta;
+  const bool added = slot.poll == 0;
+  if (added) {
+    slot.accessKeyId = accessKeyId;
+    ++m_size;
+    delta.deltaBytes = bytes;
+  } else if (slot.poll == m_poll) {
+    // Repeated in the same poll: the last value wins.
+    slot.bytes = bytes;
+    return;
+  } else if (bytes >= slot.bytes) {
+    delta.deltaBytes = bytes - slot.bytes;
+  } else {
+    delta.deltaBytes = bytes;
+    delta.reset = true;
+  }
+  slot.bytes = bytes;
+  slot.poll = m_poll;
+  ++m_seen;
+
+  if (m_report.baseline || (delta.deltaBytes == 0 && !added))
+    return;
+  delta.accessKeyId = slot.accessKeyId;
+  delta.bytes = bytes;
+  double seconds = m_report.interval.count();
+  if (seconds > 0)
+    delta.bytesPerSecond = static_cast<double>(delta.deltaBytes) / seconds;
+  m_report.changed.push_back(std::move(delta));
+}
+
+MetricsDeltaReport MetricsDeltaEngine::finish() {
+  // Only scan the table when some keys weren't reported this time.
+  if (m_seen < m_size) {
+    for (const Slot& slot : m_slots) {
+      if (slot.poll != 0 && slot.poll != m_poll)
+        m_report.removed.push_back(slot.accessKeyId);
+    }
+    rehash(m_slots.size(), m_poll);
+  }
+  m_lastPoll = m_currentPoll;
+  return std::move(m_report);
+}
+
+std::optional<std::uint64_t> MetricsDeltaEngine::bytes(
+    std::string_view accessKeyId) const {
+  const Slot& slot = m_slots[find(accessKeyId)];
+  if (slot.poll == 0)
+    return std::nullopt;
+  return slot.bytes;
+}
+
+void MetricsDeltaEngine::clear() {
+  m_slots.assign(m_slots.size(), Slot{});
+  m_size = 0;
+  m_seen = 0;
+  m_lastPoll.reset();
+}
+
+std::size_t MetricsDeltaEngine::find(std::string_view accessKeyId) const {
+  const std::size_t mask = m_slots.size() - 1;
+  std::size_t i = std::hash<std::string_view>{}(accessKeyId) & mask;
+  while (m_slots[i].poll != 0 && m_slots[i].accessKeyId != accessKeyId)
+    i = (i + 1) & mask;
+  return i;
+}
+
+void MetricsDeltaEngine::grow() {
+  rehash(m_slots.size() * 2, 1);
+}
+
+// Moves the keys last reported in minPoll or later into a table of the given
+// capacity and drops all others.
+void MetricsDeltaEngine::rehash(std::size_t capacity, std::uint32_t minPoll) {
+  std::vector<Slot> old(capacity);
+  old.swap(m_slots);
+  m_size = 0;
+  for (Slot& slot : old) {
+    if (slot.poll == 0 || slot.poll < minPoll)
+      continue;
+    m_slots[find(slot.accessKeyId)] = std::move(slot);
+    ++m_size;
+  }
+}
+
+}  // namespace outline
@@ -17,6 +17,7 @@
 #include <boost/system/error_code.hpp>
 #include <boost/url.hpp>
 
+#include <algorithm>
 #include <coroutine>
 #include <future>
 
@@ -25,27 +26,289 @@ using tcp = boost::asio::ip::tcp;
 namespace http = boost::beast::http;
 namespace ssl = boost::asio::ssl;
 
+OutlineClientResources OutlineClientResources::create(
+    const OutlineClientOptions& options,
+    boost::asio::any_io_executor executor) {
+  OutlineClientResources resources;
+  resources.executor = std::move(executor);
+  resources.sslContext =
+      std::make_shared<ssl::context>(ssl::context::sslv23_client);
+  // Servers are checked by their pinned fingerprint, per connection, so the
+  // system CA store is never loaded.
+  resources.sslContext->set_verify_mode(ssl::verify_none);
+  resources.pool = network::ConnectionPool::create(options.pool);
+  if (options.tlsSessionResumption) {
+    resources.sessionCache =
+        std::make_shared<network::TlsSessionCache>(*resources.sslContext);
+  }
+  resources.resolverCache = network::ResolverCache::create(options.resolver);
+  resources.circuitBreaker = std::make_shared<network::CircuitBreaker>(
+      options.retry.breakerThreshold, options.retry.breakerOpenTime);
+  resources.limiter = network::RequestLimiter::create(options.limiter);
+  return resources;
+}
+
 OutlineClient::OutlineClient(std::string_view apiUrl, std::string_view cert,
-                             int timeout)
+                             int timeout, const OutlineClientOptions& options)
+    : OutlineClient(apiUrl, cert, timeout, options, OutlineClientResources{}) {
+}
+
+OutlineClient::OutlineClient(std::string_view apiUrl, std::string_view cert,
+                             int timeout, const OutlineClientOptions& options,
+                             OutlineClientResources resources)
     : m_cert(cert),
       m_timeout(timeout),
-      m_sslContext(ssl::context::sslv23_client),
-      m_workGuard(boost::asio::make_work_guard(m_ioContext)) {
+      m_timeouts(options.timeouts),
+      m_pipelineDepth(options.pipelineDepth),
+      m_jsonArenas(options.jsonArenaSize, options.pool.maxPerHost),
+      m_retry(options.retry),
+      m_retryBudget(options.retry.budgetTokens, options.retry.budgetRatio),
+      m_hedge(options.hedge),
+      m_hedgeBudget(options.hedge.budgetTokens, options.hedge.budgetRatio),
+      m_acceptCompression(options.acceptCompression),
+      m_userAgent(options.userAgent),
+      m_tracer(options.tracer),
+      m_cache(options.cache) {
   try {
     m_apiUrl = boost::urls::parse_uri(apiUrl).value();
+    m_basePath = m_apiUrl.encoded_path();
+    m_baseQuery = m_apiUrl.encoded_query();
   } catch (const std::exception& e) {
     throw OutlineParseException(std::string("Unable to parse API URL: ") +
                                 e.what());
   }
-  m_sslContext.set_verify_mode(ssl::verify_none);
-  m_sslContext.set_default_verify_paths();
-  m_ioThread = std::thread([this]() { m_ioContext.run(); });
+  if (!m_cert.empty()) {
+    m_pin = network::parseFingerprint(m_cert);
+    if (!m_pin)
+      throw OutlineParseException("Invalid certificate fingerprint: " +
+                                  m_cert);
+  }
+  std::chrono::milliseconds phaseDefault = std::chrono::seconds(m_timeout);
+  for (auto* phase : {&m_timeouts.resolve, &m_timeouts.connect,
+                      &m_timeouts.handshake, &m_timeouts.write,
+                      &m_timeouts.read}) {
+    if (!*phase)
+      *phase = phaseDefault;
+  }
+
+  m_sharedResources = resources.sslContext != nullptr;
+  if (!m_sharedResources) {
+    boost::asio::any_io_executor executor;
+    if (options.executor) {
+      executor = *options.executor;
+    } else {
+      std::size_t threads = std::max<std::size_t>(1, options.ioThreads);
+      m_ioContext =
+          std::make_unique<boost::asio::io_context>(static_cast<int>(threads));
+      m_workGuard.emplace(boost::asio::make_work_guard(*m_ioContext));
+      executor = m_ioContext->get_executor();
+      m_ioThreads.reserve(threads);
+      for (std::size_t i = 0; i < threads; ++i)
+        m_ioThreads.emplace_back([this]() { m_ioContext->run(); });
+    }
+    resources = OutlineClientResources::create(options, std::move(executor));
+  }
+  m_executor = std::move(resources.executor);
+  m_sslContext = std::move(resources.sslContext);
+  m_pool = std::move(resources.pool);
+  m_sessionCache = std::move(resources.sessionCache);
+  m_resolverCache = std::move(resources.resolverCache);
+  m_circuitBreaker = std::move(resources.circuitBreaker);
+  m_limiter = std::move(resources.limiter);
+
+  m_jsonArenas.setParseObserver(
+      [this](std::chrono::steady_clock::duration duration, bool ok) {
+        m_instrumentation.recordPhase(network::Phase::Parse, duration);
+        if (!ok)
+          m_instrumentation.recordError(network::ErrorClass::Parse);
+        network::TraceSpan::completed("parse", duration,
+                                      ok ? "" : "Invalid JSON");
+      });
+
+  // Polls are not part of the constructing caller's trace or scope, and
+  // yield to every other request.
+  m_metricsPoller = network::PeriodicPoller<TransferMetrics>::create(
+      makeRequestExecutor(false, network::RequestPriority::Polling),
+      [this]() { return backgroundAsync(requestMetricsTypedAsync()); });
+  m_serverInfoPoller = network::PeriodicPoller<ServerInfo>::create(
+      makeRequestExecutor(false, network::RequestPriority::Polling),
+      [this]() { return backgroundAsync(requestServerInformationTypedAsync()); });
+
+  m_snapshotPath = options.snapshotCachePath;
+  if (!m_snapshotPath.empty()) {
+    // An unreadable file only means a cold start.
+    try {
+      auto loaded =
+          SnapshotFile::load(m_snapshotPath, std::string(m_apiUrl.buffer()));
+      if (loaded)
+        m_snapshot = std::make_shared<ServerSnapshot>(std::move(*loaded));
+    } catch (const std::exception&) {
+    }
+    // Counted by the shutdown gate, so the destructor waits for it.
+    refreshSnapshot(boost::asio::detached);
+  }
 }
 
 OutlineClient::~OutlineClient() {
+  m_metricsPoller->stop();
+  m_serverInfoPoller->stop();
+  // Make the requests still running fail now and wait until they are done
+  // with the client, the snapshot refresh of the constructor included; a
+  // frame left in a stopped loop would outlive the members it uses.
+  m_shutdown.close();
+  m_shutdown.cancel();
+  m_shutdown.wait();
+  if (m_ioContext) {
+    m_workGuard.reset();
+    m_ioContext->stop();
+    for (auto& thread : m_ioThreads) {
+      if (thread.joinable())
+        thread.join();
+    }
+  }
+  // A shared pool also holds connections of the other clients.
+  if (!m_sharedResources)
+    m_pool->clear();
+}
+
+std::future<void> OutlineClient::shutdownAsync(
+    std::chrono::milliseconds deadline) {
+  if (!m_shutdown.close()) {
+    std::promise<void> done;
+    done.set_value();
+    return done.get_future();
+  }
+  m_metricsPoller->stop();
+  m_serverInfoPoller->stop();
+  return boost::asio::co_spawn(
+      boost::asio::make_strand(m_executor),
+      requestShutdownAsync(std::chrono::steady_clock::now() + deadline),
+      boost::asio::use_future);
+}
+
+void OutlineClient::shutdown(std::chrono::milliseconds deadline) {
+  shutdownAsync(deadline).get();
+}
+
+boost::asio::awaitable<void> OutlineClient::requestShutdownAsync(
+    std::chrono::steady_clock::time_point deadline) {
+  if (!co_await m_shutdown.drainAsync(deadline)) {
+    // Closing the stragglers' connections makes them fail now instead of
+    // at their phase timeouts.
+    m_shutdown.cancel();
+    co_await m_shutdown.drainAsync(
+        std::chrono::steady_clock::time_point::max());
+  }
+  // A shared pool also holds connections of the other clients.
+  if (!m_sharedResources)
+    co_await m_pool->closeAsync(*m_timeouts.write);
+  // The own io threads return once the work left is done.
   m_workGuard.reset();
-  m_ioContext.stop();
-  if (m_ioThread.joinable())
-    m_ioThread.join();
+}
+
+boost::asio::any_io_executor OutlineClient::makeRequestExecutor(
+    bool fromCaller, network::RequestPriority priority,
+    std::shared_ptr<network::CancellationSignal> cancellation) const {
+  boost::asio::any_io_executor executor = boost::asio::make_strand(m_executor);
+#ifndef OUTLINE_DISABLE_TRACING
+  if (m_tracer) {
+    auto caller = fromCaller ? m_tracer->activeSpan() : nullptr;
+    executor = network::TracingExecutor(
+        std::move(executor),
+        std::make_shared<network::TraceContext>(m_tracer, std::move(caller)));
+  }
+#endif
+  if (const auto* scope = fromCaller ? network::RequestContext::active()
+                                     : nullptr) {
+    priority = scope->priority.value_or(priority);
+    if (!cancellation)
+      cancellation = scope->cancellation;
+  }
+  if (priority != network::RequestPriority::Interactive || cancellation) {
+    executor = network::ContextExecutor<network::RequestContext>(
+        std::move(executor),
+        std::make_shared<network::RequestContext>(
+            network::RequestContext{priority, std::move(cancellation)}));
+  }
+  return executor;
+}
+
+std::uint64_t OutlineClient::subscribeMetrics(
+    std::function<void(std::shared_ptr<const TransferMetrics>,
+                       std::exception_ptr)>
+        onMetrics,
+    const network::PollOptions& options) {
+  std::uint64_t id = m_nextSubscriptionId++;
+  if (!m_metricsPoller->subscribe(id, std::move(onMetrics), options))
+    throw OutlineShutdownException("Client is shut down");
+  return id;
+}
+
+std::uint64_t OutlineClient::subscribeServerInformation(
+    std::function<void(std::shared_ptr<const ServerInfo>, std::exception_ptr)>
+        onServerInfo,
+    const network::PollOptions& options) {
+  std::uint64_t id = m_nextSubscriptionId++;
+  if (!m_serverInfoPoller->subscribe(id, std::move(onServerInfo), options))
+    throw OutlineShutdownException("Client is shut down");
+  return id;
+}
+
+bool OutlineClient::unsubscribe(std::uint64_t subscriptionId) {
+  return m_metricsPoller->unsubscribe(subscriptionId) ||
+         m_serverInfoPoller->unsubscribe(subscriptionId);
+}
+
+network::TlsSessionStats OutlineClient::getTlsSessionStats() const {
+  return m_sessionCache ? m_sessionCache->stats() : network::TlsSessionStats{};
+}
+
+network::ResponseCacheStats OutlineClient::getCacheStats() const {
+  return m_cache.stats();
+}
+
+network::InstrumentationSnapshot OutlineClient::getInstrumentation() const {
+  return m_instrumentation.snapshot();
+}
+
+void OutlineClient::clearCache() {
+  m_cache.clear();
+}
+
+std::shared_ptr<const ServerSnapshot> OutlineClient::cachedSnapshot() const {
+  std::lock_guard lock(m_snapshotMutex);
+  return m_snapshot;
+}
+
+std::future<std::shared_ptr<const ServerSnapshot>>
+OutlineClient::refreshSnapshotAsync() {
+  return refreshSnapshot(boost::asio::use_future);
+}
+
+std::shared_ptr<const ServerSnapshot> OutlineClient::refreshSnapshot() {
+  return refreshSnapshotAsync().get();
+}
+
+boost::asio::awaitable<std::shared_ptr<const ServerSnapshot>>
+OutlineClient::requestRefreshSnapshotAsync() {
+  auto snapshot = std::make_shared<ServerSnapshot>();
+  snapshot->fetchedAt = std::chrono::system_clock::now();
+  snapshot->serverInfo = co_await requestServerInformationTypedAsync();
+  auto previous = cachedSnapshot();
+  snapshot->accessKeys = co_await requestAccessKeySnapshotAsync(
+      previous ? previous->accessKeys.size() : 0);
+  {
+    // A refresh that started earlier but finished later is dropped.
+    std::lock_guard lock(m_snapshotMutex);
+    if (m_snapshot && m_snapshot->fetchedAt > snapshot->fetchedAt)
+      co_return m_snapshot;
+    m_snapshot = snapshot;
+  }
+  if (!m_snapshotPath.empty()) {
+    std::lock_guard lock(m_snapshotFileMutex);
+    SnapshotFile::save(m_snapshotPath, std::string(m_apiUrl.buffer()),
+                       *snapshot);
+  }
+  co_return snapshot;
 }
 }  // namespace outline
@@ -1,248 +1,336 @@
 #include "outline/OutlineClient.h"
 #include "outline/constants/ApiEndpoint.h"
 #include "outline/exceptions/OutlineExceptions.h"
-#include "outline/utils/UrlUtils.h"
+#include "outline/utils/JsonStreamParsers.h"
+#include "outline/utils/JsonUtils.h"
 
 #include <boost/json.hpp>
 #include <future>
-#include <map>
 #include <string>
+#include <vector>
 
 namespace outline {
 
-std::future<std::string> OutlineClient::getAccessKeysAsync() {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this]() -> boost::asio::awaitable<std::string> {
-        auto url = utils::appendUrl(m_apiUrl,
-                                    std::string(api::Endpoints::GetAccessKeys));
-        auto [status, body] = co_await doGetAsync(url);
+namespace {
+
+// CreateAccessKeyParams and UpdateAccessKeyParams share the same fields.
+template <typename Params>
+std::string serializeAccessKeyParams(const Params& params,
+                                     boost::json::storage_ptr storage) {
+  boost::json::object keyObj(storage);
+  if (params.name)
+    keyObj["name"] = params.name.value();
+  if (params.password)
+    keyObj["password"] = params.password.value();
+  if (params.method)
+    keyObj["method"] = params.method.value();
+  if (params.data_limit_bytes) {
+    boost::json::object dataLimitObj(storage);
+    dataLimitObj["bytes"] = params.data_limit_bytes.value();
+    keyObj["limit"] = std::move(dataLimitObj);
+  }
+  return boost::json::serialize(keyObj);
+}
+
+}  // namespace
+
+boost::asio::awaitable<std::shared_ptr<const std::string>>
+OutlineClient::requestAccessKeysSharedAsync() {
+  co_return co_await cachedGetAsync(
+      "access-keys",
+      [this]() -> boost::asio::awaitable<std::shared_ptr<const std::string>> {
+        auto [status, body] =
+            co_await doGetAsync(targetOf<api::Endpoints::GetAccessKeys>());
         if (status != 200) {
           throw OutlineServerErrorException(
               "Unable to get access keys (status=" + std::to_string(status) +
               ")");
         }
-        boost::json::value keysVal;
-        try {
-          keysVal = boost::json::parse(body);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for access keys: ") + e.what());
-        }
-        co_return boost::json::serialize(keysVal);
-      },
-      boost::asio::use_future);
+        co_return std::make_shared<const std::string>(std::move(body));
+      });
 }
 
-std::future<std::string> OutlineClient::getAccessKeyAsync(
-    const std::string& accessKeyId) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, accessKeyId]() -> boost::asio::awaitable<std::string> {
-        std::map<std::string, std::string> placeholders{{"keyId", accessKeyId}};
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            utils::replacePlaceholders(
-                std::string(api::Endpoints::GetAccessKeyById), placeholders));
-        auto [status, body] = co_await doGetAsync(url);
+boost::asio::awaitable<std::string> OutlineClient::requestAccessKeysAsync() {
+  co_return *co_await requestAccessKeysSharedAsync();
+}
+
+boost::asio::awaitable<std::vector<AccessKey>>
+OutlineClient::requestAccessKeysTypedAsync() {
+  auto body = co_await requestAccessKeysSharedAsync();
+  auto arena = m_jsonArenas.acquire();
+  auto keysVal = arena.parse(*body, "access keys");
+  const auto* keys = keysVal.is_object()
+                         ? keysVal.as_object().if_contains("accessKeys")
+                         : nullptr;
+  if (!keys) {
+    throw OutlineParseException("Invalid JSON structure for access keys.");
+  }
+  co_return utils::jsonTo<std::vector<AccessKey>>(*keys, "access keys");
+}
+
+boost::asio::awaitable<std::string> OutlineClient::requestAccessKeyAsync(
+    std::string accessKeyId) {
+  auto body = co_await cachedGetAsync(
+      "access-keys/" + accessKeyId,
+      [this, accessKeyId]()
+          -> boost::asio::awaitable<std::shared_ptr<const std::string>> {
+        auto [status, body] = co_await doGetAsync(
+            targetOf<api::Endpoints::GetAccessKeyById>(accessKeyId));
         if (status != 200) {
           throw OutlineServerErrorException(
               "Unable to get access key (status=" + std::to_string(status) +
               ")");
         }
-        boost::json::value keyVal;
-        try {
-          keyVal = boost::json::parse(body);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for access key: ") + e.what());
-        }
-        co_return boost::json::serialize(keyVal);
-      },
-      boost::asio::use_future);
+        co_return std::make_shared<const std::string>(std::move(body));
+      });
+  co_return *body;
+}
+
+boost::asio::awaitable<std::string> OutlineClient::requestCreateAccessKeyAsync(
+    CreateAccessKeyParams params) {
+  auto arena = m_jsonArenas.acquire();
+  auto [status, responseBody] =
+      co_await doPostAsync(targetOf<api::Endpoints::CreateAccessKey>(),
+                           serializeAccessKeyParams(params, arena.storage()));
+  m_cache.invalidate("access-keys");
+  if (status != 201) {
+    throw OutlineServerErrorException(
+        "Unable to create access key (status=" + std::to_string(status) + ")");
+  }
+  co_return std::move(responseBody);
+}
+
+boost::asio::awaitable<void> OutlineClient::requestDeleteAccessKeyAsync(
+    std::string accessKeyId) {
+  int status = co_await doDeleteStatusAsync(
+      targetOf<api::Endpoints::DeleteAccessKey>(accessKeyId));
+  invalidateAccessKey(accessKeyId);
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to delete access key (status=" + std::to_string(status) + ")");
+  }
+}
+
+boost::asio::awaitable<void> OutlineClient::requestAddDataLimitAsync(
+    std::string accessKeyId, int dataLimitBytes) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object dataLimitObj({{"bytes", dataLimitBytes}},
+                                   arena.storage());
+  int status = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::AddDataLimit>(accessKeyId),
+      boost::json::serialize(dataLimitObj));
+  invalidateAccessKey(accessKeyId);
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to add data limit (status=" + std::to_string(status) + ")");
+  }
+}
+
+boost::asio::awaitable<std::size_t>
+OutlineClient::requestStreamAccessKeysAsync(
+    std::function<void(AccessKey&&)> onAccessKey) {
+  utils::AccessKeyStreamParser parser(std::move(onAccessKey));
+  int status = co_await doGetStreamingAsync(
+      targetOf<api::Endpoints::GetAccessKeys>(),
+      [&parser](std::string_view chunk) { parser.write(chunk); });
+  if (status != 200) {
+    throw OutlineServerErrorException(
+        "Unable to get access keys (status=" + std::to_string(status) + ")");
+  }
+  parser.finish();
+  co_return parser.count();
+}
+
+// The metrics are fetched after the keys so that each entry lands straight
+// in its key's row.
+boost::asio::awaitable<AccessKeySnapshot>
+OutlineClient::requestAccessKeySnapshotAsync(std::size_t expectedKeys) {
+  AccessKeySnapshot snapshot(expectedKeys);
+  co_await requestStreamAccessKeysAsync(
+      [&snapshot](AccessKey&& key) { snapshot.add(key); });
+  co_await requestMetricsStreamAsync(
+      [&snapshot](std::string_view accessKeyId, std::uint64_t bytes) {
+        snapshot.setBytes(accessKeyId, bytes);
+      });
+  co_return snapshot;
+}
+
+boost::asio::awaitable<AccessKey> OutlineClient::requestAccessKeyTypedAsync(
+    std::string accessKeyId) {
+  auto body = co_await requestAccessKeyAsync(std::move(accessKeyId));
+  auto arena = m_jsonArenas.acquire();
+  co_return utils::jsonTo<AccessKey>(arena.parse(body, "access key"),
+                                     "access key");
+}
+
+boost::asio::awaitable<AccessKey>
+OutlineClient::requestCreateAccessKeyTypedAsync(CreateAccessKeyParams params) {
+  auto body = co_await requestCreateAccessKeyAsync(std::move(params));
+  auto arena = m_jsonArenas.acquire();
+  co_return utils::jsonTo<AccessKey>(arena.parse(body, "access key creation"),
+                                     "access key");
+}
+
+boost::asio::awaitable<std::string> OutlineClient::requestUpdateAccessKeyAsync(
+    std::string accessKeyId, UpdateAccessKeyParams params) {
+  auto arena = m_jsonArenas.acquire();
+  auto [status, responseBody] = co_await doPutAsync(
+      targetOf<api::Endpoints::UpdateAccessKey>(accessKeyId),
+      serializeAccessKeyParams(params, arena.storage()));
+  invalidateAccessKey(accessKeyId);
+  if (status != 201) {
+    throw OutlineServerErrorException(
+        "Unable to update access key (status=" + std::to_string(status) + ")");
+  }
+  arena.parse(responseBody, "access key update");
+  co_return std::move(responseBody);
+}
+
+boost::asio::awaitable<void> OutlineClient::requestRenameAccessKeyAsync(
+    std::string accessKeyId, std::string newName) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object keyObj({{"name", newName}}, arena.storage());
+  int status = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::RenameAccessKey>(accessKeyId),
+      boost::json::serialize(keyObj));
+  invalidateAccessKey(accessKeyId);
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to rename access key (status=" + std::to_string(status) + ")");
+  }
+}
+
+boost::asio::awaitable<void> OutlineClient::requestDeleteDataLimitAsync(
+    std::string accessKeyId) {
+  int status = co_await doDeleteStatusAsync(
+      targetOf<api::Endpoints::DeleteDataLimit>(accessKeyId));
+  invalidateAccessKey(accessKeyId);
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to delete data limit (status=" + std::to_string(status) + ")");
+  }
+}
+
+std::future<std::string> OutlineClient::getAccessKeysAsync() {
+  return getAccessKeys(boost::asio::use_future);
+}
+
+std::future<std::string> OutlineClient::getAccessKeysRawAsync() {
+  return getAccessKeysRaw(boost::asio::use_future);
+}
+
+std::future<std::vector<AccessKey>> OutlineClient::getAccessKeysTypedAsync() {
+  return getAccessKeysTyped(boost::asio::use_future);
+}
+
+std::future<std::size_t> OutlineClient::streamAccessKeysAsync(
+    std::function<void(AccessKey&&)> onAccessKey) {
+  return streamAccessKeys(std::move(onAccessKey), boost::asio::use_future);
+}
+
+std::future<AccessKeySnapshot> OutlineClient::getAccessKeySnapshotAsync(
+    std::size_t expectedKeys) {
+  return getAccessKeySnapshot(expectedKeys, boost::asio::use_future);
+}
+
+std::future<std::string> OutlineClient::getAccessKeyAsync(
+    const std::string& accessKeyId) {
+  return getAccessKey(accessKeyId, boost::asio::use_future);
+}
+
+std::future<std::string> OutlineClient::getAccessKeyRawAsync(
+    const std::string& accessKeyId) {
+  return getAccessKeyRaw(accessKeyId, boost::asio::use_future);
+}
+
+std::future<AccessKey> OutlineClient::getAccessKeyTypedAsync(
+    const std::string& accessKeyId) {
+  return getAccessKeyTyped(accessKeyId, boost::asio::use_future);
 }
 
 std::future<std::string> OutlineClient::createAccessKeyAsync(
     const CreateAccessKeyParams& params) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, params]() -> boost::asio::awaitable<std::string> {
-        auto url = utils::appendUrl(
-            m_apiUrl, std::string(api::Endpoints::CreateAccessKey));
-        boost::json::object keyObj;
-        if (params.name)
-          keyObj["name"] = params.name.value();
-        if (params.password)
-          keyObj["password"] = params.password.value();
-        if (params.method)
-          keyObj["method"] = params.method.value();
-        if (params.data_limit_bytes) {
-          boost::json::object dataLimitObj{
-              {"bytes", params.data_limit_bytes.value()}};
-          keyObj["limit"] = dataLimitObj;
-        }
-        auto [status, responseBody] =
-            co_await doPostAsync(url, boost::json::serialize(keyObj));
-        if (status != 201) {
-          throw OutlineServerErrorException(
-              "Unable to create access key (status=" + std::to_string(status) +
-              ")");
-        }
-        boost::json::value keyVal;
-        try {
-          keyVal = boost::json::parse(responseBody);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for access key creation: ") +
-              e.what());
-        }
-        co_return boost::json::serialize(keyVal);
-      },
-      boost::asio::use_future);
+  return createAccessKey(params, boost::asio::use_future);
+}
+
+std::future<AccessKey> OutlineClient::createAccessKeyTypedAsync(
+    const CreateAccessKeyParams& params) {
+  return createAccessKeyTyped(params, boost::asio::use_future);
 }
 
 std::future<std::string> OutlineClient::updateAccessKeyAsync(
     const std::string& accessKeyId, const UpdateAccessKeyParams& params) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, accessKeyId, params]() -> boost::asio::awaitable<std::string> {
-        std::map<std::string, std::string> placeholders{{"keyId", accessKeyId}};
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            utils::replacePlaceholders(
-                std::string(api::Endpoints::UpdateAccessKey), placeholders));
-        boost::json::object keyObj;
-        if (params.name)
-          keyObj["name"] = params.name.value();
-        if (params.password)
-          keyObj["password"] = params.password.value();
-        if (params.method)
-          keyObj["method"] = params.method.value();
-        if (params.data_limit_bytes) {
-          boost::json::object dataLimitObj{
-              {"bytes", params.data_limit_bytes.value()}};
-          keyObj["limit"] = dataLimitObj;
-        }
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(keyObj));
-        if (status != 201) {
-          throw OutlineServerErrorException(
-              "Unable to update access key (status=" + std::to_string(status) +
-              ")");
-        }
-        boost::json::value keyVal;
-        try {
-          keyVal = boost::json::parse(responseBody);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for access key update: ") +
-              e.what());
-        }
-        co_return boost::json::serialize(keyVal);
-      },
-      boost::asio::use_future);
+  return updateAccessKey(accessKeyId, params, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::deleteAccessKeyAsync(
     const std::string& accessKeyId) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, accessKeyId]() -> boost::asio::awaitable<void> {
-        std::map<std::string, std::string> placeholders{{"keyId", accessKeyId}};
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            utils::replacePlaceholders(
-                std::string(api::Endpoints::DeleteAccessKey), placeholders));
-        auto [status, responseBody] = co_await doDeleteAsync(url);
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to delete access key (status=" + std::to_string(status) +
-              ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return deleteAccessKey(accessKeyId, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::renameAccessKeyAsync(
     const std::string& accessKeyId, const std::string& newName) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, accessKeyId, newName]() -> boost::asio::awaitable<void> {
-        std::map<std::string, std::string> placeholders{{"keyId", accessKeyId}};
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            utils::replacePlaceholders(
-                std::string(api::Endpoints::RenameAccessKey), placeholders));
-        boost::json::object keyObj{{"name", newName}};
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(keyObj));
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to rename access key (status=" + std::to_string(status) +
-              ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return renameAccessKey(accessKeyId, newName, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::addDataLimitAsync(
     const std::string& accessKeyId, int dataLimitBytes) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, accessKeyId, dataLimitBytes]() -> boost::asio::awaitable<void> {
-        std::map<std::string, std::string> placeholders{{"keyId", accessKeyId}};
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            utils::replacePlaceholders(
-                std::string(api::Endpoints::AddDataLimit), placeholders));
-        boost::json::object dataLimitObj{{"bytes", dataLimitBytes}};
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(dataLimitObj));
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to add data limit (status=" + std::to_string(status) +
-              ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return addDataLimit(accessKeyId, dataLimitBytes, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::deleteDataLimitAsync(
     const std::string& accessKeyId) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, accessKeyId]() -> boost::asio::awaitable<void> {
-        std::map<std::string, std::string> placeholders{{"keyId", accessKeyId}};
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            utils::replacePlaceholders(
-                std::string(api::Endpoints::DeleteDataLimit), placeholders));
-        auto [status, responseBody] = co_await doDeleteAsync(url);
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to delete data limit (status=" + std::to_string(status) +
-              ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return deleteDataLimit(accessKeyId, boost::asio::use_future);
+}
+
+void OutlineClient::invalidateAccessKey(const std::string& accessKeyId) {
+  m_cache.invalidate("access-keys/" + accessKeyId);
+  m_cache.invalidate("access-keys");
 }
 
 std::string OutlineClient::getAccessKeys() {
     return getAccessKeysAsync().get();
 }
 
+std::string OutlineClient::getAccessKeysRaw() {
+    return getAccessKeysRawAsync().get();
+}
+
+std::vector<AccessKey> OutlineClient::getAccessKeysTyped() {
+    return getAccessKeysTypedAsync().get();
+}
+
+std::size_t OutlineClient::streamAccessKeys(
+    std::function<void(AccessKey&&)> onAccessKey) {
+    return streamAccessKeysAsync(std::move(onAccessKey)).get();
+}
+
+AccessKeySnapshot OutlineClient::getAccessKeySnapshot(
+    std::size_t expectedKeys) {
+    return getAccessKeySnapshotAsync(expectedKeys).get();
+}
+
 std::string OutlineClient::getAccessKey(const std::string& accessKeyId) {
     return getAccessKeyAsync(accessKeyId).get();
 }
 
+std::string OutlineClient::getAccessKeyRaw(const std::string& accessKeyId) {
+    return getAccessKeyRawAsync(accessKeyId).get();
+}
+
+AccessKey OutlineClient::getAccessKeyTyped(const std::string& accessKeyId) {
+    return getAccessKeyTypedAsync(accessKeyId).get();
+}
+
 std::string OutlineClient::createAccessKey(const CreateAccessKeyParams& params) {
     return createAccessKeyAsync(params).get();
 }
 
+AccessKey OutlineClient::createAccessKeyTyped(
+    const CreateAccessKeyParams& params) {
+    return createAccessKeyTypedAsync(params).get();
+}
+
 std::string OutlineClient::updateAccessKey(const std::string& accessKeyId, const UpdateAccessKeyParams& params) {
     return updateAccessKeyAsync(accessKeyId, params).get();
 }
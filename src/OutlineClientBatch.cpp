@@ -0,0 +1,406 @@
+#include "outline/OutlineClient.h"
+#include "outline/constants/ApiEndpoint.h"
+#include "outline/exceptions/OutlineExceptions.h"
+#include "outline/utils/JsonUtils.h"
+#include "outline/utils/EndpointTemplate.h"
+
+#include <boost/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace outline {
+
+namespace http = boost::beast::http;
+
+namespace {
+
+// Shared by the workers of one batch. Each result slot is written by exactly
+// one worker; the last worker to finish resumes the awaiting coroutine.
+template <typename T>
+struct BatchState {
+  BatchResult<T> results;
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::size_t> running{0};
+  std::function<void()> onDone;
+
+  void finishWorker() {
+    if (--running == 0)
+      onDone();
+  }
+};
+
+// Suspends the calling coroutine, calls start(done) and resumes on the
+// coroutine's executor once done() is called, from any thread.
+template <typename Start>
+boost::asio::awaitable<void> suspendUntilDone(Start start) {
+  return boost::asio::async_initiate<const boost::asio::use_awaitable_t<>&,
+                                     void()>(
+      [start = std::move(start)](auto handler) mutable {
+        auto shared =
+            std::make_shared<decltype(handler)>(std::move(handler));
+        start([shared]() {
+          auto executor = boost::asio::get_associated_executor(*shared);
+          boost::asio::post(executor, std::move(*shared));
+        });
+      },
+      boost::asio::use_awaitable);
+}
+
+// One pipelined request and how to judge its response.
+struct PipelinedCall {
+  http::request<http::string_body> request;
+  int expectedStatus;
+  std::string failure;
+  // The access key the request changes.
+  std::string accessKeyId;
+};
+
+// Expands the endpoint for the key into a buffer reused by every call on
+// the thread; makeRequest() copies it into the request.
+template <const std::string_view& Endpoint>
+std::string_view accessKeyTarget(const utils::TargetBase& base,
+                                 const std::string& accessKeyId) {
+  thread_local std::string buffer;
+  buffer.clear();
+  utils::endpointTemplate<Endpoint>.expandInto(buffer, base, {accessKeyId});
+  return buffer;
+}
+
+}  // namespace
+
+// Every worker is a coroutine on its own strand that takes the next
+// unclaimed index until none are left, so at most maxInFlight requests (and
+// pooled connections) are busy at once.
+template <typename T, typename Item>
+boost::asio::awaitable<BatchResult<T>> OutlineClient::runBatchAsync(
+    std::size_t count, std::size_t maxInFlight, Item item) {
+  if (count == 0)
+    co_return BatchResult<T>{};
+  auto state = std::make_shared<BatchState<T>>();
+  state->results.resize(count);
+
+  if (maxInFlight == 0)
+    maxInFlight = m_pool->options().maxPerHost;
+  const std::size_t workers = std::clamp<std::size_t>(maxInFlight, 1, count);
+  state->running = workers;
+
+  auto sharedItem = std::make_shared<Item>(std::move(item));
+  co_await suspendUntilDone([&](std::function<void()> done) {
+    state->onDone = std::move(done);
+    for (std::size_t w = 0; w < workers; ++w) {
+      boost::asio::co_spawn(
+          makeRequestExecutor(),
+          [state, sharedItem]() -> boost::asio::awaitable<void> {
+            for (std::size_t i = state->next++; i < state->results.size();
+                 i = state->next++) {
+              try {
+                if constexpr (std::is_void_v<T>) {
+                  co_await (*sharedItem)(i);
+                } else {
+                  state->results[i].value = co_await (*sharedItem)(i);
+                }
+              } catch (...) {
+                state->results[i].error = std::current_exception();
+              }
+            }
+            state->finishWorker();
+          },
+          boost::asio::detached);
+    }
+  });
+  co_return std::move(state->results);
+}
+
+// Same scheme, but a worker claims m_pipelineDepth items at once and sends
+// their requests as one pipeline on a single connection.
+template <typename MakeCall>
+boost::asio::awaitable<BatchResult<void>> OutlineClient::runPipelinedBatchAsync(
+    std::size_t count, std::size_t maxInFlight, MakeCall makeCall) {
+  if (count == 0)
+    co_return BatchResult<void>{};
+  auto state = std::make_shared<BatchState<void>>();
+  state->results.resize(count);
+
+  const std::size_t depth = m_pipelineDepth;
+  if (maxInFlight == 0)
+    maxInFlight = m_pool->options().maxPerHost;
+  const std::size_t workers = std::clamp<std::size_t>(
+      maxInFlight, 1, (count + depth - 1) / depth);
+  state->running = workers;
+
+  auto sharedMakeCall = std::make_shared<MakeCall>(std::move(makeCall));
+  co_await suspendUntilDone([&](std::function<void()> done) {
+    state->onDone = std::move(done);
+    for (std::size_t w = 0; w < workers; ++w) {
+      boost::asio::co_spawn(
+          makeRequestExecutor(),
+          [this, state, sharedMakeCall,
+           depth]() -> boost::asio::awaitable<void> {
+            const std::size_t count = state->results.size();
+            for (std::size_t begin = state->next.fetch_add(depth);
+                 begin < count; begin = state->next.fetch_add(depth)) {
+              const std::size_t end = std::min(begin + depth, count);
+              std::exception_ptr error;
+              try {
+                std::vector<PipelinedCall> calls;
+                std::vector<http::request<http::string_body>> reqs;
+                for (std::size_t i = begin; i < end; ++i) {
+                  calls.push_back((*sharedMakeCall)(i));
+                  reqs.push_back(std::move(calls.back().request));
+                }
+                auto responses = co_await sendPipelinedAsync(reqs);
+                for (std::size_t k = 0; k < calls.size(); ++k) {
+                  invalidateAccessKey(calls[k].accessKeyId);
+                  int status = responses[k].first;
+                  if (status != calls[k].expectedStatus) {
+                    state->results[begin + k].error = std::make_exception_ptr(
+                        OutlineServerErrorException(
+                            calls[k].failure +
+                            " (status=" + std::to_string(status) + ")"));
+                  }
+                }
+              } catch (...) {
+                error = std::current_exception();
+              }
+              // A failed pipeline fails every item it carried.
+              if (error) {
+                for (std::size_t i = begin; i < end; ++i)
+                  state->results[i].error = error;
+              }
+            }
+            state->finishWorker();
+          },
+          boost::asio::detached);
+    }
+  });
+  co_return std::move(state->results);
+}
+
+std::future<BatchResult<AccessKey>> OutlineClient::createAccessKeysBatchAsync(
+    std::vector<CreateAccessKeyParams> params, std::size_t maxInFlight) {
+  auto shared =
+      std::make_shared<std::vector<CreateAccessKeyParams>>(std::move(params));
+  return spawn(
+      runBatchAsync<AccessKey>(
+          shared->size(), maxInFlight,
+          [this, shared](std::size_t i) -> boost::asio::awaitable<AccessKey> {
+            auto body = co_await requestCreateAccessKeyAsync((*shared)[i]);
+            auto arena = m_jsonArenas.acquire();
+            co_return utils::jsonTo<AccessKey>(
+                arena.parse(body, "access key creation"), "access key");
+          }),
+      boost::asio::use_future, network::RequestPriority::Bulk);
+}
+
+std::future<BatchResult<void>> OutlineClient::deleteAccessKeysBatchAsync(
+    std::vector<std::string> accessKeyIds, std::size_t maxInFlight) {
+  auto shared = std::make_shared<std::vector<std::string>>(
+      std::move(accessKeyIds));
+  if (m_pipelineDepth > 1 && !m_pipeliningRejected.load()) {
+    return spawn(
+        runPipelinedBatchAsync(
+            shared->size(), maxInFlight,
+            [this, shared](std::size_t i) {
+              auto target = accessKeyTarget<api::Endpoints::DeleteAccessKey>(
+                  targetBase(), (*shared)[i]);
+              return PipelinedCall{makeRequest(http::verb::delete_, target),
+                                   204, "Unable to delete access key",
+                                   (*shared)[i]};
+            }),
+        boost::asio::use_future, network::RequestPriority::Bulk);
+  }
+  return spawn(
+      runBatchAsync<void>(
+          shared->size(), maxInFlight,
+          [this, shared](std::size_t i) -> boost::asio::awaitable<void> {
+            return requestDeleteAccessKeyAsync((*shared)[i]);
+          }),
+      boost::asio::use_future, network::RequestPriority::Bulk);
+}
+
+std::future<BatchResult<void>> OutlineClient::setDataLimitsBatchAsync(
+    std::vector<DataLimitUpdate> limits, std::size_t maxInFlight) {
+  auto shared =
+      std::make_shared<std::vector<DataLimitUpdate>>(std::move(limits));
+  if (m_pipelineDepth > 1 && !m_pipeliningRejected.load()) {
+    return spawn(
+        runPipelinedBatchAsync(
+            shared->size(), maxInFlight,
+            [this, shared](std::size_t i) {
+              const auto& limit = (*shared)[i];
+              auto target = accessKeyTarget<api::Endpoints::AddDataLimit>(
+                  targetBase(), limit.accessKeyId);
+              auto arena = m_jsonArenas.acquire();
+              boost::json::object dataLimitObj(
+                  {{"bytes", limit.dataLimitBytes}}, arena.storage());
+              return PipelinedCall{
+                  makeRequest(http::verb::put, target,
+                              boost::json::serialize(dataLimitObj)),
+                  204, "Unable to add data limit", limit.accessKeyId};
+            }),
+        boost::asio::use_future, network::RequestPriority::Bulk);
+  }
+  return spawn(
+      runBatchAsync<void>(
+          shared->size(), maxInFlight,
+          [this, shared](std::size_t i) -> boost::asio::awaitable<void> {
+            const auto& limit = (*shared)[i];
+            return requestAddDataLimitAsync(limit.accessKeyId,
+                                            limit.dataLimitBytes);
+          }),
+      boost::asio::use_future, network::RequestPriority::Bulk);
+}
+
+boost::asio::awaitable<BatchResult<void>> OutlineClient::requestMutationsAsync(
+    std::vector<AccessKeyMutation> mutations, std::size_t maxInFlight) {
+  using Kind = AccessKeyMutation::Kind;
+  auto shared =
+      std::make_shared<std::vector<AccessKeyMutation>>(std::move(mutations));
+  if (m_pipelineDepth > 1 && !m_pipeliningRejected.load()) {
+    co_return co_await runPipelinedBatchAsync(
+        shared->size(), maxInFlight, [this, shared](std::size_t i) {
+          const auto& mutation = (*shared)[i];
+          const auto& id = mutation.accessKeyId;
+          switch (mutation.kind) {
+            case Kind::Create: {
+              auto arena = m_jsonArenas.acquire();
+              boost::json::object keyObj({{"name", mutation.name}},
+                                         arena.storage());
+              if (mutation.dataLimitBytes) {
+                keyObj["limit"] = boost::json::object(
+                    {{"bytes", *mutation.dataLimitBytes}}, arena.storage());
+              }
+              auto target = accessKeyTarget<api::Endpoints::UpdateAccessKey>(
+                  targetBase(), id);
+              return PipelinedCall{
+                  makeRequest(http::verb::put, target,
+                              boost::json::serialize(keyObj)),
+                  201, "Unable to update access key", id};
+            }
+            case Kind::Rename: {
+              auto arena = m_jsonArenas.acquire();
+              boost::json::object keyObj({{"name", mutation.name}},
+                                         arena.storage());
+              auto target = accessKeyTarget<api::Endpoints::RenameAccessKey>(
+                  targetBase(), id);
+              return PipelinedCall{
+                  makeRequest(http::verb::put, target,
+                              boost::json::serialize(keyObj)),
+                  204, "Unable to rename access key", id};
+            }
+            case Kind::SetDataLimit: {
+              auto arena = m_jsonArenas.acquire();
+              boost::json::object dataLimitObj(
+                  {{"bytes", mutation.dataLimitBytes.value_or(0)}},
+                  arena.storage());
+              auto target = accessKeyTarget<api::Endpoints::AddDataLimit>(
+                  targetBase(), id);
+              return PipelinedCall{
+                  makeRequest(http::verb::put, target,
+                              boost::json::serialize(dataLimitObj)),
+                  204, "Unable to add data limit", id};
+            }
+            case Kind::RemoveDataLimit: {
+              auto target = accessKeyTarget<api::Endpoints::DeleteDataLimit>(
+                  targetBase(), id);
+              return PipelinedCall{makeRequest(http::verb::delete_, target),
+                                   204, "Unable to delete data limit", id};
+            }
+            case Kind::Delete:
+              break;
+          }
+          auto target = accessKeyTarget<api::Endpoints::DeleteAccessKey>(
+              targetBase(), id);
+          return PipelinedCall{makeRequest(http::verb::delete_, target), 204,
+                               "Unable to delete access key", id};
+        });
+  }
+  co_return co_await runBatchAsync<void>(
+      shared->size(), maxInFlight,
+      [this, shared](std::size_t i) -> boost::asio::awaitable<void> {
+        const auto& mutation = (*shared)[i];
+        const auto& id = mutation.accessKeyId;
+        switch (mutation.kind) {
+          case Kind::Create: {
+            UpdateAccessKeyParams params;
+            params.name = mutation.name;
+            params.data_limit_bytes = mutation.dataLimitBytes;
+            co_await requestUpdateAccessKeyAsync(id, std::move(params));
+            break;
+          }
+          case Kind::Rename:
+            co_await requestRenameAccessKeyAsync(id, mutation.name);
+            break;
+          case Kind::SetDataLimit:
+            co_await requestAddDataLimitAsync(
+                id, mutation.dataLimitBytes.value_or(0));
+            break;
+          case Kind::RemoveDataLimit:
+            co_await requestDeleteDataLimitAsync(id);
+            break;
+          case Kind::Delete:
+            co_await requestDeleteAccessKeyAsync(id);
+            break;
+        }
+      });
+}
+
+// The snapshot is only replaced once the whole list has been read, so a
+// failed resync keeps the previous one and stays due.
+boost::asio::awaitable<ReconcileReport> OutlineClient::requestReconcileAsync(
+    AccessKeyReconciler& reconciler, std::vector<DesiredAccessKey> desired,
+    std::size_t maxInFlight) {
+  ReconcileReport report;
+  if (reconciler.resyncDue()) {
+    reconciler.beginResync();
+    co_await requestStreamAccessKeysAsync(
+        [&reconciler](AccessKey&& key) { reconciler.update(std::move(key)); });
+    reconciler.finishResync();
+    report.resynced = true;
+  }
+  report.mutations = reconciler.plan(desired);
+  report.results =
+      co_await requestMutationsAsync(report.mutations, maxInFlight);
+  reconciler.commit(report.mutations, report.results);
+  co_return report;
+}
+
+std::future<ReconcileReport> OutlineClient::reconcileAccessKeysAsync(
+    AccessKeyReconciler& reconciler, std::vector<DesiredAccessKey> desired,
+    std::size_t maxInFlight) {
+  return spawn(
+      requestReconcileAsync(reconciler, std::move(desired), maxInFlight),
+      boost::asio::use_future, network::RequestPriority::Bulk);
+}
+
+BatchResult<AccessKey> OutlineClient::createAccessKeysBatch(
+    std::vector<CreateAccessKeyParams> params, std::size_t maxInFlight) {
+    return createAccessKeysBatchAsync(std::move(params), maxInFlight).get();
+}
+
+BatchResult<void> OutlineClient::deleteAccessKeysBatch(
+    std::vector<std::string> accessKeyIds, std::size_t maxInFlight) {
+    return deleteAccessKeysBatchAsync(std::move(accessKeyIds), maxInFlight)
+        .get();
+}
+
+BatchResult<void> OutlineClient::setDataLimitsBatch(
+    std::vector<DataLimitUpdate> limits, std::size_t maxInFlight) {
+    return setDataLimitsBatchAsync(std::move(limits), maxInFlight).get();
+}
+
+ReconcileReport OutlineClient::reconcileAccessKeys(
+    AccessKeyReconciler& reconciler, std::vector<DesiredAccessKey> desired,
+    std::size_t maxInFlight) {
+    return reconcileAccessKeysAsync(reconciler, std::move(desired),
+                                    maxInFlight)
+        .get();
+}
+
+}  // namespace outline
@@ -1,7 +1,8 @@
 #include "outline/OutlineClient.h"
 #include "outline/constants/ApiEndpoint.h"
 #include "outline/exceptions/OutlineExceptions.h"
-#include "outline/utils/UrlUtils.h"
+#include "outline/utils/JsonStreamParsers.h"
+#include "outline/utils/JsonUtils.h"
 
 #include <boost/json.hpp>
 #include <future>
@@ -9,86 +10,156 @@
 #include <string>
 
 namespace outline {
+boost::asio::awaitable<std::shared_ptr<const std::string>>
+OutlineClient::requestMetricsSharedAsync() {
+  co_return co_await m_metricsFlight.run(
+      [this]() { return backgroundAsync(fetchMetricsBodyAsync()); },
+      [this]() { return makeRequestExecutor(false); });
+}
+
+boost::asio::awaitable<std::string> OutlineClient::fetchMetricsBodyAsync() {
+  auto [status, body] =
+      co_await doGetAsync(targetOf<api::Endpoints::GetMetrics>());
+  if (status >= 400 ||
+      body.find("bytesTransferredByUserId") == std::string::npos) {
+    throw OutlineServerErrorException(
+        "Unable to get metrics (status=" + std::to_string(status) + ")");
+  }
+  co_return std::move(body);
+}
+
+boost::asio::awaitable<std::string> OutlineClient::requestMetricsAsync() {
+  co_return *co_await requestMetricsSharedAsync();
+}
+
+boost::asio::awaitable<TransferMetrics>
+OutlineClient::requestMetricsTypedAsync() {
+  auto body = co_await requestMetricsSharedAsync();
+  auto arena = m_jsonArenas.acquire();
+  co_return utils::jsonTo<TransferMetrics>(arena.parse(*body, "metrics"),
+                                           "metrics");
+}
+
+boost::asio::awaitable<std::size_t> OutlineClient::requestMetricsStreamAsync(
+    std::function<void(std::string_view, std::uint64_t)> onBytes) {
+  utils::TransferMetricsStreamParser parser(std::move(onBytes));
+  int status = co_await doGetStreamingAsync(
+      targetOf<api::Endpoints::GetMetrics>(),
+      [&parser](std::string_view chunk) { parser.write(chunk); });
+  if (status != 200) {
+    throw OutlineServerErrorException(
+        "Unable to get metrics (status=" + std::to_string(status) + ")");
+  }
+  parser.finish();
+  co_return parser.count();
+}
+
+boost::asio::awaitable<MetricsDeltaReport>
+OutlineClient::requestPollMetricsDeltaAsync(MetricsDeltaEngine& engine) {
+  engine.begin();
+  co_await requestMetricsStreamAsync(
+      [&engine](std::string_view accessKeyId, std::uint64_t bytes) {
+        engine.update(accessKeyId, bytes);
+      });
+  co_return engine.finish();
+}
+
+boost::asio::awaitable<bool> OutlineClient::requestMetricsStatusAsync() {
+  auto [status, body] =
+      co_await doGetAsync(targetOf<api::Endpoints::GetMetricsStatus>());
+  if (status != 200) {
+    throw OutlineServerErrorException(
+        "Unable to get metrics status (status=" + std::to_string(status) +
+        ")");
+  }
+  auto arena = m_jsonArenas.acquire();
+  auto metricsVal = arena.parse(body, "metrics status");
+  if (!metricsVal.is_object() ||
+      !metricsVal.as_object().contains("metricsEnabled")) {
+    throw OutlineParseException("Invalid JSON structure for metrics status.");
+  }
+  co_return metricsVal.as_object()["metricsEnabled"].as_bool();
+}
+
+boost::asio::awaitable<void> OutlineClient::requestSetMetricsStatusAsync(
+    bool status) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object metricsObj({{"metricsEnabled", status}},
+                                 arena.storage());
+  int statusCode = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::SetMetricsStatus>(),
+      boost::json::serialize(metricsObj));
+  m_cache.invalidate("server");
+  if (statusCode != 204) {
+    throw OutlineServerErrorException(
+        "Unable to set metrics status (status=" + std::to_string(statusCode) +
+        ")");
+  }
+}
+
 std::future<std::string> OutlineClient::getMetricsAsync() {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this]() -> boost::asio::awaitable<std::string> {
-        auto url =
-            utils::appendUrl(m_apiUrl, std::string(api::Endpoints::GetMetrics));
-        auto [status, body] = co_await doGetAsync(url);
-        if (status >= 400 ||
-            body.find("bytesTransferredByUserId") == std::string::npos) {
-          throw OutlineServerErrorException(
-              "Unable to get metrics (status=" + std::to_string(status) + ")");
-        }
-        boost::json::value metricsVal;
-        try {
-          metricsVal = boost::json::parse(body);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for metrics: ") + e.what());
-        }
-        co_return boost::json::serialize(metricsVal);
-      },
-      boost::asio::use_future);
+  return getMetrics(boost::asio::use_future);
+}
+
+std::future<std::string> OutlineClient::getMetricsRawAsync() {
+  return getMetricsRaw(boost::asio::use_future);
+}
+
+std::future<TransferMetrics> OutlineClient::getMetricsTypedAsync() {
+  return getMetricsTyped(boost::asio::use_future);
+}
+
+std::future<std::size_t> OutlineClient::streamMetricsAsync(
+    std::function<void(std::string_view, std::uint64_t)> onBytes) {
+  return streamMetrics(std::move(onBytes), boost::asio::use_future);
+}
+
+std::future<MetricsDeltaReport> OutlineClient::pollMetricsDeltaAsync(
+    MetricsDeltaEngine& engine) {
+  return pollMetricsDelta(engine, boost::asio::use_future);
 }
 
 std::future<bool> OutlineClient::getMetricsStatusAsync() {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this]() -> boost::asio::awaitable<bool> {
-        auto url = utils::appendUrl(
-            m_apiUrl, std::string(api::Endpoints::GetMetricsStatus));
-        auto [status, body] = co_await doGetAsync(url);
-        if (status != 200) {
-          throw OutlineServerErrorException(
-              "Unable to get metrics status (status=" + std::to_string(status) +
-              ")");
-        }
-        boost::json::value metricsVal;
-        try {
-          metricsVal = boost::json::parse(body);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for metrics status: ") + e.what());
-        }
-        if (!metricsVal.is_object() ||
-            !metricsVal.as_object().contains("metricsEnabled")) {
-          throw OutlineParseException(
-              "Invalid JSON structure for metrics status.");
-        }
-        co_return metricsVal.as_object()["metricsEnabled"].as_bool();
-      },
-      boost::asio::use_future);
+  return getMetricsStatus(boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::setMetricsStatusAsync(bool status) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, status]() -> boost::asio::awaitable<void> {
-        auto url = utils::appendUrl(
-            m_apiUrl, std::string(api::Endpoints::SetMetricsStatus));
-        boost::json::object metricsObj{{"metricsEnabled", status}};
-        auto [statusCode, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(metricsObj));
-        if (statusCode != 204) {
-          throw OutlineServerErrorException(
-              "Unable to set metrics status (status=" +
-              std::to_string(statusCode) + ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return setMetricsStatus(status, boost::asio::use_future);
 }
 
 std::string OutlineClient::getMetrics() {
     return getMetricsAsync().get();
 }
 
+std::string OutlineClient::getMetricsRaw() {
+    return getMetricsRawAsync().get();
+}
+
+TransferMetrics OutlineClient::getMetricsTyped() {
+    return getMetricsTypedAsync().get();
+}
+
 std::string OutlineClient::getServerInformation() {
     return getServerInformationAsync().get();
 }
 
+std::string OutlineClient::getServerInformationRaw() {
+    return getServerInformationRawAsync().get();
+}
+
+ServerInfo OutlineClient::getServerInformationTyped() {
+    return getServerInformationTypedAsync().get();
+}
+
+std::size_t OutlineClient::streamMetrics(
+    std::function<void(std::string_view, std::uint64_t)> onBytes) {
+    return streamMetricsAsync(std::move(onBytes)).get();
+}
+
+MetricsDeltaReport OutlineClient::pollMetricsDelta(MetricsDeltaEngine& engine) {
+    return pollMetricsDeltaAsync(engine).get();
+}
+
 bool OutlineClient::getMetricsStatus() {
     return getMetricsStatusAsync().get();
 }
@@ -1,7 +1,11 @@
 #include "outline/OutlineClient.h"
 #include "outline/constants/ApiEndpoint.h"
 #include "outline/exceptions/OutlineExceptions.h"
-#include "outline/utils/UrlUtils.h"
+#include "outline/network/CertificatePin.h"
+#include "outline/network/ContextExecutor.h"
+#include "outline/network/Deadline.h"
+#include "outline/network/RequestContext.h"
+#include "outline/network/Tracing.h"
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
@@ -15,156 +19,883 @@ namespace ssl = boost::asio::ssl;
 namespace http = boost::beast::http;
 using tcp = boost::asio::ip::tcp;
 
-boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::doGetAsync(
-    const boost::urls::url& url) {
-  ssl::stream<tcp::socket> sslStream(m_ioContext, m_sslContext);
-  tcp::resolver resolver(m_ioContext);
-  auto results = co_await resolver.async_resolve(url.host(), url.port(),
-                                                 boost::asio::use_awaitable);
-  co_await boost::asio::async_connect(sslStream.next_layer(), results,
-                                      boost::asio::use_awaitable);
-  co_await sslStream.async_handshake(ssl::stream_base::client,
-                                     boost::asio::use_awaitable);
-
-  std::string host = url.host();
-  std::string target = url.encoded_path().data();
-  if (!url.encoded_query().empty()) {
-    target += "?" + std::string(url.encoded_query());
-  }
-
-  http::request<http::string_body> req{http::verb::get, target, 11};
-  req.set(http::field::host, host);
-  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-  co_await http::async_write(sslStream, req, boost::asio::use_awaitable);
+namespace {
 
-  boost::beast::flat_buffer buffer;
-  http::response<http::dynamic_body> res;
-  co_await http::async_read(sslStream, buffer, res, boost::asio::use_awaitable);
+std::string requestPort(const boost::urls::url& url) {
+  return url.has_port() ? std::string(url.port()) : std::string(url.scheme());
+}
 
-  boost::system::error_code ec;
-  co_await sslStream.async_shutdown(
-      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-  if (ec && ec != boost::asio::error::eof)
-    throw boost::system::system_error(ec);
+// Errors that mean a reused keep-alive connection was closed by the server
+// while it sat in the pool.
+bool isStaleConnectionError(const boost::system::error_code& ec) {
+  return ec == boost::asio::error::eof ||
+         ec == boost::asio::error::connection_reset ||
+         ec == boost::asio::error::connection_aborted ||
+         ec == boost::asio::error::broken_pipe ||
+         ec == ssl::error::stream_truncated ||
+         ec == http::error::end_of_stream;
+}
 
-  co_return std::make_pair(static_cast<int>(res.result_int()),
-                           boost::beast::buffers_to_string(res.body().data()));
+bool isIdempotent(http::verb verb) {
+  return verb == http::verb::get || verb == http::verb::put ||
+         verb == http::verb::delete_;
 }
 
-boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::doPostAsync(
-    const boost::urls::url& url, const std::string& body) {
-  ssl::stream<tcp::socket> sslStream(m_ioContext, m_sslContext);
-  tcp::resolver resolver(m_ioContext);
-  auto results = co_await resolver.async_resolve(url.host(), url.port(),
-                                                 boost::asio::use_awaitable);
-  co_await boost::asio::async_connect(sslStream.next_layer(), results,
-                                      boost::asio::use_awaitable);
-  co_await sslStream.async_handshake(ssl::stream_base::client,
-                                     boost::asio::use_awaitable);
-
-  std::string host = url.host();
-  std::string target = url.encoded_path().data();
-  if (!url.encoded_query().empty()) {
-    target += "?" + std::string(url.encoded_query());
-  }
-
-  http::request<http::string_body> req{http::verb::post, target, 11};
-  req.set(http::field::host, host);
-  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-  req.set(http::field::content_type, "application/json");
-  req.body() = body;
-  req.prepare_payload();
+// Responses telling the client to back off and try again.
+bool isRetryableStatus(int status) {
+  return status == 429 || status == 502 || status == 503 || status == 504;
+}
+
+OutlineTimeoutException phaseTimeout(const std::string& phase,
+                                     const std::string& key,
+                                     std::chrono::milliseconds limit) {
+  return OutlineTimeoutException(phase + " to " + key + " timed out after " +
+                                 std::to_string(limit.count()) + " ms");
+}
+
+// Cancels the pending operations of the connection when its deadline passes.
+auto cancelOnExpiry(network::PooledConnection& conn) {
+  return [&conn]() {
+    boost::system::error_code ec;
+    conn.stream.next_layer().cancel(ec);
+  };
+}
+
+// Closes the connection of a cancelled request, so that its pending and
+// later operations fail right away.
+auto closeOnCancel(network::PooledConnection& conn) {
+  return [&conn]() {
+    boost::system::error_code ec;
+    conn.stream.next_layer().shutdown(tcp::socket::shutdown_both, ec);
+    conn.stream.next_layer().close(ec);
+  };
+}
+
+// Registrations of onCancel(); must be destroyed on the request's executor.
+struct CancelSlots {
+  network::CancellationSignal::Slot shutdown;
+  network::CancellationSignal::Slot request;
+};
+
+// Runs handler when the shutdown cancels the request or the request's own
+// signal is emitted.
+CancelSlots onCancel(network::ShutdownGate& gate,
+                     const boost::asio::any_io_executor& executor,
+                     const std::function<void()>& handler) {
+  CancelSlots slots;
+  if (auto* context = network::RequestContext::active();
+      context && context->cancellation) {
+    slots.request = context->cancellation->connect(executor, handler);
+  }
+  slots.shutdown = gate.onCancel(executor, handler);
+  return slots;
+}
+
+// Fails the request if its signal was emitted, whatever error the
+// cancellation caused on the way.
+void throwIfCancelled() {
+  if (auto* context = network::RequestContext::active();
+      context && context->cancelled()) {
+    throw OutlineCancelledException("Request cancelled");
+  }
+}
+
+std::string_view verbName(http::verb verb) {
+  auto name = http::to_string(verb);
+  return std::string_view(name.data(), name.size());
+}
+
+// Counts a finished request of the endpoint, classifies its failure and
+// completes its span.
+void recordRequest(network::Instrumentation& instrumentation,
+                   network::TraceSpan& span, http::verb verb,
+                   std::string_view endpoint,
+                   std::chrono::steady_clock::time_point start, int status,
+                   std::size_t responseBytes, std::exception_ptr error) {
+  if (span) {
+    if (error) {
+      try {
+        std::rethrow_exception(error);
+      } catch (const std::exception& e) {
+        span.setError(e.what());
+      } catch (...) {
+        span.setError("Unknown error");
+      }
+    } else {
+      span.setAttribute("http.response.status_code",
+                        static_cast<std::int64_t>(status));
+      span.setAttribute("http.response.body.size",
+                        static_cast<std::int64_t>(responseBytes));
+    }
+  }
+  if (error) {
+    auto errorClass = network::ErrorClass::Other;
+    try {
+      std::rethrow_exception(error);
+    } catch (const OutlineTimeoutException&) {
+      errorClass = network::ErrorClass::Timeout;
+    } catch (const OutlineCircuitOpenException&) {
+      errorClass = network::ErrorClass::CircuitOpen;
+    } catch (const OutlineCertificateException&) {
+      errorClass = network::ErrorClass::Tls;
+    } catch (const boost::system::system_error& e) {
+      const auto& category = e.code().category();
+      bool tls = category == boost::asio::error::get_ssl_category() ||
+                 category == ssl::error::get_stream_category();
+      errorClass =
+          tls ? network::ErrorClass::Tls : network::ErrorClass::Network;
+    } catch (...) {
+    }
+    instrumentation.recordError(errorClass);
+  } else if (status >= 500) {
+    instrumentation.recordError(network::ErrorClass::ServerError);
+  } else if (status >= 400) {
+    instrumentation.recordError(network::ErrorClass::ClientError);
+  }
+  instrumentation.requestFinished(verbName(verb), endpoint,
+                                  std::chrono::steady_clock::now() - start);
+}
+
+// Opens the span of a request to the endpoint.
+void startRequestSpan(network::TraceSpan& span, http::verb verb,
+                      std::string_view endpoint, std::size_t requestBytes) {
+  if (!span)
+    return;
+  span.setAttribute("http.request.method", verbName(verb));
+  span.setAttribute("outline.endpoint", endpoint);
+  span.setAttribute("http.request.body.size",
+                    static_cast<std::int64_t>(requestBytes));
+}
 
-  co_await http::async_write(sslStream, req, boost::asio::use_awaitable);
+}  // namespace
 
-  boost::beast::flat_buffer buffer;
-  http::response<http::dynamic_body> res;
-  co_await http::async_read(sslStream, buffer, res, boost::asio::use_awaitable);
+boost::asio::awaitable<void> OutlineClient::connectAsync(
+    network::PooledConnection& conn, const std::string& host,
+    const std::string& port) {
+  network::ResolverCache::Endpoints endpoints;
+  try {
+    network::Instrumentation::PhaseTimer timer(m_instrumentation,
+                                               network::Phase::Resolve);
+    network::TraceSpan span("resolve");
+    endpoints =
+        co_await m_resolverCache->resolveAsync(host, port, *m_timeouts.resolve);
+  } catch (const boost::system::system_error& e) {
+    if (e.code() == boost::asio::error::timed_out)
+      throw phaseTimeout("DNS resolution", conn.key, *m_timeouts.resolve);
+    throw;
+  }
+  try {
+    network::Instrumentation::PhaseTimer timer(m_instrumentation,
+                                               network::Phase::Connect);
+    network::TraceSpan span("connect");
+    co_await network::connectRacingAsync(
+        conn.stream.next_layer(), endpoints,
+        m_resolverCache->options().connectAttemptDelay, *m_timeouts.connect);
+  } catch (const boost::system::system_error& e) {
+    // The host may have moved; resolve again on the next attempt.
+    m_resolverCache->invalidate(host, port);
+    if (e.code() == boost::asio::error::timed_out)
+      throw phaseTimeout("Connect", conn.key, *m_timeouts.connect);
+    throw;
+  }
+  co_await handshakeAsync(conn);
+  conn.connected = true;
+}
 
+boost::asio::awaitable<void> OutlineClient::handshakeAsync(
+    network::PooledConnection& conn) {
+  if (m_sessionCache)
+    m_sessionCache->prepare(conn.stream.native_handle(), conn.key);
+  if (m_pin)
+    network::pinCertificate(conn.stream, *m_pin, conn.peerFingerprint);
   boost::system::error_code ec;
-  co_await sslStream.async_shutdown(
-      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-  if (ec && ec != boost::asio::error::eof)
+  {
+    network::Instrumentation::PhaseTimer timer(m_instrumentation,
+                                               network::Phase::Handshake);
+    network::TraceSpan span("handshake");
+    network::Deadline deadline(co_await boost::asio::this_coro::executor,
+                               *m_timeouts.handshake, cancelOnExpiry(conn));
+    co_await conn.stream.async_handshake(
+        ssl::stream_base::client,
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (deadline.expired())
+      throw phaseTimeout("TLS handshake", conn.key, *m_timeouts.handshake);
+  }
+  if (m_pin && !ec && !conn.peerFingerprint) {
+    // A resumed session skips the verify callback; its certificate is the
+    // one of the handshake that created it.
+    conn.peerFingerprint =
+        network::peerFingerprint(conn.stream.native_handle());
+  }
+  const bool pinMismatch =
+      m_pin && conn.peerFingerprint && *conn.peerFingerprint != *m_pin;
+  if (ec || pinMismatch) {
+    // A rejected or corrupt session must not poison later reconnects.
+    if (m_sessionCache)
+      m_sessionCache->invalidate(conn.key);
+    if (pinMismatch)
+      throw OutlineCertificateException(conn.key);
     throw boost::system::system_error(ec);
+  }
+  if (m_sessionCache)
+    m_sessionCache->recordHandshake(conn.stream.native_handle());
+}
 
-  co_return std::make_pair(static_cast<int>(res.result_int()),
-                           boost::beast::buffers_to_string(res.body().data()));
+boost::asio::awaitable<network::ConnectionLease>
+OutlineClient::leaseConnectionAsync(const std::string& host,
+                                    const std::string& port) {
+  std::string key = host + ":" + port;
+  network::ConnectionLease conn;
+  try {
+    conn = co_await m_pool->acquireAsync(key, *m_sslContext,
+                                         *m_timeouts.connect,
+                                         network::RequestContext::active());
+  } catch (const boost::system::system_error& e) {
+    if (e.code() == boost::asio::error::timed_out)
+      throw phaseTimeout("Waiting for a pooled connection", key,
+                         *m_timeouts.connect);
+    throwIfCancelled();
+    throw;
+  }
+  if (!conn->connected) {
+    conn->key = key;
+    co_await connectAsync(*conn, host, port);
+  } else if (m_pin && conn->peerFingerprint != *m_pin) {
+    // Opened by another client of an OutlineFleet: checked once here if
+    // that client doesn't pin, and wrong if it pinned another certificate.
+    if (!conn->peerFingerprint) {
+      conn->peerFingerprint =
+          network::peerFingerprint(conn->stream.native_handle());
+    }
+    if (conn->peerFingerprint != *m_pin)
+      throw OutlineCertificateException(key);
+  }
+  co_return conn;
 }
 
-boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::doPutAsync(
-    const boost::urls::url& url, const std::string& body) {
-  ssl::stream<tcp::socket> sslStream(m_ioContext, m_sslContext);
-  tcp::resolver resolver(m_ioContext);
-  auto results = co_await resolver.async_resolve(url.host(), url.port(),
-                                                 boost::asio::use_awaitable);
-  co_await boost::asio::async_connect(sslStream.next_layer(), results,
-                                      boost::asio::use_awaitable);
-  co_await sslStream.async_handshake(ssl::stream_base::client,
-                                     boost::asio::use_awaitable);
-
-  std::string host = url.host();
-  std::string target = url.encoded_path().data();
-  if (!url.encoded_query().empty()) {
-    target += "?" + std::string(url.encoded_query());
-  }
-
-  http::request<http::string_body> req{http::verb::put, target, 11};
+boost::asio::awaitable<boost::system::error_code>
+OutlineClient::writeRequestAsync(network::PooledConnection& conn,
+                                 http::request<http::string_body>& req) {
+  boost::system::error_code ec;
+  network::Instrumentation::PhaseTimer timer(m_instrumentation,
+                                             network::Phase::Write);
+  network::TraceSpan span("write");
+  network::Deadline deadline(co_await boost::asio::this_coro::executor,
+                             *m_timeouts.write, cancelOnExpiry(conn));
+  m_instrumentation.addBytesSent(co_await http::async_write(
+      conn.stream, req,
+      boost::asio::redirect_error(boost::asio::use_awaitable, ec)));
+  if (deadline.expired())
+    throw phaseTimeout("Writing request", conn.key, *m_timeouts.write);
+  co_return ec;
+}
+
+boost::asio::awaitable<boost::system::error_code>
+OutlineClient::readResponseAsync(
+    network::PooledConnection& conn,
+    http::response_parser<network::DecodingBody>& parser) {
+  // The body is decoded straight into a string that is moved out to the
+  // caller, so the response is never copied.
+  parser.body_limit(boost::none);
+  boost::system::error_code ec;
+  network::Instrumentation::PhaseTimer timer(m_instrumentation,
+                                             network::Phase::Read);
+  network::TraceSpan span("read");
+  network::Deadline deadline(co_await boost::asio::this_coro::executor,
+                             *m_timeouts.read, cancelOnExpiry(conn));
+  m_instrumentation.addBytesReceived(co_await http::async_read(
+      conn.stream, conn.buffer, parser,
+      boost::asio::redirect_error(boost::asio::use_awaitable, ec)));
+  if (deadline.expired())
+    throw phaseTimeout("Reading response", conn.key, *m_timeouts.read);
+  co_return ec;
+}
+
+void OutlineClient::prepareRequest(http::request<http::string_body>& req,
+                                   const std::string& host,
+                                   bool statusOnly) const {
   req.set(http::field::host, host);
-  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-  req.set(http::field::content_type, "application/json");
-  req.body() = body;
-  req.prepare_payload();
+  req.keep_alive(true);
+  if (!m_userAgent.empty())
+    req.set(http::field::user_agent, m_userAgent);
+  if (m_acceptCompression && !statusOnly) {
+    constexpr auto accepted = network::ContentDecoder::kAcceptEncoding;
+    req.set(http::field::accept_encoding,
+            boost::beast::string_view(accepted.data(), accepted.size()));
+  }
+}
 
-  co_await http::async_write(sslStream, req, boost::asio::use_awaitable);
+boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::sendAsync(
+    http::request<http::string_body>& req, bool statusOnly) {
+  std::string host = m_apiUrl.host();
+  std::string port = requestPort(m_apiUrl);
+  prepareRequest(req, host, statusOnly);
 
-  boost::beast::flat_buffer buffer;
-  http::response<http::dynamic_body> res;
-  co_await http::async_read(sslStream, buffer, res, boost::asio::use_awaitable);
+  auto executor = co_await boost::asio::this_coro::executor;
+  for (bool retried = false;; retried = true) {
+    auto conn = co_await leaseConnectionAsync(host, port);
+    auto cancel = onCancel(m_shutdown, executor, closeOnCancel(*conn));
+    auto ec = co_await writeRequestAsync(*conn, req);
+    bool written = !ec;
+    http::response_parser<network::DecodingBody> parser;
+    parser.get().body().discard = statusOnly;
+    if (written) {
+      conn->buffer.clear();
+      ec = co_await readResponseAsync(*conn, parser);
+    }
+    if (ec) {
+      // A pooled socket may have been closed by the server while idle; retry
+      // once on a new connection unless a non-idempotent request got through.
+      if (conn.reused() && !retried && isStaleConnectionError(ec) &&
+          (!written || isIdempotent(req.method()))) {
+        continue;
+      }
+      throw boost::system::system_error(ec);
+    }
 
-  boost::system::error_code ec;
-  co_await sslStream.async_shutdown(
-      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-  if (ec && ec != boost::asio::error::eof)
-    throw boost::system::system_error(ec);
+    auto res = parser.release();
+    if (res.keep_alive())
+      conn.markReusable();
+    co_return std::make_pair(static_cast<int>(res.result_int()),
+                             std::move(res.body().data));
+  }
+}
 
-  co_return std::make_pair(static_cast<int>(res.result_int()),
-                           boost::beast::buffers_to_string(res.body().data()));
+boost::asio::awaitable<network::RequestLimiter::Permit>
+OutlineClient::acquireRequestSlotAsync(const std::string& key) {
+  try {
+    co_return co_await m_limiter->acquireAsync(
+        key, *m_timeouts.connect, network::RequestContext::active());
+  } catch (const boost::system::system_error& e) {
+    if (e.code() == boost::asio::error::timed_out)
+      throw phaseTimeout("Waiting for a request slot", key,
+                         *m_timeouts.connect);
+    throwIfCancelled();
+    throw;
+  }
 }
 
 boost::asio::awaitable<std::pair<int, std::string>>
-OutlineClient::doDeleteAsync(const boost::urls::url& url) {
-  ssl::stream<tcp::socket> sslStream(m_ioContext, m_sslContext);
-  tcp::resolver resolver(m_ioContext);
-  auto results = co_await resolver.async_resolve(url.host(), url.port(),
-                                                 boost::asio::use_awaitable);
-  co_await boost::asio::async_connect(sslStream.next_layer(), results,
-                                      boost::asio::use_awaitable);
-  co_await sslStream.async_handshake(ssl::stream_base::client,
-                                     boost::asio::use_awaitable);
-
-  std::string host = url.host();
-  std::string target = url.encoded_path().data();
-  if (!url.encoded_query().empty()) {
-    target += "?" + std::string(url.encoded_query());
-  }
-
-  http::request<http::string_body> req{http::verb::delete_, target, 11};
-  req.set(http::field::host, host);
-  req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-  co_await http::async_write(sslStream, req, boost::asio::use_awaitable);
+OutlineClient::sendWithRetryAsync(http::request<http::string_body>& req,
+                                  bool statusOnly) {
+  std::string host =
+      std::string(m_apiUrl.host()) + ":" + requestPort(m_apiUrl);
+  const bool retryable =
+      isIdempotent(req.method()) ||
+      (req.method() == http::verb::post && m_retry.retryCreateAccessKey);
+  network::Backoff backoff(m_retry.baseDelay, m_retry.maxDelay);
+  auto executor = co_await boost::asio::this_coro::executor;
 
-  boost::beast::flat_buffer buffer;
-  http::response<http::dynamic_body> res;
-  co_await http::async_read(sslStream, buffer, res, boost::asio::use_awaitable);
+  for (int attempt = 1;; ++attempt) {
+    if (m_shutdown.cancelled())
+      throw OutlineShutdownException(
+          "Request cancelled at the shutdown deadline");
+    throwIfCancelled();
+    if (!m_circuitBreaker->allow(host))
+      throw OutlineCircuitOpenException(host);
+    auto permit = co_await acquireRequestSlotAsync(host);
+    std::pair<int, std::string> response;
+    std::exception_ptr error;
+    try {
+      response = co_await sendAsync(req, statusOnly);
+    } catch (const OutlineCertificateException&) {
+      // No retry makes the server present another certificate.
+      throw;
+    } catch (...) {
+      error = std::current_exception();
+    }
+    if (error)
+      throwIfCancelled();
+    const bool failed = error || isRetryableStatus(response.first);
+    permit.finish(!failed);
+    if (!failed) {
+      m_circuitBreaker->recordSuccess(host);
+      m_retryBudget.recordSuccess();
+      co_return response;
+    }
 
-  boost::system::error_code ec;
-  co_await sslStream.async_shutdown(
-      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
-  if (ec && ec != boost::asio::error::eof)
-    throw boost::system::system_error(ec);
+    m_circuitBreaker->recordFailure(host);
+    m_retryBudget.recordFailure();
+    if (!retryable || attempt >= m_retry.maxAttempts ||
+        !m_retryBudget.canRetry()) {
+      if (error)
+        std::rethrow_exception(error);
+      co_return response;
+    }
+    // A cancelled request stops waiting and fails at the loop's top.
+    boost::asio::steady_timer timer(executor, backoff.next());
+    auto cancel =
+        onCancel(m_shutdown, executor, [&timer]() { timer.cancel(); });
+    boost::system::error_code ec;
+    co_await timer.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  }
+}
+
+struct OutlineClient::HedgeRace {
+  HedgeRace(boost::asio::any_io_executor executor,
+            network::RequestPriority priority)
+      : executor(executor), priority(priority), wake(executor) {}
+
+  // Cancels every attempt; the loser's connection is closed.
+  void cancel() {
+    for (auto& signal : signals)
+      signal->emit();
+  }
+  // Leaves the attempts still running without the request's span once the
+  // request stops waiting for them and the span ends.
+  void detach() {
+    for (auto& trace : traces)
+      trace->caller.reset();
+  }
+
+  boost::asio::any_io_executor executor;
+  network::RequestPriority priority;
+  // Woken when an attempt finishes.
+  boost::asio::steady_timer wake;
+  std::vector<std::shared_ptr<network::CancellationSignal>> signals;
+  std::vector<std::shared_ptr<network::TraceContext>> traces;
+  std::size_t running = 0;
+  // Index of the attempt that answered first.
+  std::optional<std::size_t> winner;
+  std::pair<int, std::string> response;
+  std::exception_ptr error;
+};
+
+bool OutlineClient::startHedgeAttempt(const std::shared_ptr<HedgeRace>& race,
+                                      http::request<http::string_body> req) {
+  auto ticket = m_shutdown.admit();
+  if (!ticket)
+    return false;
+  auto signal = std::make_shared<network::CancellationSignal>();
+  const std::size_t index = race->signals.size();
+  race->signals.push_back(signal);
+  ++race->running;
+  // The attempt's contexts replace the request's around the same strand.
+  boost::asio::any_io_executor strand = race->executor;
+  if (auto* request =
+          strand.target<network::ContextExecutor<network::RequestContext>>()) {
+    boost::asio::any_io_executor inner = request->inner();
+    strand = std::move(inner);
+  }
+#ifndef OUTLINE_DISABLE_TRACING
+  // Each attempt keeps its own span stack; on the request's, the spans of
+  // two attempts would nest into each other.
+  auto* tracing = strand.target<network::TracingExecutor>();
+  if (auto* trace = network::TraceContext::active(); tracing && trace) {
+    // Not owned: detach() drops it before the span ends.
+    std::shared_ptr<network::Span> parent(std::shared_ptr<network::Span>(),
+                                          trace->parent());
+    auto attemptTrace =
+        std::make_shared<network::TraceContext>(trace->tracer, parent);
+    race->traces.push_back(attemptTrace);
+    boost::asio::any_io_executor inner = tracing->inner();
+    strand = network::TracingExecutor(std::move(inner), attemptTrace);
+  }
+#endif
+  network::ContextExecutor<network::RequestContext> executor(
+      std::move(strand), std::make_shared<network::RequestContext>(
+                             network::RequestContext{race->priority, signal}));
+  // Captureless, so the coroutine doesn't outlive the closure's state.
+  auto attempt = [](OutlineClient* client, http::request<http::string_body> req)
+      -> boost::asio::awaitable<std::pair<int, std::string>> {
+    co_return co_await client->sendWithRetryAsync(req);
+  };
+  // The completion runs on the request's strand, like the waiting request.
+  boost::asio::co_spawn(
+      executor,
+      trackAsync(std::move(ticket), attempt(this, std::move(req))),
+      [race, index](std::exception_ptr error,
+                    std::pair<int, std::string> response) {
+        --race->running;
+        if (!race->winner) {
+          if (!error) {
+            race->winner = index;
+            race->response = std::move(response);
+            race->cancel();
+          } else if (!race->error) {
+            race->error = error;
+          }
+        }
+        race->wake.cancel();
+      });
+  return true;
+}
+
+boost::asio::awaitable<std::pair<int, std::string>>
+OutlineClient::sendHedgedAsync(http::request<http::string_body>& req,
+                               std::string_view endpoint) {
+  m_hedgeBudget.recordRequest();
+  auto percentile = m_instrumentation.endpointPercentile(
+      verbName(req.method()), endpoint, m_hedge.percentile,
+      m_hedge.minSamples);
+  if (!percentile)
+    co_return co_await sendWithRetryAsync(req);
+
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto race = std::make_shared<HedgeRace>(
+      executor, network::RequestContext::activePriority());
+  // Runs on every exit, so no attempt outlives the span it parents to.
+  struct Detach {
+    ~Detach() { race.detach(); }
+    HedgeRace& race;
+  } detach{*race};
+  if (!startHedgeAttempt(race, req))
+    co_return co_await sendWithRetryAsync(req);
+  // The caller's signal cancels both attempts.
+  network::CancellationSignal::Slot forward;
+  if (auto* context = network::RequestContext::active();
+      context && context->cancellation) {
+    forward = context->cancellation->connect(
+        executor, [race]() { race->cancel(); });
+  }
+  auto wait = [](HedgeRace& race) -> boost::asio::awaitable<void> {
+    boost::system::error_code ec;
+    co_await race.wake.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  };
+
+  race->wake.expires_after(hedgeDelay(m_hedge, *percentile));
+  co_await wait(*race);
+  // A failed first attempt already went through its retries.
+  if (!race->winner && race->running > 0 && m_hedgeBudget.trySpend() &&
+      startHedgeAttempt(race, req)) {
+    m_instrumentation.hedgeSent();
+  }
+  race->wake.expires_at(boost::asio::steady_timer::time_point::max());
+  while (!race->winner && race->running > 0)
+    co_await wait(*race);
+  if (!race->winner)
+    std::rethrow_exception(race->error);
+  if (*race->winner > 0)
+    m_instrumentation.hedgeWon();
+  co_return std::move(race->response);
+}
+
+boost::asio::awaitable<std::vector<std::pair<int, std::string>>>
+OutlineClient::sendPipelinedAsync(
+    std::vector<http::request<http::string_body>>& reqs) {
+  std::vector<std::pair<int, std::string>> responses;
+  responses.reserve(reqs.size());
+  if (reqs.size() > 1 && !m_pipeliningRejected.load()) {
+    std::string host = m_apiUrl.host();
+    std::string port = requestPort(m_apiUrl);
+    auto permit = co_await acquireRequestSlotAsync(host + ":" + port);
+    auto conn = co_await leaseConnectionAsync(host, port);
+    auto cancel = onCancel(m_shutdown,
+                           co_await boost::asio::this_coro::executor,
+                           closeOnCancel(*conn));
+
+    boost::system::error_code ec;
+    std::size_t written = 0;
+    for (auto& req : reqs) {
+      prepareRequest(req, host, true);
+      ec = co_await writeRequestAsync(*conn, req);
+      if (ec)
+        break;
+      ++written;
+    }
+
+    // Responses arrive in request order and may share the read buffer.
+    conn->buffer.clear();
+    bool closed = false;
+    while (!closed && responses.size() < written) {
+      http::response_parser<network::DecodingBody> parser;
+      parser.get().body().discard = true;
+      ec = co_await readResponseAsync(*conn, parser);
+      if (ec)
+        break;
+      auto res = parser.release();
+      closed = !res.keep_alive();
+      responses.emplace_back(static_cast<int>(res.result_int()),
+                             std::string());
+    }
+    if (ec && !isStaleConnectionError(ec))
+      throw boost::system::system_error(ec);
+
+    permit.finish(!responses.empty());
+    if (responses.size() == reqs.size() && !closed) {
+      conn.markReusable();
+    } else if (!responses.empty() || !conn.reused()) {
+      // The server gave up on the pipeline rather than on an idle socket.
+      m_pipeliningRejected = true;
+    }
+  }
+
+  // Only idempotent requests are pipelined, so unanswered ones can be sent
+  // again.
+  for (std::size_t i = responses.size(); i < reqs.size(); ++i)
+    responses.push_back(co_await sendWithRetryAsync(reqs[i], true));
+  co_return responses;
+}
+
+boost::asio::awaitable<int> OutlineClient::doGetStreamingAsync(
+    RequestTarget target,
+    const std::function<void(std::string_view)>& onChunk) {
+  const std::string_view endpoint = target.endpoint;
+  network::TraceSpan span("GET", endpoint);
+  startRequestSpan(span, http::verb::get, endpoint, 0);
+  m_instrumentation.requestStarted();
+  auto start = std::chrono::steady_clock::now();
+  int status = 0;
+  std::size_t received = 0;
+  try {
+    if (span) {
+      status = co_await sendStreamingAsync(
+          target.target, [&received, &onChunk](std::string_view chunk) {
+            received += chunk.size();
+            onChunk(chunk);
+          });
+    } else {
+      status = co_await sendStreamingAsync(target.target, onChunk);
+    }
+  } catch (...) {
+    recordRequest(m_instrumentation, span, http::verb::get, endpoint, start,
+                  0, received, std::current_exception());
+    throw;
+  }
+  recordRequest(m_instrumentation, span, http::verb::get, endpoint, start,
+                status, received, nullptr);
+  co_return status;
+}
+
+boost::asio::awaitable<int> OutlineClient::sendStreamingAsync(
+    std::string_view target,
+    const std::function<void(std::string_view)>& onChunk) {
+  std::string host =
+      std::string(m_apiUrl.host()) + ":" + requestPort(m_apiUrl);
+  if (!m_circuitBreaker->allow(host))
+    throw OutlineCircuitOpenException(host);
+  // An error of the caller's callback says nothing about the host.
+  bool callbackFailed = false;
+  std::function<void(std::string_view)> deliver =
+      [&onChunk, &callbackFailed](std::string_view chunk) {
+        try {
+          onChunk(chunk);
+        } catch (...) {
+          callbackFailed = true;
+          throw;
+        }
+      };
+  int status = 0;
+  std::exception_ptr error;
+  try {
+    status = co_await streamOnceAsync(target, deliver);
+  } catch (const OutlineCertificateException&) {
+    throw;
+  } catch (...) {
+    error = std::current_exception();
+  }
+  if (error) {
+    throwIfCancelled();
+    if (!callbackFailed)
+      m_circuitBreaker->recordFailure(host);
+    std::rethrow_exception(error);
+  }
+  if (isRetryableStatus(status))
+    m_circuitBreaker->recordFailure(host);
+  else
+    m_circuitBreaker->recordSuccess(host);
+  co_return status;
+}
+
+boost::asio::awaitable<int> OutlineClient::streamOnceAsync(
+    std::string_view target,
+    const std::function<void(std::string_view)>& onChunk) {
+  std::string host = m_apiUrl.host();
+  std::string port = requestPort(m_apiUrl);
+  auto req = makeRequest(http::verb::get, target);
+  prepareRequest(req, host);
+
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto permit = co_await acquireRequestSlotAsync(host + ":" + port);
+  for (bool retried = false;; retried = true) {
+    auto conn = co_await leaseConnectionAsync(host, port);
+    auto cancel = onCancel(m_shutdown, executor, closeOnCancel(*conn));
+    auto ec = co_await writeRequestAsync(*conn, req);
+    http::response_parser<http::buffer_body> parser;
+    parser.body_limit(boost::none);
+    // Covers the header and the whole body.
+    network::Instrumentation::PhaseTimer readTimer(m_instrumentation,
+                                                   network::Phase::Read);
+    network::TraceSpan readSpan("read");
+    if (!ec) {
+      conn->buffer.clear();
+      network::Deadline deadline(executor, *m_timeouts.read,
+                                 cancelOnExpiry(*conn));
+      m_instrumentation.addBytesReceived(co_await http::async_read_header(
+          conn->stream, conn->buffer, parser,
+          boost::asio::redirect_error(boost::asio::use_awaitable, ec)));
+      if (deadline.expired())
+        throw phaseTimeout("Reading response", conn->key, *m_timeouts.read);
+    }
+    if (ec) {
+      // Nothing was handed to the caller yet, so a stale socket can still
+      // be retried like in sendAsync().
+      if (conn.reused() && !retried && isStaleConnectionError(ec))
+        continue;
+      throw boost::system::system_error(ec);
+    }
+
+    int status = static_cast<int>(parser.get().result_int());
+    if (status != 200) {
+      // The body isn't read, so the connection can't be reused.
+      permit.finish(!isRetryableStatus(status));
+      co_return status;
+    }
+
+    auto encoding = parser.get()[http::field::content_encoding];
+    auto coding = network::ContentDecoder::parse(
+        std::string_view(encoding.data(), encoding.size()));
+    if (!coding) {
+      throw boost::system::system_error(boost::system::errc::make_error_code(
+          boost::system::errc::not_supported));
+    }
+    // Compressed chunks are decoded one by one, so the caller still gets
+    // the body piece by piece.
+    network::ContentDecoder decoder(*coding);
+    std::string decoded;
+
+    // The read limit applies to each chunk, so a large body only fails when
+    // the server stalls.
+    char chunk[16 * 1024];
+    while (!parser.is_done()) {
+      parser.get().body().data = chunk;
+      parser.get().body().size = sizeof(chunk);
+      {
+        network::Deadline deadline(executor, *m_timeouts.read,
+                                   cancelOnExpiry(*conn));
+        m_instrumentation.addBytesReceived(co_await http::async_read_some(
+            conn->stream, conn->buffer, parser,
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec)));
+        if (deadline.expired())
+          throw phaseTimeout("Reading response", conn->key, *m_timeouts.read);
+      }
+      if (ec == http::error::need_buffer)
+        ec = {};
+      if (ec)
+        throw boost::system::system_error(ec);
+      std::string_view piece(chunk, sizeof(chunk) - parser.get().body().size);
+      if (piece.empty())
+        continue;
+      if (decoder.coding() == network::ContentDecoder::Coding::Identity) {
+        onChunk(piece);
+        continue;
+      }
+      decoded.clear();
+      if (auto error = decoder.decode(piece, decoded))
+        throw boost::system::system_error(error);
+      if (!decoded.empty())
+        onChunk(decoded);
+    }
+    if (auto error = decoder.finish())
+      throw boost::system::system_error(error);
+    if (parser.keep_alive())
+      conn.markReusable();
+    permit.finish(true);
+    co_return status;
+  }
+}
+
+boost::asio::awaitable<std::shared_ptr<const std::string>>
+OutlineClient::cachedGetAsync(
+    std::string key,
+    std::function<boost::asio::awaitable<network::ResponseCache::Body>()>
+        fetch) {
+  if (!m_cache.enabled())
+    co_return co_await fetch();
+  if (auto body = m_cache.get(key))
+    co_return body;
+  auto generation = m_cache.generation();
+  auto body = co_await fetch();
+  m_cache.put(key, body, generation);
+  co_return body;
+}
+
+boost::asio::awaitable<std::string> OutlineClient::validateJsonAsync(
+    boost::asio::awaitable<std::string> body, const char* what) {
+  auto result = co_await std::move(body);
+  m_jsonArenas.acquire().parse(result, what);
+  co_return result;
+}
+
+http::request<http::string_body> OutlineClient::makeRequest(
+    http::verb verb, std::string_view target, std::string body) {
+  http::request<http::string_body> req{
+      verb, boost::beast::string_view(target.data(), target.size()), 11};
+  if (verb == http::verb::post || verb == http::verb::put) {
+    req.set(http::field::content_type, "application/json");
+    req.body() = std::move(body);
+    req.prepare_payload();
+  }
+  return req;
+}
+
+template <http::verb Verb>
+boost::asio::awaitable<std::pair<int, std::string>>
+OutlineClient::doRequestAsync(RequestTarget target, std::string body,
+                              bool statusOnly) {
+  static_assert(Verb == http::verb::post || Verb == http::verb::put ||
+                    Verb == http::verb::get || Verb == http::verb::delete_,
+                "unsupported verb");
+  const std::string_view endpoint = target.endpoint;
+  auto req = makeRequest(Verb, target.target, std::move(body));
+  network::TraceSpan span(verbName(Verb), endpoint);
+  startRequestSpan(span, Verb, endpoint, req.body().size());
+  m_instrumentation.requestStarted();
+  auto start = std::chrono::steady_clock::now();
+  std::pair<int, std::string> response;
+  try {
+    if constexpr (Verb == http::verb::get) {
+      if (m_hedge.enabled)
+        response = co_await sendHedgedAsync(req, endpoint);
+      else
+        response = co_await sendWithRetryAsync(req);
+    } else {
+      response = co_await sendWithRetryAsync(req, statusOnly);
+    }
+  } catch (...) {
+    recordRequest(m_instrumentation, span, Verb, endpoint, start, 0, 0,
+                  std::current_exception());
+    throw;
+  }
+  recordRequest(m_instrumentation, span, Verb, endpoint, start,
+                response.first, response.second.size(), nullptr);
+  co_return response;
+}
+
+boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::doGetAsync(
+    RequestTarget target) {
+  return doRequestAsync<http::verb::get>(std::move(target));
+}
+
+boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::doPostAsync(
+    RequestTarget target, std::string body) {
+  return doRequestAsync<http::verb::post>(std::move(target), std::move(body));
+}
+
+boost::asio::awaitable<std::pair<int, std::string>> OutlineClient::doPutAsync(
+    RequestTarget target, std::string body) {
+  return doRequestAsync<http::verb::put>(std::move(target), std::move(body));
+}
+
+boost::asio::awaitable<std::pair<int, std::string>>
+OutlineClient::doDeleteAsync(RequestTarget target) {
+  return doRequestAsync<http::verb::delete_>(std::move(target));
+}
+
+boost::asio::awaitable<int> OutlineClient::doPutStatusAsync(
+    RequestTarget target, std::string body) {
+  co_return (co_await doRequestAsync<http::verb::put>(
+                 std::move(target), std::move(body), true))
+      .first;
+}
 
-  co_return std::make_pair(static_cast<int>(res.result_int()),
-                           boost::beast::buffers_to_string(res.body().data()));
+boost::asio::awaitable<int> OutlineClient::doDeleteStatusAsync(
+    RequestTarget target) {
+  co_return (co_await doRequestAsync<http::verb::delete_>(std::move(target),
+                                                           {}, true))
+      .first;
 }
 
 }  // namespace outline
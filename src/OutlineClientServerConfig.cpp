@@ -1,7 +1,7 @@
 #include "outline/OutlineClient.h"
 #include "outline/constants/ApiEndpoint.h"
 #include "outline/exceptions/OutlineExceptions.h"
-#include "outline/utils/UrlUtils.h"
+#include "outline/utils/JsonUtils.h"
 
 #include <boost/json.hpp>
 #include <future>
@@ -9,132 +9,153 @@
 #include <string>
 
 namespace outline {
+boost::asio::awaitable<std::shared_ptr<const std::string>>
+OutlineClient::requestServerInformationSharedAsync() {
+  co_return co_await cachedGetAsync(
+      "server",
+      [this]() -> boost::asio::awaitable<std::shared_ptr<const std::string>> {
+        co_return co_await m_serverInfoFlight.run(
+            [this]() {
+              return backgroundAsync(fetchServerInformationBodyAsync());
+            },
+            [this]() { return makeRequestExecutor(false); });
+      });
+}
+
+boost::asio::awaitable<std::string>
+OutlineClient::fetchServerInformationBodyAsync() {
+  auto [status, body] =
+      co_await doGetAsync(targetOf<api::Endpoints::GetServerInformation>());
+  if (status != 200) {
+    throw OutlineServerErrorException(
+        "Unable to get server information (status=" + std::to_string(status) +
+        ")");
+  }
+  co_return std::move(body);
+}
+
+boost::asio::awaitable<std::string>
+OutlineClient::requestServerInformationAsync() {
+  co_return *co_await requestServerInformationSharedAsync();
+}
+
+boost::asio::awaitable<ServerInfo>
+OutlineClient::requestServerInformationTypedAsync() {
+  auto body = co_await requestServerInformationSharedAsync();
+  auto arena = m_jsonArenas.acquire();
+  co_return utils::jsonTo<ServerInfo>(arena.parse(*body, "server"), "server");
+}
+
+boost::asio::awaitable<void> OutlineClient::requestSetServerNameAsync(
+    std::string serverName) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object serverObj({{"name", serverName}}, arena.storage());
+  int status = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::SetServerName>(),
+      boost::json::serialize(serverObj));
+  m_cache.invalidate("server");
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to set server name (status=" + std::to_string(status) + ")");
+  }
+}
+
+boost::asio::awaitable<void> OutlineClient::requestSetHostNameAsync(
+    std::string hostName) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object hostObj({{"hostname", hostName}}, arena.storage());
+  int status = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::SetHostName>(),
+      boost::json::serialize(hostObj));
+  // The access URL of every cached key names the old host.
+  m_cache.clear();
+  if (status != 204) {
+    throw OutlineServerErrorException("Unable to set host name (status=" +
+                                      std::to_string(status) + ")");
+  }
+}
+
+boost::asio::awaitable<void> OutlineClient::requestSetDefaultPortAsync(
+    int port) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object portObj({{"port", port}}, arena.storage());
+  int status = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::SetDefaultPort>(),
+      boost::json::serialize(portObj));
+  m_cache.invalidate("server");
+  if (status == 400) {
+    throw OutlineServerErrorException(
+        "The requested port isn't valid or missing.");
+  }
+  if (status == 409) {
+    throw OutlineServerErrorException("The requested port is already in use.");
+  }
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to set default port (status=" + std::to_string(status) + ")");
+  }
+}
+
+boost::asio::awaitable<void>
+OutlineClient::requestSetDataLimitForAllAccessKeysAsync(int dataLimitBytes) {
+  auto arena = m_jsonArenas.acquire();
+  boost::json::object dataLimitObj({{"bytes", dataLimitBytes}},
+                                   arena.storage());
+  int status = co_await doPutStatusAsync(
+      targetOf<api::Endpoints::SetDataLimitForAllAccessKeys>(),
+      boost::json::serialize(dataLimitObj));
+  m_cache.invalidate("server");
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to set data limit for all (status=" + std::to_string(status) +
+        ")");
+  }
+}
+
+boost::asio::awaitable<void>
+OutlineClient::requestDeleteDataLimitForAllAccessKeysAsync() {
+  int status = co_await doDeleteStatusAsync(
+      targetOf<api::Endpoints::DeleteDataLimitForAllAccessKeys>());
+  m_cache.invalidate("server");
+  if (status != 204) {
+    throw OutlineServerErrorException(
+        "Unable to delete data limit for all (status=" +
+        std::to_string(status) + ")");
+  }
+}
+
 std::future<std::string> OutlineClient::getServerInformationAsync() {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this]() -> boost::asio::awaitable<std::string> {
-        auto url = utils::appendUrl(
-            m_apiUrl, std::string(api::Endpoints::GetServerInformation));
-        auto [status, body] = co_await doGetAsync(url);
-        if (status != 200) {
-          throw OutlineServerErrorException(
-              "Unable to get server information (status=" +
-              std::to_string(status) + ")");
-        }
-        boost::json::value serverVal;
-        try {
-          serverVal = boost::json::parse(body);
-        } catch (const std::exception& e) {
-          throw OutlineParseException(
-              std::string("JSON parse error for server: ") + e.what());
-        }
-        co_return boost::json::serialize(serverVal);
-      },
-      boost::asio::use_future);
+  return getServerInformation(boost::asio::use_future);
+}
+
+std::future<std::string> OutlineClient::getServerInformationRawAsync() {
+  return getServerInformationRaw(boost::asio::use_future);
+}
+
+std::future<ServerInfo> OutlineClient::getServerInformationTypedAsync() {
+  return getServerInformationTyped(boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::setServerNameAsync(
     const std::string& serverName) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, serverName]() -> boost::asio::awaitable<void> {
-        auto url = utils::appendUrl(m_apiUrl,
-                                    std::string(api::Endpoints::SetServerName));
-        boost::json::object serverObj{{"name", serverName}};
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(serverObj));
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to set server name (status=" + std::to_string(status) +
-              ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return setServerName(serverName, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::setHostNameAsync(const std::string& hostName) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, hostName]() -> boost::asio::awaitable<void> {
-        auto url = utils::appendUrl(m_apiUrl,
-                                    std::string(api::Endpoints::SetHostName));
-        boost::json::object hostObj{{"hostname", hostName}};
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(hostObj));
-        if (status != 204) {
-          throw OutlineServerErrorException("Unable to set host name (status=" +
-                                            std::to_string(status) + ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return setHostName(hostName, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::setDefaultPortAsync(int port) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, port]() -> boost::asio::awaitable<void> {
-        auto url = utils::appendUrl(
-            m_apiUrl, std::string(api::Endpoints::SetDefaultPort));
-        boost::json::object portObj{{"port", port}};
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(portObj));
-        if (status == 400) {
-          throw OutlineServerErrorException(
-              "The requested port isn't valid or missing.");
-        }
-        if (status == 409) {
-          throw OutlineServerErrorException(
-              "The requested port is already in use.");
-        }
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to set default port (status=" + std::to_string(status) +
-              ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return setDefaultPort(port, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::setDataLimitForAllAccessKeysAsync(
     int dataLimitBytes) {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this, dataLimitBytes]() -> boost::asio::awaitable<void> {
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            std::string(api::Endpoints::SetDataLimitForAllAccessKeys));
-        boost::json::object dataLimitObj{{"bytes", dataLimitBytes}};
-        auto [status, responseBody] =
-            co_await doPutAsync(url, boost::json::serialize(dataLimitObj));
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to set data limit for all (status=" +
-              std::to_string(status) + ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return setDataLimitForAllAccessKeys(dataLimitBytes, boost::asio::use_future);
 }
 
 std::future<void> OutlineClient::deleteDataLimitForAllAccessKeysAsync() {
-  return boost::asio::co_spawn(
-      m_ioContext,
-      [this]() -> boost::asio::awaitable<void> {
-        auto url = utils::appendUrl(
-            m_apiUrl,
-            std::string(api::Endpoints::DeleteDataLimitForAllAccessKeys));
-        auto [status, responseBody] = co_await doDeleteAsync(url);
-        if (status != 204) {
-          throw OutlineServerErrorException(
-              "Unable to delete data limit for all (status=" +
-              std::to_string(status) + ")");
-        }
-        co_return;
-      },
-      boost::asio::use_future);
+  return deleteDataLimitForAllAccessKeys(boost::asio::use_future);
 }
 
 void OutlineClient::setServerName(const std::string& serverName) {
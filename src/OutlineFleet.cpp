@@ -0,0 +1,220 @@
+#include "outline/OutlineFleet.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <string>
+#include <type_traits>
+
+namespace outline {
+
+OutlineFleet::OutlineFleet(const OutlineClientOptions& options)
+    : m_options(options) {
+  boost::asio::any_io_executor executor;
+  if (options.executor) {
+    executor = *options.executor;
+  } else {
+    std::size_t threads = std::max<std::size_t>(1, options.ioThreads);
+    m_ioContext =
+        std::make_unique<boost::asio::io_context>(static_cast<int>(threads));
+    m_workGuard.emplace(boost::asio::make_work_guard(*m_ioContext));
+    executor = m_ioContext->get_executor();
+    m_ioThreads.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+      m_ioThreads.emplace_back([this]() { m_ioContext->run(); });
+  }
+  m_resources = OutlineClientResources::create(options, std::move(executor));
+}
+
+OutlineFleet::~OutlineFleet() {
+  // The clients post to the loop and own timers on it until they are gone,
+  // so they are drained and destroyed before it stops.
+  decltype(m_clients) clients;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    clients.swap(m_clients);
+  }
+  for (auto& [name, client] : clients) {
+    client->m_shutdown.close();
+    client->m_shutdown.cancel();
+  }
+  for (auto& [name, client] : clients)
+    client->m_shutdown.wait();
+  m_fanOuts.close();
+  m_fanOuts.wait();
+  clients.clear();
+
+  if (m_ioContext) {
+    m_workGuard.reset();
+    m_ioContext->stop();
+    for (auto& thread : m_ioThreads) {
+      if (thread.joinable())
+        thread.join();
+    }
+  }
+  m_resources.pool->clear();
+  m_ioContext.reset();
+}
+
+std::shared_ptr<OutlineClient> OutlineFleet::addServer(std::string_view apiUrl,
+                                                       std::string_view cert,
+                                                       int timeout) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_clients.find(apiUrl);
+  if (it != m_clients.end())
+    return it->second;
+  auto client = std::make_shared<OutlineClient>(apiUrl, cert, timeout,
+                                                m_options, m_resources);
+  m_clients.emplace(std::string(apiUrl), client);
+  return client;
+}
+
+bool OutlineFleet::removeServer(std::string_view apiUrl) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_clients.find(apiUrl);
+  if (it == m_clients.end())
+    return false;
+  m_clients.erase(it);
+  return true;
+}
+
+std::shared_ptr<OutlineClient> OutlineFleet::server(
+    std::string_view apiUrl) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_clients.find(apiUrl);
+  return it == m_clients.end() ? nullptr : it->second;
+}
+
+std::vector<std::string> OutlineFleet::servers() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<std::string> names;
+  names.reserve(m_clients.size());
+  for (const auto& [name, client] : m_clients)
+    names.push_back(name);
+  return names;
+}
+
+std::size_t OutlineFleet::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_clients.size();
+}
+
+network::TlsSessionStats OutlineFleet::getTlsSessionStats() const {
+  return m_resources.sessionCache ? m_resources.sessionCache->stats()
+                                  : network::TlsSessionStats{};
+}
+
+// Every server gets its own request on its own strand; results are handed
+// to onResult under a mutex in the order they finish.
+template <typename T>
+std::future<std::size_t> OutlineFleet::fanOutAsync(
+    std::function<boost::asio::awaitable<T>(OutlineClient&)> call,
+    std::function<void(FleetResult<T>&&)> onResult) {
+  struct State {
+    std::function<void(FleetResult<T>&&)> onResult;
+    std::mutex mutex;
+    std::exception_ptr callbackError;
+    std::atomic<std::size_t> remaining{0};
+    std::size_t total = 0;
+    std::promise<std::size_t> promise;
+  };
+
+  std::vector<std::pair<std::string, std::shared_ptr<OutlineClient>>> clients;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    clients.assign(m_clients.begin(), m_clients.end());
+  }
+
+  auto state = std::make_shared<State>();
+  state->onResult = std::move(onResult);
+  state->total = clients.size();
+  state->remaining = clients.size();
+  auto future = state->promise.get_future();
+  if (clients.empty()) {
+    state->promise.set_value(0);
+    return future;
+  }
+
+  for (auto& [name, client] : clients) {
+    // Through the client's spawn(), so a shut down client rejects the call
+    // and its drain waits for one in flight.
+    client->spawn(
+        call(*client),
+        [state, name = name, client = client, ticket = m_fanOuts.admit()](
+            std::exception_ptr error, auto&&... value) mutable {
+          FleetResult<T> result;
+          result.server = name;
+          result.error = error;
+          if constexpr (!std::is_void_v<T>) {
+            if (!error)
+              ((result.value = std::move(value)), ...);
+          }
+          {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            try {
+              state->onResult(std::move(result));
+            } catch (...) {
+              if (!state->callbackError)
+                state->callbackError = std::current_exception();
+            }
+          }
+          if (--state->remaining == 0) {
+            if (state->callbackError)
+              state->promise.set_exception(state->callbackError);
+            else
+              state->promise.set_value(state->total);
+          }
+          // The client may have been removed meanwhile; its destructor waits
+          // for its requests, so it must not run on the loop they need.
+          // The ticket goes after it, so the fleet's destructor waits.
+          boost::asio::post(boost::asio::system_executor(),
+                            [client = std::move(client),
+                             ticket = std::move(ticket)]() mutable {
+                              client.reset();
+                            });
+        });
+  }
+  return future;
+}
+
+std::future<std::size_t> OutlineFleet::getMetricsAllAsync(
+    std::function<void(FleetResult<TransferMetrics>&&)> onResult) {
+  return fanOutAsync<TransferMetrics>(
+      [](OutlineClient& client) { return client.requestMetricsTypedAsync(); },
+      std::move(onResult));
+}
+
+std::future<std::size_t> OutlineFleet::getServerInformationAllAsync(
+    std::function<void(FleetResult<ServerInfo>&&)> onResult) {
+  return fanOutAsync<ServerInfo>(
+      [](OutlineClient& client) {
+        return client.requestServerInformationTypedAsync();
+      },
+      std::move(onResult));
+}
+
+std::future<std::size_t> OutlineFleet::getAccessKeysAllAsync(
+    std::function<void(FleetResult<std::vector<AccessKey>>&&)> onResult) {
+  return fanOutAsync<std::vector<AccessKey>>(
+      [](OutlineClient& client) {
+        return client.requestAccessKeysTypedAsync();
+      },
+      std::move(onResult));
+}
+
+std::size_t OutlineFleet::getMetricsAll(
+    std::function<void(FleetResult<TransferMetrics>&&)> onResult) {
+    return getMetricsAllAsync(std::move(onResult)).get();
+}
+
+std::size_t OutlineFleet::getServerInformationAll(
+    std::function<void(FleetResult<ServerInfo>&&)> onResult) {
+    return getServerInformationAllAsync(std::move(onResult)).get();
+}
+
+std::size_t OutlineFleet::getAccessKeysAll(
+    std::function<void(FleetResult<std::vector<AccessKey>>&&)> onResult) {
+    return getAccessKeysAllAsync(std::move(onResult)).get();
+}
+
+}  // namespace outline
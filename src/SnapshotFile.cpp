@@ -0,0 +1,258 @@
+#include "outline/SnapshotFile.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "outline/exceptions/OutlineExceptions.h"
+
+namespace outline {
+
+namespace {
+
+constexpr char kMagic[8] = {'O', 'U', 'T', 'L', 'S', 'N', 'A', 'P'};
+constexpr std::uint32_t kFormatVersion = 1;
+constexpr std::uint32_t kByteOrder = 0x01020304;
+constexpr std::int64_t kUnset = -1;
+
+// Server info strings, in the order they are stored.
+enum ServerString {
+  kServerName,
+  kServerId,
+  kServerVersion,
+  kServerHostname,
+  kServerStrings
+};
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  // kByteOrder as written; a file from a machine of the other byte order
+  // reads it reversed.
+  std::uint32_t byteOrder;
+  std::uint64_t fileSize;
+  std::uint64_t sourceHash;
+  std::int64_t fetchedAtMs;
+  std::uint64_t keyCount;
+  std::uint64_t keyTextSize;
+  std::uint64_t unmatchedBytes;
+  std::int64_t createdTimestampMs;
+  std::int64_t accessKeyDataLimitBytes;
+  std::int32_t portForNewAccessKeys;
+  std::uint32_t metricsEnabled;
+  std::uint32_t serverStringSizes[kServerStrings];
+};
+
+static_assert(std::is_trivially_copyable_v<Header>);
+static_assert(sizeof(Header) % 8 == 0);
+
+// FNV-1a, stable across builds unlike std::hash.
+std::uint64_t hashSource(std::string_view source) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : source) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::size_t padded(std::size_t size) {
+  return (size + 7) & ~std::size_t{7};
+}
+
+// Positions of the sections after the header, in file order.
+struct Layout {
+  Layout(const Header& header, std::size_t serverTextSize) {
+    const std::size_t keys = header.keyCount;
+    serverText = sizeof(Header);
+    keyText = serverText + padded(serverTextSize);
+    ids = keyText + padded(header.keyTextSize);
+    names = ids + padded(keys * 8);
+    dataLimits = names + padded(keys * 8);
+    bytes = dataLimits + padded(keys * 8);
+    ports = bytes + padded(keys * 8);
+    end = ports + padded(keys * 2);
+  }
+
+  std::size_t serverText;
+  std::size_t keyText;
+  std::size_t ids;
+  std::size_t names;
+  std::size_t dataLimits;
+  std::size_t bytes;
+  std::size_t ports;
+  std::size_t end;
+};
+
+template <typename T>
+void writeColumn(std::string& out, std::size_t offset,
+                 const std::vector<T>& column) {
+  if (!column.empty())
+    std::memcpy(out.data() + offset, column.data(), column.size() * sizeof(T));
+}
+
+template <typename T>
+void readColumn(const char* data, std::size_t offset, std::size_t count,
+                std::vector<T>& column) {
+  column.resize(count);
+  if (count != 0)
+    std::memcpy(column.data(), data + offset, count * sizeof(T));
+}
+
+std::int64_t toMs(std::chrono::system_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+void ServerSnapshot::seedMetrics(MetricsDeltaEngine& engine) const {
+  auto age = std::chrono::system_clock::now() - fetchedAt;
+  engine.clear();
+  engine.begin(MetricsDeltaEngine::Clock::now() -
+               std::chrono::duration_cast<MetricsDeltaEngine::Clock::duration>(
+                   age));
+  for (AccessKeySnapshot::Row row = 0; row < accessKeys.size(); ++row)
+    engine.update(accessKeys.id(row), accessKeys.bytes(row));
+  engine.finish();
+}
+
+void SnapshotFile::save(const std::string& path, std::string_view source,
+                        const ServerSnapshot& snapshot) {
+  const ServerInfo& info = snapshot.serverInfo;
+  const AccessKeySnapshot& keys = snapshot.accessKeys;
+  static_assert(sizeof(AccessKeySnapshot::TextRef) == 8);
+  const std::string* strings[kServerStrings] = {
+      &info.name, &info.serverId, &info.version, &info.hostnameForAccessKeys};
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFormatVersion;
+  header.byteOrder = kByteOrder;
+  header.sourceHash = hashSource(source);
+  header.fetchedAtMs = toMs(snapshot.fetchedAt);
+  header.keyCount = keys.size();
+  header.keyTextSize = keys.m_text.size();
+  header.unmatchedBytes = keys.m_unmatchedBytes;
+  header.createdTimestampMs = info.createdTimestampMs;
+  header.accessKeyDataLimitBytes =
+      info.accessKeyDataLimitBytes.value_or(kUnset);
+  header.portForNewAccessKeys = info.portForNewAccessKeys.value_or(kUnset);
+  header.metricsEnabled = info.metricsEnabled;
+  std::size_t serverTextSize = 0;
+  for (int i = 0; i < kServerStrings; ++i) {
+    header.serverStringSizes[i] =
+        static_cast<std::uint32_t>(strings[i]->size());
+    serverTextSize += strings[i]->size();
+  }
+  Layout layout(header, serverTextSize);
+  header.fileSize = layout.end;
+
+  std::string out(layout.end, '\0');
+  std::memcpy(out.data(), &header, sizeof(header));
+  std::size_t offset = layout.serverText;
+  for (const auto* string : strings) {
+    std::memcpy(out.data() + offset, string->data(), string->size());
+    offset += string->size();
+  }
+  std::memcpy(out.data() + layout.keyText, keys.m_text.data(),
+              keys.m_text.size());
+  writeColumn(out, layout.ids, keys.m_ids);
+  writeColumn(out, layout.names, keys.m_names);
+  writeColumn(out, layout.dataLimits, keys.m_dataLimits);
+  writeColumn(out, layout.bytes, keys.m_bytes);
+  writeColumn(out, layout.ports, keys.m_ports);
+
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    file.close();
+    if (!file)
+      throw std::runtime_error("Unable to write snapshot file " + temporary);
+  }
+  std::filesystem::rename(temporary, path);
+}
+
+std::optional<ServerSnapshot> SnapshotFile::load(const std::string& path,
+                                                 std::string_view source) {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(path, ec);
+  if (ec)
+    return std::nullopt;
+  if (size < sizeof(Header))
+    throw OutlineParseException("Snapshot file " + path + " is truncated");
+
+  namespace ipc = boost::interprocess;
+  ipc::file_mapping mapping(path.c_str(), ipc::read_only);
+  ipc::mapped_region region(mapping, ipc::read_only);
+  const char* data = static_cast<const char*>(region.get_address());
+
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+    throw OutlineParseException("Not a snapshot file: " + path);
+  if (header.version != kFormatVersion || header.byteOrder != kByteOrder ||
+      header.sourceHash != hashSource(source)) {
+    return std::nullopt;
+  }
+
+  std::size_t serverTextSize = 0;
+  for (auto stringSize : header.serverStringSizes)
+    serverTextSize += stringSize;
+  // Bounds the counts before they size anything.
+  if (header.fileSize != size || header.keyCount > size ||
+      header.keyTextSize > size || serverTextSize > size ||
+      Layout(header, serverTextSize).end != size) {
+    throw OutlineParseException("Snapshot file " + path + " is truncated");
+  }
+  Layout layout(header, serverTextSize);
+
+  ServerSnapshot snapshot;
+  snapshot.fetchedAt = std::chrono::system_clock::time_point(
+      std::chrono::milliseconds(header.fetchedAtMs));
+  ServerInfo& info = snapshot.serverInfo;
+  std::string* strings[kServerStrings] = {
+      &info.name, &info.serverId, &info.version, &info.hostnameForAccessKeys};
+  std::size_t offset = layout.serverText;
+  for (int i = 0; i < kServerStrings; ++i) {
+    strings[i]->assign(data + offset, header.serverStringSizes[i]);
+    offset += header.serverStringSizes[i];
+  }
+  info.metricsEnabled = header.metricsEnabled != 0;
+  info.createdTimestampMs = header.createdTimestampMs;
+  if (header.accessKeyDataLimitBytes != kUnset)
+    info.accessKeyDataLimitBytes = header.accessKeyDataLimitBytes;
+  if (header.portForNewAccessKeys != kUnset)
+    info.portForNewAccessKeys = header.portForNewAccessKeys;
+
+  AccessKeySnapshot& keys = snapshot.accessKeys;
+  const std::size_t count = header.keyCount;
+  keys.m_text.assign(data + layout.keyText, header.keyTextSize);
+  readColumn(data, layout.ids, count, keys.m_ids);
+  readColumn(data, layout.names, count, keys.m_names);
+  readColumn(data, layout.dataLimits, count, keys.m_dataLimits);
+  readColumn(data, layout.bytes, count, keys.m_bytes);
+  readColumn(data, layout.ports, count, keys.m_ports);
+  keys.m_unmatchedBytes = header.unmatchedBytes;
+  for (std::size_t row = 0; row < count; ++row) {
+    for (const auto& ref : {keys.m_ids[row], keys.m_names[row]}) {
+      if (std::uint64_t{ref.offset} + ref.size > header.keyTextSize) {
+        throw OutlineParseException("Snapshot file " + path +
+                                    " is corrupt");
+      }
+    }
+  }
+  keys.reindex();
+  return snapshot;
+}
+
+}  // namespace outline
@@ -0,0 +1,26 @@
+#include "outline/models/AccessKey.h"
+#include "outline/utils/JsonUtils.h"
+
+#include <boost/json.hpp>
+
+namespace outline {
+
+AccessKey tag_invoke(boost::json::value_to_tag<AccessKey>,
+                     const boost::json::value& jv) {
+  const auto& obj = jv.as_object();
+  AccessKey key;
+  key.id = boost::json::value_to<std::string>(obj.at("id"));
+  key.name = utils::stringOr(obj, "name");
+  key.password = utils::stringOr(obj, "password");
+  key.method = utils::stringOr(obj, "method");
+  key.accessUrl = utils::stringOr(obj, "accessUrl");
+  if (const auto* port = obj.if_contains("port"))
+    key.port = port->to_number<int>();
+  if (const auto* limit = obj.if_contains("dataLimit")) {
+    key.dataLimitBytes =
+        limit->as_object().at("bytes").to_number<std::int64_t>();
+  }
+  return key;
+}
+
+}  // namespace outline
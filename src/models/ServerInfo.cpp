@@ -0,0 +1,29 @@
+#include "outline/models/ServerInfo.h"
+#include "outline/utils/JsonUtils.h"
+
+#include <boost/json.hpp>
+
+namespace outline {
+
+ServerInfo tag_invoke(boost::json::value_to_tag<ServerInfo>,
+                      const boost::json::value& jv) {
+  const auto& obj = jv.as_object();
+  ServerInfo info;
+  info.name = utils::stringOr(obj, "name");
+  info.serverId = utils::stringOr(obj, "serverId");
+  info.version = utils::stringOr(obj, "version");
+  info.hostnameForAccessKeys = utils::stringOr(obj, "hostnameForAccessKeys");
+  if (const auto* enabled = obj.if_contains("metricsEnabled"))
+    info.metricsEnabled = enabled->as_bool();
+  if (const auto* created = obj.if_contains("createdTimestampMs"))
+    info.createdTimestampMs = created->to_number<std::int64_t>();
+  if (const auto* limit = obj.if_contains("accessKeyDataLimit")) {
+    info.accessKeyDataLimitBytes =
+        limit->as_object().at("bytes").to_number<std::int64_t>();
+  }
+  if (const auto* port = obj.if_contains("portForNewAccessKeys"))
+    info.portForNewAccessKeys = port->to_number<int>();
+  return info;
+}
+
+}  // namespace outline
@@ -0,0 +1,19 @@
+#include "outline/models/TransferMetrics.h"
+
+#include <boost/json.hpp>
+
+namespace outline {
+
+TransferMetrics tag_invoke(boost::json::value_to_tag<TransferMetrics>,
+                           const boost::json::value& jv) {
+  const auto& bytes = jv.as_object().at("bytesTransferredByUserId").as_object();
+  TransferMetrics metrics;
+  metrics.bytesTransferredByUserId.reserve(bytes.size());
+  for (const auto& [id, value] : bytes) {
+    metrics.bytesTransferredByUserId.emplace(
+        std::string(id), value.to_number<std::uint64_t>());
+  }
+  return metrics;
+}
+
+}  // namespace outline
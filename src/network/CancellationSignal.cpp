@@ -0,0 +1,91 @@
+#include "outline/network/CancellationSignal.h"
+
+#include <utility>
+#include <vector>
+
+namespace outline {
+namespace network {
+
+CancellationSignal::Slot::Slot(CancellationSignal* signal, std::uint64_t id)
+    : m_signal(signal), m_id(id) {}
+
+CancellationSignal::Slot::Slot(Slot&& other) noexcept
+    : m_signal(std::exchange(other.m_signal, nullptr)), m_id(other.m_id) {}
+
+CancellationSignal::Slot& CancellationSignal::Slot::operator=(
+    Slot&& other) noexcept {
+  if (this != &other) {
+    reset();
+    m_signal = std::exchange(other.m_signal, nullptr);
+    m_id = other.m_id;
+  }
+  return *this;
+}
+
+CancellationSignal::Slot::~Slot() {
+  reset();
+}
+
+void CancellationSignal::Slot::reset() {
+  if (m_signal)
+    m_signal->disconnect(m_id);
+  m_signal = nullptr;
+}
+
+void CancellationSignal::emit() {
+  std::vector<std::shared_ptr<Handler>> handlers;
+  {
+    std::lock_guard lock(m_mutex);
+    m_emitted = true;
+    handlers.reserve(m_handlers.size());
+    for (const auto& [id, handler] : m_handlers)
+      handlers.push_back(handler);
+  }
+  for (auto& handler : handlers)
+    post(std::move(handler));
+}
+
+bool CancellationSignal::emitted() const {
+  std::lock_guard lock(m_mutex);
+  return m_emitted;
+}
+
+CancellationSignal::Slot CancellationSignal::connect(
+    const boost::asio::any_io_executor& executor,
+    std::function<void()> handler) {
+  auto entry = std::make_shared<Handler>(executor);
+  entry->run = std::move(handler);
+  std::uint64_t id;
+  bool emitted;
+  {
+    std::lock_guard lock(m_mutex);
+    id = m_nextId++;
+    m_handlers.emplace(id, entry);
+    emitted = m_emitted;
+  }
+  if (emitted)
+    post(std::move(entry));
+  return Slot(this, id);
+}
+
+void CancellationSignal::post(std::shared_ptr<Handler> handler) {
+  // The slot is released on the same executor, so active can't change
+  // while the handler runs.
+  auto executor = handler->executor;
+  boost::asio::post(executor, [handler = std::move(handler)]() {
+    if (handler->active && handler->run)
+      handler->run();
+  });
+}
+
+void CancellationSignal::disconnect(std::uint64_t id) {
+  std::lock_guard lock(m_mutex);
+  auto it = m_handlers.find(id);
+  if (it == m_handlers.end())
+    return;
+  it->second->active = false;
+  m_handlers.erase(it);
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,95 @@
+#include "outline/network/CertificatePin.h"
+
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+namespace outline {
+namespace network {
+
+namespace {
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+std::optional<Fingerprint> fingerprintOf(X509* certificate) {
+  if (!certificate)
+    return std::nullopt;
+  Fingerprint fingerprint;
+  unsigned int size = 0;
+  if (X509_digest(certificate, EVP_sha256(), fingerprint.data(), &size) != 1 ||
+      size != fingerprint.size()) {
+    return std::nullopt;
+  }
+  return fingerprint;
+}
+
+}  // namespace
+
+std::optional<Fingerprint> parseFingerprint(std::string_view hex) {
+  Fingerprint fingerprint{};
+  std::size_t digits = 0;
+  for (char c : hex) {
+    if (c == ':' || c == ' ')
+      continue;
+    int value = hexValue(c);
+    if (value < 0 || digits == fingerprint.size() * 2)
+      return std::nullopt;
+    fingerprint[digits / 2] =
+        static_cast<unsigned char>(fingerprint[digits / 2] << 4 | value);
+    ++digits;
+  }
+  if (digits != fingerprint.size() * 2)
+    return std::nullopt;
+  return fingerprint;
+}
+
+std::string toHex(const Fingerprint& fingerprint) {
+  static constexpr char kDigits[] = "0123456789ABCDEF";
+  std::string hex;
+  hex.reserve(fingerprint.size() * 2);
+  for (unsigned char byte : fingerprint) {
+    hex += kDigits[byte >> 4];
+    hex += kDigits[byte & 0x0f];
+  }
+  return hex;
+}
+
+std::optional<Fingerprint> peerFingerprint(SSL* ssl) {
+  // Both take a reference; OpenSSL 3 deprecates the old name.
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  X509* certificate = SSL_get1_peer_certificate(ssl);
+#else
+  X509* certificate = SSL_get_peer_certificate(ssl);
+#endif
+  auto fingerprint = fingerprintOf(certificate);
+  X509_free(certificate);
+  return fingerprint;
+}
+
+void pinCertificate(
+    boost::asio::ssl::stream<boost::asio::ip::tcp::socket>& stream,
+    const Fingerprint& pin, std::optional<Fingerprint>& seen) {
+  seen.reset();
+  stream.set_verify_mode(boost::asio::ssl::verify_peer);
+  stream.set_verify_callback(
+      [pin, &seen](bool, boost::asio::ssl::verify_context& context) {
+        X509_STORE_CTX* store = context.native_handle();
+        // Only the leaf is pinned; errors about its issuers are ignored.
+        if (X509_STORE_CTX_get_error_depth(store) > 0)
+          return true;
+        seen = fingerprintOf(X509_STORE_CTX_get_current_cert(store));
+        return seen == pin;
+      });
+}
+
+}  // namespace network
+}  // namespace outline
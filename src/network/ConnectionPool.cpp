@@ -0,0 +1,303 @@
+#include "outline/network/ConnectionPool.h"
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#include "outline/network/Tracing.h"
+
+namespace outline {
+namespace network {
+
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// An idle connection serves later requests, so its socket must not keep
+// the contexts or the strand of the request that opened it.
+boost::asio::any_io_executor connectionExecutor(
+    boost::asio::any_io_executor executor) {
+  using Strand = boost::asio::strand<boost::asio::any_io_executor>;
+  for (;;) {
+    boost::asio::any_io_executor inner;
+    if (auto* request = executor.target<ContextExecutor<RequestContext>>())
+      inner = request->inner();
+    else if (auto* trace = executor.target<TracingExecutor>())
+      inner = trace->inner();
+    else if (auto* strand = executor.target<Strand>())
+      inner = strand->get_inner_executor();
+    else
+      return executor;
+    executor = std::move(inner);
+  }
+}
+
+}  // namespace
+
+ConnectionLease::ConnectionLease(std::shared_ptr<ConnectionPool> pool,
+                                 std::string key,
+                                 std::unique_ptr<PooledConnection> connection,
+                                 bool reused)
+    : m_pool(std::move(pool)),
+      m_key(std::move(key)),
+      m_connection(std::move(connection)),
+      m_reused(reused) {}
+
+ConnectionLease::ConnectionLease(ConnectionLease&& other) noexcept
+    : m_pool(std::move(other.m_pool)),
+      m_key(std::move(other.m_key)),
+      m_connection(std::move(other.m_connection)),
+      m_reused(other.m_reused),
+      m_reusable(other.m_reusable) {}
+
+ConnectionLease& ConnectionLease::operator=(ConnectionLease&& other) noexcept {
+  if (this != &other) {
+    release();
+    m_pool = std::move(other.m_pool);
+    m_key = std::move(other.m_key);
+    m_connection = std::move(other.m_connection);
+    m_reused = other.m_reused;
+    m_reusable = other.m_reusable;
+  }
+  return *this;
+}
+
+ConnectionLease::~ConnectionLease() {
+  release();
+}
+
+void ConnectionLease::release() {
+  if (m_pool && m_connection) {
+    m_pool->release(m_key, std::move(m_connection), m_reusable);
+  }
+  m_pool.reset();
+}
+
+ConnectionPool::ConnectionPool(const ConnectionPoolOptions& options)
+    : m_options(options) {
+  if (m_options.maxPerHost == 0)
+    m_options.maxPerHost = 1;
+}
+
+boost::asio::awaitable<ConnectionLease> ConnectionPool::acquireAsync(
+    const std::string& key, boost::asio::ssl::context& sslContext,
+    std::chrono::steady_clock::duration timeout,
+    const RequestContext* context) {
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto priority =
+      context ? context->effectivePriority() : RequestPriority::Interactive;
+  for (;;) {
+    if (context && context->cancelled())
+      throw boost::system::system_error(boost::asio::error::operation_aborted);
+    std::shared_ptr<Waiter> waiter;
+    {
+      std::unique_lock lock(m_mutex);
+      auto& host = m_hosts[key];
+      // Newest connections are the most likely to still be alive.
+      while (!host.idle.empty()) {
+        auto connection = std::move(host.idle.back());
+        host.idle.pop_back();
+        auto age = std::chrono::steady_clock::now() - connection->lastUsed;
+        lock.unlock();
+        if (age < m_options.idleTimeout && isAlive(*connection)) {
+          co_return ConnectionLease(shared_from_this(), key,
+                                    std::move(connection), true);
+        }
+        close(*connection);
+        lock.lock();
+        freeSlotLocked(m_hosts[key]);
+      }
+      auto& state = m_hosts[key];
+      if (state.open < m_options.maxPerHost) {
+        ++state.open;
+        lock.unlock();
+        co_return ConnectionLease(shared_from_this(), key,
+                                  std::make_unique<PooledConnection>(
+                                      connectionExecutor(executor), sslContext),
+                                  false);
+      }
+      waiter = std::make_shared<Waiter>(executor, priority);
+      waiter->timer.expires_at(deadline);
+      enqueue(state.waiters, waiter);
+    }
+
+    CancellationSignal::Slot cancel;
+    if (context && context->cancellation) {
+      cancel = context->cancellation->connect(
+          executor, [waiter]() { waiter->timer.cancel(); });
+    }
+    boost::system::error_code ec;
+    co_await waiter->timer.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+    std::lock_guard lock(m_mutex);
+    if (waiter->granted) {
+      // The releasing side either handed over its live connection or
+      // reserved a slot for a new one.
+      if (waiter->connection) {
+        co_return ConnectionLease(shared_from_this(), key,
+                                  std::move(waiter->connection), true);
+      }
+      co_return ConnectionLease(shared_from_this(), key,
+                                std::make_unique<PooledConnection>(
+                                    connectionExecutor(executor), sslContext),
+                                false);
+    }
+    bool cancelled = context && context->cancelled();
+    if (cancelled || std::chrono::steady_clock::now() >= deadline) {
+      auto& waiters = m_hosts[key].waiters;
+      waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter),
+                    waiters.end());
+      throw boost::system::system_error(
+          cancelled ? boost::asio::error::operation_aborted
+                    : boost::asio::error::timed_out);
+    }
+  }
+}
+
+// Behind every waiter of the same or a higher class, so interactive
+// requests overtake queued bulk and polling ones but never each other.
+void ConnectionPool::enqueue(std::deque<std::shared_ptr<Waiter>>& waiters,
+                             std::shared_ptr<Waiter> waiter) {
+  auto position = std::find_if(
+      waiters.begin(), waiters.end(),
+      [&](const auto& other) { return other->priority > waiter->priority; });
+  waiters.insert(position, std::move(waiter));
+}
+
+void ConnectionPool::release(const std::string& key,
+                             std::unique_ptr<PooledConnection> connection,
+                             bool reusable) {
+  std::unique_lock lock(m_mutex);
+  auto& host = m_hosts[key];
+  if (reusable) {
+    connection->lastUsed = std::chrono::steady_clock::now();
+    if (!host.waiters.empty()) {
+      grantLocked(host, std::move(connection));
+      return;
+    }
+    if (host.idle.size() < m_options.maxIdlePerHost) {
+      host.idle.push_back(std::move(connection));
+      return;
+    }
+  }
+  freeSlotLocked(host);
+  lock.unlock();
+  close(*connection);
+}
+
+void ConnectionPool::freeSlotLocked(HostState& host) {
+  if (!host.waiters.empty()) {
+    grantLocked(host, nullptr);
+    return;
+  }
+  if (host.open > 0)
+    --host.open;
+}
+
+void ConnectionPool::grantLocked(HostState& host,
+                                 std::unique_ptr<PooledConnection> connection) {
+  // Hand the slot straight to the first waiter so it can't be stolen.
+  auto waiter = std::move(host.waiters.front());
+  host.waiters.pop_front();
+  waiter->granted = true;
+  waiter->connection = std::move(connection);
+  boost::asio::post(waiter->timer.get_executor(),
+                    [waiter]() { waiter->timer.cancel(); });
+}
+
+std::vector<std::unique_ptr<PooledConnection>> ConnectionPool::takeIdle() {
+  std::vector<std::unique_ptr<PooledConnection>> idle;
+  std::lock_guard lock(m_mutex);
+  for (auto& [key, host] : m_hosts) {
+    host.open -= std::min(host.open, host.idle.size());
+    for (auto& connection : host.idle)
+      idle.push_back(std::move(connection));
+    host.idle.clear();
+  }
+  return idle;
+}
+
+void ConnectionPool::clear() {
+  for (auto& connection : takeIdle())
+    close(*connection);
+}
+
+// The shutdowns run side by side on the caller's executor. Whatever hasn't
+// finished when the timeout passes is cut off by closing its socket; the
+// shared state keeps the connection alive until its coroutine has seen it.
+boost::asio::awaitable<void> ConnectionPool::closeAsync(
+    std::chrono::steady_clock::duration timeout) {
+  struct Closing {
+    explicit Closing(const boost::asio::any_io_executor& executor)
+        : timer(executor) {}
+
+    std::vector<std::unique_ptr<PooledConnection>> connections;
+    boost::asio::steady_timer timer;
+    std::size_t pending = 0;
+  };
+
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto closing = std::make_shared<Closing>(executor);
+  closing->connections = takeIdle();
+  closing->timer.expires_after(timeout);
+  for (auto& connection : closing->connections) {
+    if (!connection->connected)
+      continue;
+    ++closing->pending;
+    boost::asio::co_spawn(
+        executor,
+        [closing, conn = connection.get()]() -> boost::asio::awaitable<void> {
+          boost::system::error_code ec;
+          co_await conn->stream.async_shutdown(
+              boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+          if (--closing->pending == 0)
+            closing->timer.cancel();
+        },
+        boost::asio::detached);
+  }
+  if (closing->pending > 0) {
+    boost::system::error_code ec;
+    co_await closing->timer.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  }
+  for (auto& connection : closing->connections)
+    close(*connection);
+}
+
+std::size_t ConnectionPool::idleCount(const std::string& key) const {
+  std::lock_guard lock(m_mutex);
+  auto it = m_hosts.find(key);
+  return it == m_hosts.end() ? 0 : it->second.idle.size();
+}
+
+bool ConnectionPool::isAlive(PooledConnection& connection) {
+  auto& socket = connection.stream.next_layer();
+  if (!connection.connected || !socket.is_open())
+    return false;
+  // An idle keep-alive socket must have nothing to read: pending bytes are a
+  // close_notify or the peer's FIN, so the connection is stale.
+  boost::system::error_code ec;
+  socket.non_blocking(true, ec);
+  if (ec)
+    return false;
+  char probe;
+  socket.receive(boost::asio::buffer(&probe, 1), tcp::socket::message_peek,
+                 ec);
+  bool alive = ec == boost::asio::error::would_block;
+  socket.non_blocking(false, ec);
+  return alive;
+}
+
+void ConnectionPool::close(PooledConnection& connection) {
+  boost::system::error_code ec;
+  connection.stream.next_layer().shutdown(tcp::socket::shutdown_both, ec);
+  connection.stream.next_layer().close(ec);
+  connection.connected = false;
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,138 @@
+#include "outline/network/ContentDecoding.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+
+namespace outline {
+namespace network {
+
+namespace {
+
+constexpr std::size_t kMinOutput = 16 * 1024;
+
+boost::system::error_code badMessage() {
+  return boost::system::errc::make_error_code(
+      boost::system::errc::bad_message);
+}
+
+bool equalsIgnoringCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) ==
+                  std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+std::string_view trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    value.remove_prefix(1);
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    value.remove_suffix(1);
+  return value;
+}
+
+}  // namespace
+
+struct ContentDecoder::Stream {
+  ~Stream() {
+    if (initialized)
+      inflateEnd(&z);
+  }
+
+  z_stream z{};
+  bool initialized = false;
+  bool ended = false;
+  // Start of a deflate body too short to tell its framing yet.
+  std::string head;
+};
+
+std::optional<ContentDecoder::Coding> ContentDecoder::parse(
+    std::string_view contentEncoding) {
+  contentEncoding = trim(contentEncoding);
+  if (contentEncoding.empty() ||
+      equalsIgnoringCase(contentEncoding, "identity")) {
+    return Coding::Identity;
+  }
+  if (equalsIgnoringCase(contentEncoding, "gzip") ||
+      equalsIgnoringCase(contentEncoding, "x-gzip")) {
+    return Coding::Gzip;
+  }
+  if (equalsIgnoringCase(contentEncoding, "deflate"))
+    return Coding::Deflate;
+  return std::nullopt;
+}
+
+ContentDecoder::ContentDecoder(Coding coding) : m_coding(coding) {
+  if (m_coding != Coding::Identity)
+    m_stream = std::make_unique<Stream>();
+}
+
+ContentDecoder::~ContentDecoder() = default;
+
+boost::system::error_code ContentDecoder::decode(std::string_view input,
+                                                 std::string& out) {
+  if (m_coding == Coding::Identity) {
+    out.append(input);
+    return {};
+  }
+  Stream& stream = *m_stream;
+  // Bytes after the end of the stream are padding some servers send.
+  if (stream.ended || input.empty())
+    return {};
+  if (!stream.initialized) {
+    int windowBits = 16 + MAX_WBITS;
+    if (m_coding == Coding::Deflate) {
+      // "deflate" should be zlib framed, but some servers send a raw stream.
+      stream.head.append(input);
+      if (stream.head.size() < 2)
+        return {};
+      const auto b0 = static_cast<unsigned char>(stream.head[0]);
+      const auto b1 = static_cast<unsigned char>(stream.head[1]);
+      const bool zlibFramed =
+          (b0 & 0x0f) == Z_DEFLATED && (b0 * 256 + b1) % 31 == 0;
+      windowBits = zlibFramed ? MAX_WBITS : -MAX_WBITS;
+      input = stream.head;
+    }
+    if (inflateInit2(&stream.z, windowBits) != Z_OK)
+      return badMessage();
+    stream.initialized = true;
+  }
+
+  z_stream& z = stream.z;
+  z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  z.avail_in = static_cast<uInt>(input.size());
+  boost::system::error_code ec;
+  do {
+    const std::size_t old = out.size();
+    const std::size_t room = std::max(kMinOutput, input.size() * 4);
+    out.resize(old + room);
+    z.next_out = reinterpret_cast<Bytef*>(out.data() + old);
+    z.avail_out = static_cast<uInt>(room);
+    int result = inflate(&z, Z_NO_FLUSH);
+    out.resize(old + room - z.avail_out);
+    if (result == Z_STREAM_END) {
+      stream.ended = true;
+      break;
+    }
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+      ec = badMessage();
+      break;
+    }
+  } while (z.avail_in > 0 || z.avail_out == 0);
+  stream.head.clear();
+  return ec;
+}
+
+boost::system::error_code ContentDecoder::finish() const {
+  if (m_coding == Coding::Identity)
+    return {};
+  // An empty body, e.g. of a 204, has no stream at all.
+  if (!m_stream->initialized && m_stream->head.empty())
+    return {};
+  return m_stream->ended ? boost::system::error_code{} : badMessage();
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,33 @@
+#include "outline/network/Deadline.h"
+
+#include <utility>
+
+namespace outline {
+namespace network {
+
+Deadline::Deadline(const boost::asio::any_io_executor& executor,
+                   std::chrono::steady_clock::duration timeout,
+                   std::function<void()> onExpire)
+    : m_state(std::make_shared<State>(executor)) {
+  m_state->onExpire = std::move(onExpire);
+  m_state->timer.expires_after(timeout);
+  m_state->timer.async_wait(
+      [state = m_state](const boost::system::error_code& ec) {
+        // The guard may be gone already if the expiry raced with the
+        // operation finishing; active tells the two cases apart.
+        if (ec || !state->active)
+          return;
+        state->expired = true;
+        if (state->onExpire)
+          state->onExpire();
+      });
+}
+
+Deadline::~Deadline() {
+  m_state->active = false;
+  m_state->onExpire = nullptr;
+  m_state->timer.cancel();
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,42 @@
+#include "outline/network/Hedging.h"
+
+#include <algorithm>
+
+namespace outline {
+namespace network {
+
+std::chrono::microseconds hedgeDelay(const HedgeOptions& options,
+                                     std::uint64_t percentileMicros) {
+  const std::chrono::microseconds low = options.minDelay;
+  const std::chrono::microseconds high =
+      std::max<std::chrono::microseconds>(low, options.maxDelay);
+  return std::clamp(std::chrono::microseconds(percentileMicros), low, high);
+}
+
+HedgeBudget::HedgeBudget(double maxTokens, double tokenRatio)
+    : m_max(static_cast<std::int64_t>(maxTokens * 1000)),
+      m_ratio(static_cast<std::int64_t>(tokenRatio * 1000)),
+      m_tokens(m_max) {}
+
+void HedgeBudget::recordRequest() {
+  auto tokens = m_tokens.load(std::memory_order_relaxed);
+  while (tokens < m_max &&
+         !m_tokens.compare_exchange_weak(tokens,
+                                         std::min(m_max, tokens + m_ratio),
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+bool HedgeBudget::trySpend() {
+  auto tokens = m_tokens.load(std::memory_order_relaxed);
+  while (tokens >= 1000) {
+    if (m_tokens.compare_exchange_weak(tokens, tokens - 1000,
+                                       std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,260 @@
+#include "outline/network/Instrumentation.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <sstream>
+
+namespace outline {
+namespace network {
+
+namespace {
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+void writeSummary(std::ostringstream& out, const std::string& name,
+                  const std::string& labels, const HistogramSnapshot& h) {
+  std::string sep = labels.empty() ? "" : ",";
+  for (double q : kQuantiles) {
+    out << name << "{" << labels << sep << "quantile=\"" << q << "\"} "
+        << static_cast<double>(h.percentile(q)) / 1e6 << "\n";
+  }
+  std::string braces = labels.empty() ? "" : "{" + labels + "}";
+  out << name << "_sum" << braces << " " << static_cast<double>(h.sum) / 1e6
+      << "\n";
+  out << name << "_count" << braces << " " << h.count << "\n";
+}
+
+// Value below which the fraction q of the count samples in the buckets lie.
+std::uint64_t percentileOf(const std::uint64_t* buckets, std::size_t size,
+                           std::uint64_t count, std::uint64_t max, double q) {
+  if (count == 0)
+    return 0;
+  auto rank = static_cast<std::uint64_t>(
+      std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count)));
+  rank = std::max<std::uint64_t>(rank, 1);
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    seen += buckets[i];
+    if (seen >= rank)
+      return std::min(LatencyHistogram::bucketUpperBound(i), max);
+  }
+  return max;
+}
+
+}  // namespace
+
+std::string_view toString(Phase phase) {
+  switch (phase) {
+    case Phase::Resolve:
+      return "resolve";
+    case Phase::Connect:
+      return "connect";
+    case Phase::Handshake:
+      return "handshake";
+    case Phase::Write:
+      return "write";
+    case Phase::Read:
+      return "read";
+    case Phase::Parse:
+      return "parse";
+  }
+  return "unknown";
+}
+
+std::string_view toString(ErrorClass errorClass) {
+  switch (errorClass) {
+    case ErrorClass::Timeout:
+      return "timeout";
+    case ErrorClass::Network:
+      return "network";
+    case ErrorClass::Tls:
+      return "tls";
+    case ErrorClass::CircuitOpen:
+      return "circuit_open";
+    case ErrorClass::ClientError:
+      return "client_error";
+    case ErrorClass::ServerError:
+      return "server_error";
+    case ErrorClass::Parse:
+      return "parse";
+    case ErrorClass::Other:
+      return "other";
+  }
+  return "unknown";
+}
+
+std::uint64_t HistogramSnapshot::percentile(double q) const {
+  return percentileOf(buckets.data(), buckets.size(), count, max, q);
+}
+
+std::size_t LatencyHistogram::bucketIndex(std::uint64_t micros) {
+  if (micros < kSubBuckets)
+    return static_cast<std::size_t>(micros);
+  // Buckets of the power of two starting at 2^msb are 2^(msb - 4) wide.
+  int shift = static_cast<int>(std::bit_width(micros)) - 5;
+  std::size_t index = static_cast<std::size_t>(shift + 1) * kSubBuckets +
+                      ((micros >> shift) & (kSubBuckets - 1));
+  return std::min(index, kBuckets - 1);
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index) {
+  if (index < kSubBuckets)
+    return index;
+  std::size_t shift = index / kSubBuckets - 1;
+  std::uint64_t low = (kSubBuckets + index % kSubBuckets) << shift;
+  return low + (std::uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration value) {
+  auto micros = static_cast<std::uint64_t>(std::max<std::int64_t>(
+      0,
+      std::chrono::duration_cast<std::chrono::microseconds>(value).count()));
+  m_buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(micros, std::memory_order_relaxed);
+  auto max = m_max.load(std::memory_order_relaxed);
+  while (micros > max && !m_max.compare_exchange_weak(
+                             max, micros, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.buckets.resize(kBuckets);
+  // The count is taken from the buckets so percentiles stay consistent with
+  // it while requests are being recorded.
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    snapshot.count += snapshot.buckets[i];
+  }
+  snapshot.sum = m_sum.load(std::memory_order_relaxed);
+  snapshot.max = m_max.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+std::uint64_t LatencyHistogram::percentile(double q,
+                                           std::uint64_t& count) const {
+  std::array<std::uint64_t, kBuckets> buckets;
+  count = 0;
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    count += buckets[i];
+  }
+  return percentileOf(buckets.data(), kBuckets, count,
+                      m_max.load(std::memory_order_relaxed), q);
+}
+
+void Instrumentation::requestFinished(
+    std::string_view method, std::string_view endpoint,
+    std::chrono::steady_clock::duration latency) {
+  m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+  if (endpoint.empty())
+    return;
+  if (auto* histogram = endpointHistogram(method, endpoint))
+    histogram->record(latency);
+}
+
+LatencyHistogram* Instrumentation::endpointHistogram(
+    std::string_view method, std::string_view endpoint) {
+  for (auto& slot : m_endpoints) {
+    int state = slot.state.load(std::memory_order_acquire);
+    if (state == 0) {
+      if (slot.state.compare_exchange_strong(state, 1,
+                                             std::memory_order_acquire)) {
+        slot.method = method;
+        slot.endpoint = endpoint;
+        slot.latency = std::make_unique<LatencyHistogram>();
+        slot.state.store(2, std::memory_order_release);
+        return slot.latency.get();
+      }
+    }
+    // Another thread is claiming the slot; it may be for this endpoint.
+    while (state == 1)
+      state = slot.state.load(std::memory_order_acquire);
+    if (slot.method == method && slot.endpoint == endpoint)
+      return slot.latency.get();
+  }
+  return nullptr;
+}
+
+std::optional<std::uint64_t> Instrumentation::endpointPercentile(
+    std::string_view method, std::string_view endpoint, double q,
+    std::uint64_t minSamples) const {
+  for (const auto& slot : m_endpoints) {
+    int state = slot.state.load(std::memory_order_acquire);
+    // Slots are claimed in order, so the endpoint has none yet.
+    if (state == 0)
+      break;
+    if (state != 2 || slot.method != method || slot.endpoint != endpoint)
+      continue;
+    std::uint64_t count = 0;
+    auto value = slot.latency->percentile(q, count);
+    if (count < minSamples)
+      return std::nullopt;
+    return value;
+  }
+  return std::nullopt;
+}
+
+InstrumentationSnapshot Instrumentation::snapshot() const {
+  InstrumentationSnapshot snapshot;
+  snapshot.requests = m_requests.load(std::memory_order_relaxed);
+  snapshot.inFlight = m_inFlight.load(std::memory_order_relaxed);
+  snapshot.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+  snapshot.bytesReceived = m_bytesReceived.load(std::memory_order_relaxed);
+  snapshot.hedgesSent = m_hedgesSent.load(std::memory_order_relaxed);
+  snapshot.hedgesWon = m_hedgesWon.load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i < kErrorClassCount; ++i)
+    snapshot.errors[i] = m_errors[i].load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i < kPhaseCount; ++i)
+    snapshot.phases[i] = m_phases[i].snapshot();
+  for (const auto& slot : m_endpoints) {
+    if (slot.state.load(std::memory_order_acquire) != 2)
+      continue;
+    snapshot.endpoints.push_back({std::string(slot.method),
+                                  std::string(slot.endpoint),
+                                  slot.latency->snapshot()});
+  }
+  return snapshot;
+}
+
+std::string InstrumentationSnapshot::toPrometheus(
+    std::string_view prefix) const {
+  std::string p(prefix);
+  std::ostringstream out;
+  out << "# TYPE " << p << "_requests_total counter\n"
+      << p << "_requests_total " << requests << "\n";
+  out << "# TYPE " << p << "_in_flight gauge\n"
+      << p << "_in_flight " << inFlight << "\n";
+  out << "# TYPE " << p << "_bytes_sent_total counter\n"
+      << p << "_bytes_sent_total " << bytesSent << "\n";
+  out << "# TYPE " << p << "_bytes_received_total counter\n"
+      << p << "_bytes_received_total " << bytesReceived << "\n";
+  out << "# TYPE " << p << "_hedges_total counter\n"
+      << p << "_hedges_total " << hedgesSent << "\n";
+  out << "# TYPE " << p << "_hedge_wins_total counter\n"
+      << p << "_hedge_wins_total " << hedgesWon << "\n";
+  out << "# TYPE " << p << "_errors_total counter\n";
+  for (std::size_t i = 0; i < kErrorClassCount; ++i) {
+    out << p << "_errors_total{class=\""
+        << toString(static_cast<ErrorClass>(i)) << "\"} " << errors[i]
+        << "\n";
+  }
+  out << "# TYPE " << p << "_phase_seconds summary\n";
+  for (std::size_t i = 0; i < kPhaseCount; ++i) {
+    writeSummary(out, p + "_phase_seconds",
+                 "phase=\"" + std::string(toString(static_cast<Phase>(i))) +
+                     "\"",
+                 phases[i]);
+  }
+  out << "# TYPE " << p << "_request_seconds summary\n";
+  for (const auto& e : endpoints) {
+    writeSummary(out, p + "_request_seconds",
+                 "method=\"" + e.method + "\",endpoint=\"" + e.endpoint + "\"",
+                 e.latency);
+  }
+  return out.str();
+}
+
+}  // namespace network
+}  // namespace outline
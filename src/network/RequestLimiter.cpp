@@ -0,0 +1,211 @@
+#include "outline/network/RequestLimiter.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace outline {
+namespace network {
+
+AdaptiveLimit::AdaptiveLimit(const LimiterOptions& options)
+    : m_min(static_cast<double>(std::max<std::size_t>(1, options.minLimit))),
+      m_tolerance(options.latencyTolerance),
+      m_backoff(options.backoffRatio),
+      m_windowMin(std::chrono::steady_clock::duration::max()) {
+  m_max = std::max(m_min, static_cast<double>(options.maxLimit));
+  m_limit = std::clamp(static_cast<double>(options.initialLimit), m_min, m_max);
+}
+
+void AdaptiveLimit::record(std::chrono::steady_clock::duration latency,
+                           bool success, std::size_t inFlight) {
+  if (success) {
+    if (m_baseline == std::chrono::steady_clock::duration::zero())
+      m_baseline = latency;
+    m_windowMin = std::min(m_windowMin, latency);
+    if (++m_samples == kWindow) {
+      m_baseline = m_windowMin;
+      m_windowMin = std::chrono::steady_clock::duration::max();
+      m_samples = 0;
+    }
+  }
+  if (!success || latency > m_baseline * m_tolerance) {
+    m_limit = std::max(m_min, m_limit * m_backoff);
+  } else if (static_cast<double>(inFlight) * 2 >= m_limit) {
+    // Only grow a limit that is actually used.
+    m_limit = std::min(m_max, m_limit + 1 / m_limit);
+  }
+}
+
+TokenBucket::TokenBucket(double ratePerSecond, std::size_t burst,
+                         Clock::time_point now)
+    : m_rate(ratePerSecond),
+      m_burst(static_cast<double>(std::max<std::size_t>(1, burst))),
+      m_tokens(m_burst),
+      m_updated(now) {}
+
+TokenBucket::Clock::duration TokenBucket::reserve(Clock::time_point now) {
+  if (m_rate <= 0)
+    return Clock::duration::zero();
+  if (now > m_updated) {
+    std::chrono::duration<double> elapsed = now - m_updated;
+    m_tokens = std::min(m_burst, m_tokens + elapsed.count() * m_rate);
+    m_updated = now;
+  }
+  m_tokens -= 1;
+  if (m_tokens >= 0)
+    return Clock::duration::zero();
+  return std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(-m_tokens / m_rate));
+}
+
+RequestLimiter::Permit::Permit(std::shared_ptr<RequestLimiter> limiter,
+                               std::string key)
+    : m_limiter(std::move(limiter)),
+      m_key(std::move(key)),
+      m_start(std::chrono::steady_clock::now()) {}
+
+RequestLimiter::Permit::Permit(Permit&& other) noexcept
+    : m_limiter(std::move(other.m_limiter)),
+      m_key(std::move(other.m_key)),
+      m_start(other.m_start) {}
+
+RequestLimiter::Permit& RequestLimiter::Permit::operator=(
+    Permit&& other) noexcept {
+  if (this != &other) {
+    if (m_limiter)
+      m_limiter->release(m_key, {}, false, false);
+    m_limiter = std::move(other.m_limiter);
+    m_key = std::move(other.m_key);
+    m_start = other.m_start;
+  }
+  return *this;
+}
+
+RequestLimiter::Permit::~Permit() {
+  if (m_limiter)
+    m_limiter->release(m_key, {}, false, false);
+}
+
+void RequestLimiter::Permit::finish(bool success) {
+  if (!m_limiter)
+    return;
+  auto limiter = std::move(m_limiter);
+  limiter->release(m_key, std::chrono::steady_clock::now() - m_start, true,
+                   success);
+}
+
+boost::asio::awaitable<RequestLimiter::Permit> RequestLimiter::acquireAsync(
+    const std::string& key, std::chrono::steady_clock::duration timeout,
+    const RequestContext* context) {
+  const bool limited = m_options.maxLimit > 0;
+  if (!limited && m_options.ratePerSecond <= 0)
+    co_return Permit();
+
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto priority =
+      context ? context->effectivePriority() : RequestPriority::Interactive;
+  if (m_options.ratePerSecond > 0) {
+    std::chrono::steady_clock::duration wait;
+    {
+      std::lock_guard lock(m_mutex);
+      wait = hostLocked(key).bucket.reserve();
+    }
+    if (wait > std::chrono::steady_clock::duration::zero()) {
+      if (std::chrono::steady_clock::now() + wait > deadline)
+        throw boost::system::system_error(boost::asio::error::timed_out);
+      boost::asio::steady_timer timer(executor, wait);
+      CancellationSignal::Slot cancel;
+      if (context && context->cancellation) {
+        cancel = context->cancellation->connect(
+            executor, [&timer]() { timer.cancel(); });
+      }
+      boost::system::error_code ec;
+      co_await timer.async_wait(
+          boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+      if (ec)
+        throw boost::system::system_error(ec);
+    }
+  }
+  if (!limited)
+    co_return Permit();
+
+  for (;;) {
+    if (context && context->cancelled())
+      throw boost::system::system_error(boost::asio::error::operation_aborted);
+    std::shared_ptr<Waiter> waiter;
+    {
+      std::lock_guard lock(m_mutex);
+      auto& host = hostLocked(key);
+      // Only waiters of a lower class may be overtaken.
+      bool first = host.waiters.empty() ||
+                   host.waiters.front()->priority > priority;
+      if (first && host.inFlight < host.limit.current()) {
+        ++host.inFlight;
+        co_return Permit(shared_from_this(), key);
+      }
+      waiter = std::make_shared<Waiter>(executor, priority);
+      waiter->timer.expires_at(deadline);
+      auto position = std::find_if(
+          host.waiters.begin(), host.waiters.end(),
+          [&](const auto& other) { return other->priority > priority; });
+      host.waiters.insert(position, waiter);
+    }
+
+    CancellationSignal::Slot cancel;
+    if (context && context->cancellation) {
+      cancel = context->cancellation->connect(
+          executor, [waiter]() { waiter->timer.cancel(); });
+    }
+    boost::system::error_code ec;
+    co_await waiter->timer.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+    std::lock_guard lock(m_mutex);
+    if (waiter->granted)
+      co_return Permit(shared_from_this(), key);
+    bool cancelled = context && context->cancelled();
+    if (cancelled || std::chrono::steady_clock::now() >= deadline) {
+      auto& waiters = hostLocked(key).waiters;
+      waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter),
+                    waiters.end());
+      throw boost::system::system_error(
+          cancelled ? boost::asio::error::operation_aborted
+                    : boost::asio::error::timed_out);
+    }
+  }
+}
+
+std::size_t RequestLimiter::limit(const std::string& key) const {
+  std::lock_guard lock(m_mutex);
+  auto it = m_hosts.find(key);
+  if (it == m_hosts.end())
+    return AdaptiveLimit(m_options).current();
+  return it->second.limit.current();
+}
+
+RequestLimiter::HostState& RequestLimiter::hostLocked(const std::string& key) {
+  return m_hosts.try_emplace(key, m_options).first->second;
+}
+
+void RequestLimiter::release(const std::string& key,
+                             std::chrono::steady_clock::duration latency,
+                             bool sample, bool success) {
+  std::lock_guard lock(m_mutex);
+  auto& host = hostLocked(key);
+  if (sample)
+    host.limit.record(latency, success, host.inFlight);
+  if (host.inFlight > 0)
+    --host.inFlight;
+  // Hand freed slots straight to the first waiters so they can't be stolen.
+  while (!host.waiters.empty() && host.inFlight < host.limit.current()) {
+    auto waiter = std::move(host.waiters.front());
+    host.waiters.pop_front();
+    waiter->granted = true;
+    ++host.inFlight;
+    boost::asio::post(waiter->timer.get_executor(),
+                      [waiter]() { waiter->timer.cancel(); });
+  }
+}
+
+}  // namespace network
+}  // namespace outline
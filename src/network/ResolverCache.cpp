@@ -0,0 +1,194 @@
+#include "outline/network/ResolverCache.h"
+#include "outline/network/Deadline.h"
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+namespace outline {
+namespace network {
+
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// Interleaves address families as recommended by RFC 8305, IPv6 first.
+ResolverCache::Endpoints interleaveFamilies(
+    const tcp::resolver::results_type& results) {
+  ResolverCache::Endpoints v6, v4, ordered;
+  for (const auto& entry : results) {
+    if (entry.endpoint().address().is_v6()) {
+      v6.push_back(entry.endpoint());
+    } else {
+      v4.push_back(entry.endpoint());
+    }
+  }
+  ordered.reserve(v6.size() + v4.size());
+  for (std::size_t i = 0; i < std::max(v6.size(), v4.size()); ++i) {
+    if (i < v6.size())
+      ordered.push_back(v6[i]);
+    if (i < v4.size())
+      ordered.push_back(v4[i]);
+  }
+  return ordered;
+}
+
+struct ConnectRace {
+  explicit ConnectRace(const boost::asio::any_io_executor& executor)
+      : wake(executor) {}
+
+  boost::asio::steady_timer wake;
+  std::vector<std::unique_ptr<tcp::socket>> sockets;
+  std::optional<std::size_t> winner;
+  std::size_t running = 0;
+  boost::system::error_code lastError;
+};
+
+}  // namespace
+
+boost::asio::awaitable<ResolverCache::Endpoints> ResolverCache::resolveAsync(
+    const std::string& host, const std::string& port,
+    std::chrono::steady_clock::duration timeout) {
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto key = host + ":" + port;
+  {
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && !it->second.endpoints.empty()) {
+      auto& entry = it->second;
+      if (std::chrono::steady_clock::now() < entry.expiresAt)
+        co_return entry.endpoints;
+      if (m_options.backgroundRefresh) {
+        if (!entry.refreshing) {
+          entry.refreshing = true;
+          boost::asio::co_spawn(
+              executor,
+              [self = shared_from_this(), host, port,
+               timeout]() -> boost::asio::awaitable<void> {
+                co_await self->lookupAsync(host, port, timeout);
+              },
+              [self = shared_from_this(), key](std::exception_ptr error) {
+                if (!error)
+                  return;
+                // Keep serving the stale endpoints, retry on next access.
+                std::lock_guard lock(self->m_mutex);
+                self->m_entries[key].refreshing = false;
+              });
+        }
+        co_return entry.endpoints;
+      }
+    }
+  }
+  co_return co_await lookupAsync(host, port, timeout);
+}
+
+void ResolverCache::invalidate(const std::string& host,
+                               const std::string& port) {
+  std::lock_guard lock(m_mutex);
+  m_entries.erase(host + ":" + port);
+}
+
+boost::asio::awaitable<ResolverCache::Endpoints> ResolverCache::lookupAsync(
+    std::string host, std::string port,
+    std::chrono::steady_clock::duration timeout) {
+  auto executor = co_await boost::asio::this_coro::executor;
+  tcp::resolver resolver(executor);
+  boost::system::error_code ec;
+  tcp::resolver::results_type results;
+  {
+    Deadline deadline(executor, timeout, [&resolver]() { resolver.cancel(); });
+    results = co_await resolver.async_resolve(
+        host, port,
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (deadline.expired())
+      ec = boost::asio::error::timed_out;
+  }
+  if (ec)
+    throw boost::system::system_error(ec);
+  auto endpoints = interleaveFamilies(results);
+  store(host + ":" + port, endpoints);
+  co_return endpoints;
+}
+
+void ResolverCache::store(const std::string& key, const Endpoints& endpoints) {
+  std::lock_guard lock(m_mutex);
+  auto& entry = m_entries[key];
+  entry.endpoints = endpoints;
+  entry.expiresAt = std::chrono::steady_clock::now() + m_options.ttl;
+  entry.refreshing = false;
+}
+
+boost::asio::awaitable<void> connectRacingAsync(
+    tcp::socket& socket, const ResolverCache::Endpoints& endpoints,
+    std::chrono::milliseconds attemptDelay,
+    std::chrono::steady_clock::duration timeout) {
+  if (endpoints.empty())
+    throw boost::system::system_error(boost::asio::error::host_not_found);
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto executor = co_await boost::asio::this_coro::executor;
+  auto race = std::make_shared<ConnectRace>(executor);
+  std::size_t next = 0;
+  bool timedOut = false;
+  while (!race->winner) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      timedOut = true;
+      break;
+    }
+    if (next < endpoints.size()) {
+      std::size_t index = race->sockets.size();
+      race->sockets.push_back(std::make_unique<tcp::socket>(executor));
+      ++race->running;
+      boost::asio::co_spawn(
+          executor,
+          [race, index,
+           endpoint = endpoints[next]]() -> boost::asio::awaitable<void> {
+            boost::system::error_code ec;
+            co_await race->sockets[index]->async_connect(
+                endpoint,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            --race->running;
+            if (!ec && !race->winner) {
+              race->winner = index;
+            } else if (ec && ec != boost::asio::error::operation_aborted) {
+              race->lastError = ec;
+            }
+            race->wake.cancel();
+          },
+          boost::asio::detached);
+      ++next;
+    } else if (race->running == 0) {
+      break;
+    }
+
+    // Wake up when an attempt finishes, it's time to start the next one or
+    // the whole connect phase runs out of time.
+    auto wakeAt = deadline;
+    if (next < endpoints.size())
+      wakeAt = std::min(wakeAt, std::chrono::steady_clock::now() + attemptDelay);
+    race->wake.expires_at(wakeAt);
+    boost::system::error_code ec;
+    co_await race->wake.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  }
+
+  for (std::size_t i = 0; i < race->sockets.size(); ++i) {
+    if (race->winner != i) {
+      boost::system::error_code ec;
+      race->sockets[i]->close(ec);
+    }
+  }
+  if (timedOut)
+    throw boost::system::system_error(boost::asio::error::timed_out);
+  if (!race->winner) {
+    throw boost::system::system_error(
+        race->lastError ? race->lastError
+                        : boost::asio::error::host_unreachable);
+  }
+  socket = std::move(*race->sockets[*race->winner]);
+}
+
+}  // namespace network
+}  // namespace outline
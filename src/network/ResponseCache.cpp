@@ -0,0 +1,54 @@
+#include "outline/network/ResponseCache.h"
+
+#include <utility>
+
+namespace outline {
+namespace network {
+
+ResponseCache::Body ResponseCache::get(const std::string& key) {
+  std::lock_guard lock(m_mutex);
+  auto it = m_entries.find(key);
+  if (it != m_entries.end()) {
+    if (std::chrono::steady_clock::now() < it->second.expiresAt) {
+      ++m_stats.hits;
+      return it->second.body;
+    }
+    m_entries.erase(it);
+  }
+  ++m_stats.misses;
+  return nullptr;
+}
+
+std::uint64_t ResponseCache::generation() const {
+  std::lock_guard lock(m_mutex);
+  return m_generation;
+}
+
+void ResponseCache::put(const std::string& key, Body body,
+                        std::uint64_t generation) {
+  std::lock_guard lock(m_mutex);
+  if (generation != m_generation)
+    return;
+  m_entries[key] =
+      Entry{std::move(body), std::chrono::steady_clock::now() + m_options.ttl};
+}
+
+void ResponseCache::invalidate(const std::string& key) {
+  std::lock_guard lock(m_mutex);
+  m_entries.erase(key);
+  ++m_generation;
+}
+
+void ResponseCache::clear() {
+  std::lock_guard lock(m_mutex);
+  m_entries.clear();
+  ++m_generation;
+}
+
+ResponseCacheStats ResponseCache::stats() const {
+  std::lock_guard lock(m_mutex);
+  return m_stats;
+}
+
+}  // namespace network
+}  // namespace outline
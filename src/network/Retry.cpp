@@ -0,0 +1,90 @@
+#include "outline/network/Retry.h"
+
+#include <algorithm>
+
+namespace outline {
+namespace network {
+
+Backoff::Backoff(std::chrono::milliseconds base, std::chrono::milliseconds cap)
+    : m_base(base), m_cap(std::max(base, cap)), m_previous(base) {}
+
+std::chrono::milliseconds Backoff::next() {
+  thread_local std::mt19937 random(std::random_device{}());
+  std::int64_t low = m_base.count();
+  std::int64_t high =
+      std::min<std::int64_t>(m_cap.count(), m_previous.count() * 3);
+  std::uniform_int_distribution<std::int64_t> spread(low,
+                                                     std::max(low, high));
+  m_previous = std::chrono::milliseconds(spread(random));
+  return m_previous;
+}
+
+RetryBudget::RetryBudget(double maxTokens, double tokenRatio)
+    : m_max(static_cast<std::int64_t>(maxTokens * 1000)),
+      m_ratio(static_cast<std::int64_t>(tokenRatio * 1000)),
+      m_tokens(m_max) {}
+
+void RetryBudget::recordSuccess() {
+  auto tokens = m_tokens.load(std::memory_order_relaxed);
+  while (tokens < m_max &&
+         !m_tokens.compare_exchange_weak(tokens,
+                                         std::min(m_max, tokens + m_ratio),
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+void RetryBudget::recordFailure() {
+  auto tokens = m_tokens.load(std::memory_order_relaxed);
+  while (tokens > 0 &&
+         !m_tokens.compare_exchange_weak(tokens,
+                                         std::max<std::int64_t>(0,
+                                                                tokens - 1000),
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+bool RetryBudget::canRetry() const {
+  return m_tokens.load(std::memory_order_relaxed) * 2 > m_max;
+}
+
+CircuitBreaker::CircuitBreaker(int threshold,
+                               std::chrono::milliseconds openTime)
+    : m_threshold(threshold), m_openTime(openTime) {}
+
+bool CircuitBreaker::allow(const std::string& host, Clock::time_point now) {
+  if (m_threshold <= 0 || m_tracked.load(std::memory_order_relaxed) == 0)
+    return true;
+  std::lock_guard lock(m_mutex);
+  auto it = m_hosts.find(host);
+  if (it == m_hosts.end() || it->second.failures < m_threshold)
+    return true;
+  Host& state = it->second;
+  if (now < state.openUntil || state.probing)
+    return false;
+  // Half open: this request probes whether the host recovered.
+  state.probing = true;
+  return true;
+}
+
+void CircuitBreaker::recordSuccess(const std::string& host) {
+  if (m_threshold <= 0 || m_tracked.load(std::memory_order_relaxed) == 0)
+    return;
+  std::lock_guard lock(m_mutex);
+  m_hosts.erase(host);
+  m_tracked = m_hosts.size();
+}
+
+void CircuitBreaker::recordFailure(const std::string& host,
+                                   Clock::time_point now) {
+  if (m_threshold <= 0)
+    return;
+  std::lock_guard lock(m_mutex);
+  Host& state = m_hosts[host];
+  m_tracked = m_hosts.size();
+  state.probing = false;
+  if (++state.failures >= m_threshold)
+    state.openUntil = now + m_openTime;
+}
+
+}  // namespace network
+}  // namespace outline
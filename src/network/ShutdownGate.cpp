@@ -0,0 +1,73 @@
+#include "outline/network/ShutdownGate.h"
+
+#include <utility>
+
+namespace outline {
+namespace network {
+
+bool ShutdownGate::enter() {
+  std::lock_guard lock(m_mutex);
+  if (m_closed)
+    return false;
+  ++m_inFlight;
+  return true;
+}
+
+void ShutdownGate::leave() {
+  std::shared_ptr<boost::asio::steady_timer> waiter;
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_inFlight > 0)
+      --m_inFlight;
+    if (m_inFlight == 0) {
+      waiter = std::move(m_drainWaiter);
+      m_idle.notify_all();
+    }
+  }
+  // Posted to the waiter's executor, so the wake-up can't overtake the wait.
+  if (waiter)
+    boost::asio::post(waiter->get_executor(), [waiter]() { waiter->cancel(); });
+}
+
+bool ShutdownGate::close() {
+  std::lock_guard lock(m_mutex);
+  return !std::exchange(m_closed, true);
+}
+
+bool ShutdownGate::closed() const {
+  std::lock_guard lock(m_mutex);
+  return m_closed;
+}
+
+std::size_t ShutdownGate::inFlight() const {
+  std::lock_guard lock(m_mutex);
+  return m_inFlight;
+}
+
+void ShutdownGate::wait() {
+  std::unique_lock lock(m_mutex);
+  m_idle.wait(lock, [this]() { return m_inFlight == 0; });
+}
+
+boost::asio::awaitable<bool> ShutdownGate::drainAsync(
+    std::chrono::steady_clock::time_point deadline) {
+  auto timer = std::make_shared<boost::asio::steady_timer>(
+      co_await boost::asio::this_coro::executor, deadline);
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_inFlight == 0)
+      co_return true;
+    m_drainWaiter = timer;
+  }
+  boost::system::error_code ec;
+  co_await timer->async_wait(
+      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+  std::lock_guard lock(m_mutex);
+  if (m_drainWaiter == timer)
+    m_drainWaiter.reset();
+  co_return m_inFlight == 0;
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,89 @@
+#include "outline/network/TlsSessionCache.h"
+
+#include <openssl/ssl.h>
+
+namespace outline {
+namespace network {
+
+TlsSessionCache::TlsSessionCache(boost::asio::ssl::context& sslContext)
+    : m_context(sslContext.native_handle()) {
+  // The internal store is keyed by session id and useless for clients, so
+  // sessions are kept here by host instead.
+  SSL_CTX_set_session_cache_mode(
+      m_context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_set_ex_data(m_context, contextIndex(), this);
+  SSL_CTX_sess_set_new_cb(m_context, &TlsSessionCache::onNewSession);
+}
+
+TlsSessionCache::~TlsSessionCache() {
+  SSL_CTX_set_ex_data(m_context, contextIndex(), nullptr);
+  std::lock_guard lock(m_mutex);
+  for (auto& [key, session] : m_sessions)
+    SSL_SESSION_free(session);
+}
+
+void TlsSessionCache::prepare(SSL* ssl, const std::string& key) {
+  SSL_set_ex_data(ssl, sslKeyIndex(), const_cast<std::string*>(&key));
+  std::lock_guard lock(m_mutex);
+  auto it = m_sessions.find(key);
+  if (it != m_sessions.end())
+    SSL_set_session(ssl, it->second);
+}
+
+void TlsSessionCache::recordHandshake(SSL* ssl) {
+  if (SSL_session_reused(ssl)) {
+    m_resumed.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    m_full.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void TlsSessionCache::invalidate(const std::string& key) {
+  std::lock_guard lock(m_mutex);
+  auto it = m_sessions.find(key);
+  if (it != m_sessions.end()) {
+    SSL_SESSION_free(it->second);
+    m_sessions.erase(it);
+  }
+}
+
+TlsSessionStats TlsSessionCache::stats() const {
+  TlsSessionStats result;
+  result.resumedHandshakes = m_resumed.load(std::memory_order_relaxed);
+  result.fullHandshakes = m_full.load(std::memory_order_relaxed);
+  return result;
+}
+
+int TlsSessionCache::onNewSession(SSL* ssl, SSL_SESSION* session) {
+  auto* cache = static_cast<TlsSessionCache*>(
+      SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), contextIndex()));
+  auto* key = static_cast<std::string*>(SSL_get_ex_data(ssl, sslKeyIndex()));
+  if (!cache || !key)
+    return 0;
+  cache->store(*key, session);
+  // Returning 1 takes ownership of the session reference.
+  return 1;
+}
+
+void TlsSessionCache::store(const std::string& key, SSL_SESSION* session) {
+  std::lock_guard lock(m_mutex);
+  auto& slot = m_sessions[key];
+  if (slot)
+    SSL_SESSION_free(slot);
+  slot = session;
+}
+
+int TlsSessionCache::sslKeyIndex() {
+  static const int index =
+      SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+int TlsSessionCache::contextIndex() {
+  static const int index =
+      SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+}  // namespace network
+}  // namespace outline
@@ -0,0 +1,39 @@
+#include "outline/network/Tracing.h"
+
+#include <string>
+
+namespace outline {
+namespace network {
+
+void TraceSpan::start(TraceContext& context, std::string_view name,
+                      std::string_view suffix,
+                      std::chrono::system_clock::time_point now) {
+  Span* parent = context.parent();
+  if (suffix.empty()) {
+    m_span = context.tracer->startSpan(name, parent, now);
+  } else {
+    std::string full;
+    full.reserve(name.size() + 1 + suffix.size());
+    full.append(name).append(" ").append(suffix);
+    m_span = context.tracer->startSpan(full, parent, now);
+  }
+  if (!m_span)
+    return;
+  m_context = &context;
+  m_parent = context.current;
+  context.current = m_span.get();
+}
+
+void TraceSpan::report(TraceContext& context, std::string_view name,
+                       std::chrono::steady_clock::duration duration,
+                       std::string_view error) {
+  auto start =
+      std::chrono::system_clock::now() -
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(duration);
+  auto span = context.tracer->startSpan(name, context.parent(), start);
+  if (span && !error.empty())
+    span->setError(error);
+}
+
+}  // namespace network
+}  // namespace outline
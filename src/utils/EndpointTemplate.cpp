@@ -0,0 +1,71 @@
+#include "outline/utils/EndpointTemplate.h"
+
+namespace outline {
+namespace utils {
+
+namespace {
+
+bool isUnreserved(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+         (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+         c == '~';
+}
+
+std::size_t encodedSize(std::string_view value) {
+  std::size_t size = value.size();
+  for (char c : value) {
+    if (!isUnreserved(c))
+      size += 2;
+  }
+  return size;
+}
+
+}  // namespace
+
+void appendPercentEncoded(std::string& out, std::string_view value) {
+  static constexpr char kHex[] = "0123456789ABCDEF";
+  for (char c : value) {
+    if (isUnreserved(c)) {
+      out += c;
+    } else {
+      auto byte = static_cast<unsigned char>(c);
+      out += '%';
+      out += kHex[byte >> 4];
+      out += kHex[byte & 0xF];
+    }
+  }
+}
+
+void EndpointTemplate::expandInto(
+    std::string& out, const TargetBase& base,
+    std::initializer_list<std::string_view> values) const {
+  if (values.size() != m_parameterCount) {
+    throw std::invalid_argument("Wrong number of values for endpoint " +
+                                std::string(m_pattern));
+  }
+  // A base path ending in '/' would double the endpoint's leading one.
+  std::string_view basePath = base.path;
+  if (!basePath.empty() && basePath.back() == '/')
+    basePath.remove_suffix(1);
+
+  std::size_t size = out.size() + basePath.size() + m_literalSize;
+  for (auto value : values)
+    size += encodedSize(value);
+  if (!base.query.empty())
+    size += 1 + base.query.size();
+  out.reserve(size);
+
+  out.append(basePath);
+  auto value = values.begin();
+  for (const auto& segment : *this) {
+    if (segment.parameter)
+      appendPercentEncoded(out, *value++);
+    else
+      out.append(segment.text);
+  }
+  if (!base.query.empty())
+    out.append("?").append(base.query);
+}
+
+}  // namespace utils
+}  // namespace outline
@@ -0,0 +1,102 @@
+#include "outline/utils/JsonArena.h"
+#include "outline/exceptions/OutlineExceptions.h"
+#include "outline/utils/JsonUtils.h"
+
+#include <string>
+#include <utility>
+
+namespace outline {
+namespace utils {
+
+JsonArena::JsonArena(std::size_t size)
+    : m_buffer(new unsigned char[size]),
+      m_resource(m_buffer.get(), size),
+      m_parser(boost::json::storage_ptr(), boost::json::parse_options(),
+               m_parserBuffer, sizeof(m_parserBuffer)) {}
+
+boost::json::value JsonArena::parse(std::string_view body,
+                                    std::string_view what) {
+  boost::json::error_code ec;
+  m_parser.reset(storage());
+  m_parser.write(body, ec);
+  if (ec) {
+    throw OutlineParseException("JSON parse error for " + std::string(what) +
+                                ": " + ec.message());
+  }
+  return m_parser.release();
+}
+
+void JsonArena::reset() {
+  m_parser.reset();
+  m_resource.release();
+}
+
+JsonArenaPool::Lease::Lease(JsonArenaPool* pool,
+                            std::unique_ptr<JsonArena> arena)
+    : m_pool(pool), m_arena(std::move(arena)) {}
+
+JsonArenaPool::Lease::Lease(Lease&& other) noexcept
+    : m_pool(std::exchange(other.m_pool, nullptr)),
+      m_arena(std::move(other.m_arena)) {}
+
+JsonArenaPool::Lease& JsonArenaPool::Lease::operator=(Lease&& other) noexcept {
+  if (this != &other) {
+    if (m_pool && m_arena)
+      m_pool->recycle(std::move(m_arena));
+    m_pool = std::exchange(other.m_pool, nullptr);
+    m_arena = std::move(other.m_arena);
+  }
+  return *this;
+}
+
+JsonArenaPool::Lease::~Lease() {
+  if (m_pool && m_arena)
+    m_pool->recycle(std::move(m_arena));
+}
+
+boost::json::storage_ptr JsonArenaPool::Lease::storage() const {
+  return m_arena ? m_arena->storage() : boost::json::storage_ptr();
+}
+
+boost::json::value JsonArenaPool::Lease::parse(std::string_view body,
+                                               std::string_view what) const {
+  if (!m_pool || !m_pool->m_observer)
+    return m_arena ? m_arena->parse(body, what) : parseJson(body, what);
+  auto start = std::chrono::steady_clock::now();
+  try {
+    auto value = m_arena ? m_arena->parse(body, what) : parseJson(body, what);
+    m_pool->m_observer(std::chrono::steady_clock::now() - start, true);
+    return value;
+  } catch (...) {
+    m_pool->m_observer(std::chrono::steady_clock::now() - start, false);
+    throw;
+  }
+}
+
+JsonArenaPool::JsonArenaPool(std::size_t arenaSize, std::size_t maxCached)
+    : m_arenaSize(arenaSize), m_maxCached(maxCached) {}
+
+JsonArenaPool::Lease JsonArenaPool::acquire() {
+  // A disabled pool still hands out its pointer for the parse observer.
+  if (!enabled())
+    return Lease(this, nullptr);
+  {
+    std::lock_guard lock(m_mutex);
+    if (!m_free.empty()) {
+      auto arena = std::move(m_free.back());
+      m_free.pop_back();
+      return Lease(this, std::move(arena));
+    }
+  }
+  return Lease(this, std::make_unique<JsonArena>(m_arenaSize));
+}
+
+void JsonArenaPool::recycle(std::unique_ptr<JsonArena> arena) {
+  arena->reset();
+  std::lock_guard lock(m_mutex);
+  if (m_free.size() < m_maxCached)
+    m_free.push_back(std::move(arena));
+}
+
+}  // namespace utils
+}  // namespace outline
@@ -0,0 +1,303 @@
+#include "outline/utils/JsonStreamParsers.h"
+#include "outline/exceptions/OutlineExceptions.h"
+
+#include <boost/json/basic_parser_impl.hpp>
+
+#include <string>
+#include <utility>
+
+namespace outline {
+namespace utils {
+
+namespace {
+
+using boost::json::error_code;
+
+/**
+ * SAX handler base for boost::json::basic_parser. Tracks the nesting depth,
+ * glues key and string parts together and reports complete tokens to the
+ * Derived hooks, so the derived handlers only keep the fields they need.
+ */
+template <typename Derived>
+class SaxHandler {
+ public:
+  static constexpr std::size_t max_object_size = std::size_t(-1);
+  static constexpr std::size_t max_array_size = std::size_t(-1);
+  static constexpr std::size_t max_key_size = std::size_t(-1);
+  static constexpr std::size_t max_string_size = std::size_t(-1);
+
+  bool on_document_begin(error_code&) { return true; }
+  bool on_document_end(error_code&) { return true; }
+
+  bool on_object_begin(error_code&) {
+    ++m_depth;
+    self().objectBegin();
+    return true;
+  }
+  bool on_object_end(std::size_t, error_code&) {
+    self().objectEnd();
+    --m_depth;
+    return true;
+  }
+  bool on_array_begin(error_code&) {
+    ++m_depth;
+    self().arrayBegin();
+    return true;
+  }
+  bool on_array_end(std::size_t, error_code&) {
+    self().arrayEnd();
+    --m_depth;
+    return true;
+  }
+
+  bool on_key_part(boost::json::string_view part, std::size_t, error_code&) {
+    m_key.append(part.data(), part.size());
+    return true;
+  }
+  bool on_key(boost::json::string_view part, std::size_t, error_code&) {
+    m_key.append(part.data(), part.size());
+    self().onKey(m_key);
+    m_key.clear();
+    return true;
+  }
+  bool on_string_part(boost::json::string_view part, std::size_t,
+                      error_code&) {
+    m_string.append(part.data(), part.size());
+    return true;
+  }
+  bool on_string(boost::json::string_view part, std::size_t, error_code&) {
+    m_string.append(part.data(), part.size());
+    self().onString(std::move(m_string));
+    m_string.clear();
+    return true;
+  }
+
+  bool on_number_part(boost::json::string_view, error_code&) { return true; }
+  bool on_int64(std::int64_t value, boost::json::string_view, error_code&) {
+    if (value >= 0)
+      self().onNumber(static_cast<std::uint64_t>(value));
+    return true;
+  }
+  bool on_uint64(std::uint64_t value, boost::json::string_view, error_code&) {
+    self().onNumber(value);
+    return true;
+  }
+  bool on_double(double value, boost::json::string_view, error_code&) {
+    if (value >= 0)
+      self().onNumber(static_cast<std::uint64_t>(value));
+    return true;
+  }
+  bool on_bool(bool, error_code&) { return true; }
+  bool on_null(error_code&) { return true; }
+  bool on_comment_part(boost::json::string_view, error_code&) { return true; }
+  bool on_comment(boost::json::string_view, error_code&) { return true; }
+
+  // Hooks with no interest by default.
+  void objectBegin() {}
+  void objectEnd() {}
+  void arrayBegin() {}
+  void arrayEnd() {}
+
+ protected:
+  std::size_t depth() const { return m_depth; }
+
+ private:
+  Derived& self() { return static_cast<Derived&>(*this); }
+
+  std::size_t m_depth = 0;
+  std::string m_key;
+  std::string m_string;
+};
+
+// {"accessKeys": [{"id": ..., "dataLimit": {"bytes": ...}}, ...]}
+class AccessKeyHandler : public SaxHandler<AccessKeyHandler> {
+ public:
+  explicit AccessKeyHandler(AccessKeyStreamParser::Callback callback)
+      : m_callback(std::move(callback)) {}
+
+  void objectBegin() {
+    if (depth() == 3 && m_inList) {
+      m_inKey = true;
+      m_current = AccessKey{};
+    } else if (depth() == 4 && m_inKey && m_field == "dataLimit") {
+      m_inLimit = true;
+    }
+  }
+  void objectEnd() {
+    if (depth() == 4 && m_inLimit) {
+      m_inLimit = false;
+    } else if (depth() == 3 && m_inKey) {
+      m_inKey = false;
+      ++m_count;
+      m_callback(std::move(m_current));
+    }
+  }
+  void arrayBegin() {
+    if (depth() == 2 && m_topKey == "accessKeys")
+      m_inList = true;
+  }
+  void arrayEnd() {
+    if (depth() == 2)
+      m_inList = false;
+  }
+  void onKey(const std::string& key) {
+    if (depth() == 1) {
+      m_topKey = key;
+    } else if (depth() == 3 && m_inKey) {
+      m_field = key;
+    } else if (depth() == 4 && m_inLimit) {
+      m_limitField = key;
+    }
+  }
+  void onString(std::string&& value) {
+    if (depth() != 3 || !m_inKey)
+      return;
+    if (m_field == "id") {
+      m_current.id = std::move(value);
+    } else if (m_field == "name") {
+      m_current.name = std::move(value);
+    } else if (m_field == "password") {
+      m_current.password = std::move(value);
+    } else if (m_field == "method") {
+      m_current.method = std::move(value);
+    } else if (m_field == "accessUrl") {
+      m_current.accessUrl = std::move(value);
+    }
+  }
+  void onNumber(std::uint64_t value) {
+    if (depth() == 3 && m_inKey && m_field == "port") {
+      m_current.port = static_cast<int>(value);
+    } else if (depth() == 4 && m_inLimit && m_limitField == "bytes") {
+      m_current.dataLimitBytes = static_cast<std::int64_t>(value);
+    }
+  }
+
+  std::size_t count() const { return m_count; }
+
+ private:
+  AccessKeyStreamParser::Callback m_callback;
+  std::string m_topKey;
+  std::string m_field;
+  std::string m_limitField;
+  bool m_inList = false;
+  bool m_inKey = false;
+  bool m_inLimit = false;
+  AccessKey m_current;
+  std::size_t m_count = 0;
+};
+
+// {"bytesTransferredByUserId": {"<key id>": <bytes>, ...}}
+class TransferMetricsHandler : public SaxHandler<TransferMetricsHandler> {
+ public:
+  explicit TransferMetricsHandler(TransferMetricsStreamParser::Callback callback)
+      : m_callback(std::move(callback)) {}
+
+  void objectBegin() {
+    if (depth() == 2 && m_topKey == "bytesTransferredByUserId")
+      m_inMap = true;
+  }
+  void objectEnd() {
+    if (depth() == 2)
+      m_inMap = false;
+  }
+  void onKey(const std::string& key) {
+    if (depth() == 1) {
+      m_topKey = key;
+    } else if (depth() == 2 && m_inMap) {
+      m_accessKeyId = key;
+    }
+  }
+  void onString(std::string&&) {}
+  void onNumber(std::uint64_t value) {
+    if (depth() == 2 && m_inMap) {
+      ++m_count;
+      m_callback(m_accessKeyId, value);
+    }
+  }
+
+  std::size_t count() const { return m_count; }
+
+ private:
+  TransferMetricsStreamParser::Callback m_callback;
+  std::string m_topKey;
+  std::string m_accessKeyId;
+  bool m_inMap = false;
+  std::size_t m_count = 0;
+};
+
+template <typename Handler>
+class StreamParser {
+ public:
+  template <typename Callback>
+  StreamParser(Callback&& callback, const char* what)
+      : m_parser(boost::json::parse_options{},
+                 std::forward<Callback>(callback)),
+        m_what(what) {}
+
+  void write(std::string_view chunk, bool more) {
+    error_code ec;
+    m_parser.write_some(more, chunk.data(), chunk.size(), ec);
+    if (ec) {
+      throw OutlineParseException(std::string("JSON parse error for ") +
+                                  m_what + ": " + ec.message());
+    }
+  }
+
+  std::size_t count() { return m_parser.handler().count(); }
+
+ private:
+  boost::json::basic_parser<Handler> m_parser;
+  const char* m_what;
+};
+
+}  // namespace
+
+class AccessKeyStreamParser::Impl : public StreamParser<AccessKeyHandler> {
+ public:
+  explicit Impl(Callback callback)
+      : StreamParser(std::move(callback), "access keys") {}
+};
+
+AccessKeyStreamParser::AccessKeyStreamParser(Callback onAccessKey)
+    : m_impl(std::make_unique<Impl>(std::move(onAccessKey))) {}
+
+AccessKeyStreamParser::~AccessKeyStreamParser() = default;
+
+void AccessKeyStreamParser::write(std::string_view chunk) {
+  m_impl->write(chunk, true);
+}
+
+void AccessKeyStreamParser::finish() {
+  m_impl->write({}, false);
+}
+
+std::size_t AccessKeyStreamParser::count() const {
+  return m_impl->count();
+}
+
+class TransferMetricsStreamParser::Impl
+    : public StreamParser<TransferMetricsHandler> {
+ public:
+  explicit Impl(Callback callback)
+      : StreamParser(std::move(callback), "metrics") {}
+};
+
+TransferMetricsStreamParser::TransferMetricsStreamParser(Callback onBytes)
+    : m_impl(std::make_unique<Impl>(std::move(onBytes))) {}
+
+TransferMetricsStreamParser::~TransferMetricsStreamParser() = default;
+
+void TransferMetricsStreamParser::write(std::string_view chunk) {
+  m_impl->write(chunk, true);
+}
+
+void TransferMetricsStreamParser::finish() {
+  m_impl->write({}, false);
+}
+
+std::size_t TransferMetricsStreamParser::count() const {
+  return m_impl->count();
+}
+
+}  // namespace utils
+}  // namespace outline
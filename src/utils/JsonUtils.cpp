@@ -0,0 +1,24 @@
+#include "outline/utils/JsonUtils.h"
+
+namespace outline {
+namespace utils {
+
+boost::json::value parseJson(std::string_view body, std::string_view what) {
+  try {
+    return boost::json::parse(body);
+  } catch (const std::exception& e) {
+    throw OutlineParseException("JSON parse error for " + std::string(what) +
+                                ": " + e.what());
+  }
+}
+
+std::string stringOr(const boost::json::object& obj, std::string_view key,
+                     std::string_view fallback) {
+  const auto* value = obj.if_contains(key);
+  if (value && value->is_string())
+    return std::string(value->get_string());
+  return std::string(fallback);
+}
+
+}  // namespace utils
+}  // namespace outline
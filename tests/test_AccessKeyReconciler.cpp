@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/outline/AccessKeyReconciler.h"
+
+using Clock = outline::AccessKeyReconciler::Clock;
+using Kind = outline::AccessKeyMutation::Kind;
+using outline::AccessKey;
+using outline::AccessKeyReconciler;
+using outline::BatchResult;
+using outline::DesiredAccessKey;
+
+namespace {
+
+AccessKey serverKey(std::string id, std::string name,
+                    std::optional<std::int64_t> limit = std::nullopt) {
+  AccessKey key;
+  key.id = std::move(id);
+  key.name = std::move(name);
+  key.dataLimitBytes = limit;
+  return key;
+}
+
+void resync(AccessKeyReconciler& reconciler, std::vector<AccessKey> keys,
+            Clock::time_point now = Clock::time_point{}) {
+  reconciler.beginResync();
+  for (auto& key : keys)
+    reconciler.update(std::move(key));
+  reconciler.finishResync(now);
+}
+
+BatchResult<void> succeeded(std::size_t count) {
+  return BatchResult<void>(count);
+}
+
+}  // namespace
+
+TEST(AccessKeyReconcilerTest, PlansOnlyTheFieldsThatDiffer) {
+  AccessKeyReconciler reconciler;
+  resync(reconciler, {serverKey("1", "alice"), serverKey("2", "bob", 100),
+                      serverKey("3", "carol", 100), serverKey("4", "dave")});
+
+  auto mutations = reconciler.plan({{"1", "alice", std::nullopt},
+                                    {"2", "bobby", 200},
+                                    {"3", "carol", std::nullopt},
+                                    {"4", "dave", std::nullopt},
+                                    {"5", "eve", 300}});
+  ASSERT_EQ(mutations.size(), 4u);
+  EXPECT_EQ(mutations[0].kind, Kind::Rename);
+  EXPECT_EQ(mutations[0].accessKeyId, "2");
+  EXPECT_EQ(mutations[0].name, "bobby");
+  EXPECT_EQ(mutations[1].kind, Kind::SetDataLimit);
+  EXPECT_EQ(mutations[1].dataLimitBytes, 200);
+  EXPECT_EQ(mutations[2].kind, Kind::RemoveDataLimit);
+  EXPECT_EQ(mutations[2].accessKeyId, "3");
+  EXPECT_EQ(mutations[3].kind, Kind::Create);
+  EXPECT_EQ(mutations[3].accessKeyId, "5");
+  EXPECT_EQ(mutations[3].name, "eve");
+  EXPECT_EQ(mutations[3].dataLimitBytes, 300);
+}
+
+TEST(AccessKeyReconcilerTest, DeletesUnlistedKeysOnlyWhenAsked) {
+  AccessKeyReconciler keep;
+  resync(keep, {serverKey("1", "a"), serverKey("2", "b")});
+  EXPECT_TRUE(keep.plan({{"1", "a", std::nullopt}}).empty());
+
+  outline::ReconcilerOptions options;
+  options.deleteUnlisted = true;
+  AccessKeyReconciler prune(options);
+  resync(prune, {serverKey("1", "a"), serverKey("2", "b")});
+  auto mutations = prune.plan({{"1", "a", std::nullopt}});
+  ASSERT_EQ(mutations.size(), 1u);
+  EXPECT_EQ(mutations[0].kind, Kind::Delete);
+  EXPECT_EQ(mutations[0].accessKeyId, "2");
+}
+
+TEST(AccessKeyReconcilerTest, CommitKeepsSnapshotCurrent) {
+  AccessKeyReconciler reconciler;
+  resync(reconciler, {serverKey("1", "a", 100)});
+  std::vector<DesiredAccessKey> desired{{"1", "b", std::nullopt},
+                                        {"2", "c", 50}};
+
+  auto mutations = reconciler.plan(desired);
+  ASSERT_EQ(mutations.size(), 3u);
+  reconciler.commit(mutations, succeeded(mutations.size()));
+  EXPECT_EQ(reconciler.size(), 2u);
+  EXPECT_TRUE(reconciler.plan(desired).empty());
+  EXPECT_FALSE(reconciler.resyncDue(Clock::time_point{}));
+}
+
+TEST(AccessKeyReconcilerTest, FailedMutationMakesResyncDue) {
+  AccessKeyReconciler reconciler;
+  resync(reconciler, {serverKey("1", "a")});
+  auto mutations = reconciler.plan({{"1", "b", std::nullopt}});
+  BatchResult<void> results(1);
+  results[0].error = std::make_exception_ptr(std::runtime_error("503"));
+  reconciler.commit(mutations, results);
+
+  EXPECT_TRUE(reconciler.resyncDue(Clock::time_point{}));
+  EXPECT_EQ(reconciler.plan({{"1", "b", std::nullopt}}).size(), 1u);
+}
+
+TEST(AccessKeyReconcilerTest, ResyncIsDueAfterTheInterval) {
+  outline::ReconcilerOptions options;
+  options.resyncInterval = std::chrono::seconds(60);
+  AccessKeyReconciler reconciler(options);
+  EXPECT_TRUE(reconciler.resyncDue(Clock::time_point{}));
+
+  Clock::time_point start{};
+  resync(reconciler, {serverKey("1", "a")}, start);
+  EXPECT_FALSE(reconciler.resyncDue(start + std::chrono::seconds(59)));
+  EXPECT_TRUE(reconciler.resyncDue(start + std::chrono::seconds(60)));
+
+  reconciler.invalidate();
+  EXPECT_TRUE(reconciler.resyncDue(start));
+}
+
+TEST(AccessKeyReconcilerTest, RejectsDuplicateIds) {
+  AccessKeyReconciler reconciler;
+  resync(reconciler, {});
+  EXPECT_THROW(
+      reconciler.plan({{"1", "a", std::nullopt}, {"1", "b", std::nullopt}}),
+      std::invalid_argument);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../include/outline/AccessKeySnapshot.h"
+
+using outline::AccessKey;
+using outline::AccessKeySnapshot;
+using Row = AccessKeySnapshot::Row;
+
+namespace {
+
+AccessKey makeKey(const std::string& id, std::optional<std::int64_t> limit) {
+  AccessKey key;
+  key.id = id;
+  key.name = "key-" + id;
+  key.port = 8388;
+  key.dataLimitBytes = limit;
+  return key;
+}
+
+}  // namespace
+
+TEST(AccessKeySnapshotTest, JoinsKeysAndMetricsById) {
+  AccessKeySnapshot snapshot;
+  snapshot.add(makeKey("1", std::nullopt));
+  snapshot.add(makeKey("2", 500));
+  EXPECT_TRUE(snapshot.setBytes("2", 700));
+  EXPECT_FALSE(snapshot.setBytes("9", 40));
+
+  Row row = snapshot.find("2");
+  ASSERT_NE(row, AccessKeySnapshot::npos);
+  EXPECT_EQ(snapshot.id(row), "2");
+  EXPECT_EQ(snapshot.name(row), "key-2");
+  EXPECT_EQ(snapshot.port(row), 8388);
+  EXPECT_EQ(snapshot.dataLimitBytes(row), 500);
+  EXPECT_EQ(snapshot.bytes(row), 700u);
+  EXPECT_EQ(snapshot.bytes(snapshot.find("1")), 0u);
+  EXPECT_FALSE(snapshot.dataLimitBytes(snapshot.find("1")).has_value());
+  EXPECT_EQ(snapshot.find("3"), AccessKeySnapshot::npos);
+  EXPECT_EQ(snapshot.totalBytes(), 700u);
+  EXPECT_EQ(snapshot.unmatchedBytes(), 40u);
+}
+
+TEST(AccessKeySnapshotTest, RepeatedIdReplacesTheRow) {
+  AccessKeySnapshot snapshot;
+  Row first = snapshot.add(makeKey("1", 100));
+  auto renamed = makeKey("1", std::nullopt);
+  renamed.name = "renamed";
+  EXPECT_EQ(snapshot.add(renamed), first);
+  EXPECT_EQ(snapshot.size(), 1u);
+  EXPECT_EQ(snapshot.name(first), "renamed");
+  EXPECT_FALSE(snapshot.dataLimitBytes(first).has_value());
+}
+
+TEST(AccessKeySnapshotTest, GrowsPastTheReservedSize) {
+  AccessKeySnapshot snapshot(4);
+  for (int i = 0; i < 5000; ++i)
+    snapshot.add(makeKey(std::to_string(i), std::nullopt));
+  ASSERT_EQ(snapshot.size(), 5000u);
+  for (int i = 0; i < 5000; i += 123) {
+    Row row = snapshot.find(std::to_string(i));
+    ASSERT_NE(row, AccessKeySnapshot::npos);
+    EXPECT_EQ(snapshot.id(row), std::to_string(i));
+  }
+}
+
+TEST(AccessKeySnapshotTest, TopUsageAndOverLimit) {
+  AccessKeySnapshot snapshot;
+  snapshot.add(makeKey("a", 1000));
+  snapshot.add(makeKey("b", 1000));
+  snapshot.add(makeKey("c", std::nullopt));
+  snapshot.add(makeKey("d", 100));
+  snapshot.setBytes("a", 950);
+  snapshot.setBytes("b", 300);
+  snapshot.setBytes("c", 5000);
+  snapshot.setBytes("d", 300);
+
+  EXPECT_EQ(snapshot.topUsage(3), (std::vector<Row>{2, 0, 1}));
+  EXPECT_EQ(snapshot.topUsage(10).size(), 4u);
+  EXPECT_EQ(snapshot.overLimit(), (std::vector<Row>{3}));
+  EXPECT_EQ(snapshot.overLimit(0.9), (std::vector<Row>{0, 3}));
+
+  snapshot.clear();
+  EXPECT_TRUE(snapshot.empty());
+  EXPECT_EQ(snapshot.find("a"), AccessKeySnapshot::npos);
+  EXPECT_TRUE(snapshot.overLimit().empty());
+}
@@ -40,3 +40,21 @@ TEST_F(AccessKeysTest, GetAccessKeysSuccess) {
   boost::json::object dataLimitObj = createResponseObj["dataLimit"].as_object();
   EXPECT_EQ(dataLimitObj["bytes"].as_int64(), params.data_limit_bytes);
 }
+
+TEST(AccessKeysStreamingTest, FailedStreamsOpenTheCircuitBreaker) {
+  // A local port nobody listens on, so the stream fails fast.
+  boost::asio::io_context io;
+  boost::asio::ip::tcp::acceptor acceptor(
+      io, {boost::asio::ip::make_address("127.0.0.1"), 0});
+  std::string url = "https://127.0.0.1:" +
+                    std::to_string(acceptor.local_endpoint().port()) + "/api";
+  acceptor.close();
+
+  outline::OutlineClientOptions options;
+  options.retry.breakerThreshold = 1;
+  outline::OutlineClient client(url, "", 2, options);
+  auto ignore = [](outline::AccessKey&&) {};
+  EXPECT_ANY_THROW(client.streamAccessKeys(ignore));
+  EXPECT_THROW(client.streamAccessKeys(ignore),
+               outline::OutlineCircuitOpenException);
+}
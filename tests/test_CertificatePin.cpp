@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <thread>
+#include "../include/outline/network/CertificatePin.h"
+
+namespace ssl = boost::asio::ssl;
+using boost::asio::ip::tcp;
+using outline::network::Fingerprint;
+using outline::network::parseFingerprint;
+using outline::network::pinCertificate;
+using outline::network::toHex;
+
+namespace {
+
+// Self-signed certificate like the one an Outline server generates.
+struct SelfSigned {
+  SelfSigned() {
+    EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    EVP_PKEY_keygen_init(context);
+    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(context, NID_X9_62_prime256v1);
+    EVP_PKEY_keygen(context, &key);
+    EVP_PKEY_CTX_free(context);
+
+    certificate = X509_new();
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 3600);
+    X509_set_pubkey(certificate, key);
+    X509_NAME* name = X509_get_subject_name(certificate);
+    const auto* commonName = reinterpret_cast<const unsigned char*>("outline");
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, commonName, -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    X509_sign(certificate, key, EVP_sha256());
+
+    unsigned int size = 0;
+    X509_digest(certificate, EVP_sha256(), fingerprint.data(), &size);
+  }
+  ~SelfSigned() {
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+  }
+
+  EVP_PKEY* key = nullptr;
+  X509* certificate = nullptr;
+  Fingerprint fingerprint{};
+};
+
+// Runs one handshake against a local server presenting the certificate and
+// returns the client's error.
+boost::system::error_code handshake(const SelfSigned& server,
+                                    const Fingerprint& pin,
+                                    std::optional<Fingerprint>& seen) {
+  boost::asio::io_context io;
+  ssl::context serverContext(ssl::context::tls_server);
+  SSL_CTX_use_certificate(serverContext.native_handle(), server.certificate);
+  SSL_CTX_use_PrivateKey(serverContext.native_handle(), server.key);
+  tcp::acceptor acceptor(io, {boost::asio::ip::make_address("127.0.0.1"), 0});
+
+  std::thread serverThread([&]() {
+    ssl::stream<tcp::socket> stream(io, serverContext);
+    boost::system::error_code ec;
+    acceptor.accept(stream.next_layer(), ec);
+    if (!ec)
+      stream.handshake(ssl::stream_base::server, ec);
+  });
+
+  ssl::context clientContext(ssl::context::tls_client);
+  ssl::stream<tcp::socket> client(io, clientContext);
+  pinCertificate(client, pin, seen);
+  boost::system::error_code ec;
+  client.next_layer().connect(acceptor.local_endpoint(), ec);
+  if (!ec)
+    client.handshake(ssl::stream_base::client, ec);
+  client.next_layer().close();
+  serverThread.join();
+  return ec;
+}
+
+}  // namespace
+
+TEST(CertificatePinTest, ParsesHexFingerprints) {
+  const std::string hex(64, 'a');
+  auto parsed = parseFingerprint(hex);
+  ASSERT_TRUE(parsed.has_value());
+  EXPECT_EQ((*parsed)[0], 0xaa);
+  EXPECT_EQ(toHex(*parsed), std::string(64, 'A'));
+
+  std::string colons;
+  for (int i = 0; i < 32; ++i)
+    colons += i == 0 ? "AA" : ":aa";
+  EXPECT_EQ(parseFingerprint(colons), parsed);
+
+  EXPECT_FALSE(parseFingerprint(hex.substr(2)).has_value());
+  EXPECT_FALSE(parseFingerprint(hex + "aa").has_value());
+  EXPECT_FALSE(parseFingerprint(std::string(63, 'a') + "g").has_value());
+  EXPECT_FALSE(parseFingerprint("").has_value());
+}
+
+TEST(CertificatePinTest, HandshakeAcceptsOnlyThePinnedCertificate) {
+  SelfSigned server;
+  std::optional<Fingerprint> seen;
+  EXPECT_FALSE(handshake(server, server.fingerprint, seen));
+  EXPECT_EQ(seen, server.fingerprint);
+
+  Fingerprint other = server.fingerprint;
+  other[0] ^= 0xff;
+  EXPECT_TRUE(handshake(server, other, seen));
+  EXPECT_EQ(seen, server.fingerprint);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include "../include/outline/OutlineClient.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// API URL of a local port nobody listens on, so requests fail fast.
+std::string closedPortUrl() {
+  boost::asio::io_context io;
+  boost::asio::ip::tcp::acceptor acceptor(
+      io, {boost::asio::ip::make_address("127.0.0.1"), 0});
+  return "https://127.0.0.1:" +
+         std::to_string(acceptor.local_endpoint().port()) + "/api";
+}
+
+// A port that accepts connections but never answers, so requests hang.
+struct SilentServer {
+  boost::asio::io_context io;
+  boost::asio::ip::tcp::acceptor acceptor{
+      io, {boost::asio::ip::make_address("127.0.0.1"), 0}};
+
+  std::string url() const {
+    return "https://127.0.0.1:" +
+           std::to_string(acceptor.local_endpoint().port()) + "/api";
+  }
+};
+
+outline::OutlineClientOptions singleAttempt() {
+  outline::OutlineClientOptions options;
+  options.retry.maxAttempts = 1;
+  return options;
+}
+
+}  // namespace
+
+TEST(CompletionTokensTest, DeferredCallStartsWhenLaunched) {
+  outline::OutlineClient client(closedPortUrl(), "", 2, singleAttempt());
+  auto fetch = client.getServerInformationTyped(boost::asio::deferred);
+  std::this_thread::sleep_for(50ms);
+  EXPECT_EQ(client.getInstrumentation().requests, 0u);
+
+  auto info = std::move(fetch)(boost::asio::use_future);
+  EXPECT_THROW(info.get(), std::exception);
+  EXPECT_EQ(client.getInstrumentation().requests, 1u);
+}
+
+TEST(CompletionTokensTest, DeferredCallComposesInACoroutine) {
+  outline::OutlineClient client(closedPortUrl(), "", 2, singleAttempt());
+  boost::asio::io_context io;
+  bool failed = false;
+  boost::asio::co_spawn(
+      io,
+      [&client, &failed]() -> boost::asio::awaitable<void> {
+        auto rename = client.setServerName("renamed", boost::asio::deferred);
+        try {
+          co_await std::move(rename)(boost::asio::use_awaitable);
+        } catch (const std::exception&) {
+          failed = true;
+        }
+      },
+      boost::asio::detached);
+  io.run();
+  EXPECT_TRUE(failed);
+}
+
+TEST(CompletionTokensTest, DeferredCallAfterShutdownIsRejected) {
+  outline::OutlineClient client(closedPortUrl(), "", 2, singleAttempt());
+  client.shutdown(0ms);
+  auto fetch = client.getMetricsTyped(boost::asio::deferred);
+  auto metrics = std::move(fetch)(boost::asio::use_future);
+  EXPECT_THROW(metrics.get(), outline::OutlineShutdownException);
+}
+
+TEST(CompletionTokensTest, BoundCancellationSlotCancelsTheCall) {
+  SilentServer server;
+  outline::OutlineClient client(server.url(), "", 2, singleAttempt());
+  boost::asio::cancellation_signal cancel;
+  auto info = client.getServerInformationTyped(
+      boost::asio::bind_cancellation_slot(cancel.slot(),
+                                          boost::asio::use_future));
+  std::this_thread::sleep_for(50ms);
+  cancel.emit(boost::asio::cancellation_type::terminal);
+  ASSERT_EQ(info.wait_for(5s), std::future_status::ready);
+  EXPECT_THROW(info.get(), outline::OutlineCancelledException);
+}
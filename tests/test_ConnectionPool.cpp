@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include "../include/outline/network/ConnectionPool.h"
+#include "../include/outline/network/Tracing.h"
+
+using namespace std::chrono_literals;
+using outline::network::ConnectionPool;
+using outline::network::Span;
+using outline::network::TraceContext;
+using outline::network::Tracer;
+using outline::network::TracingExecutor;
+
+namespace {
+
+class EndTrackingTracer : public Tracer {
+ public:
+  class TrackedSpan : public Span {
+   public:
+    explicit TrackedSpan(bool* ended) : ended(ended) {}
+    ~TrackedSpan() override { *ended = true; }
+
+    void setAttribute(std::string_view, std::string_view) override {}
+    void setAttribute(std::string_view, std::int64_t) override {}
+    void setError(std::string_view) override {}
+
+    bool* ended;
+  };
+
+  std::unique_ptr<Span> startSpan(
+      std::string_view, Span*,
+      std::chrono::system_clock::time_point) override {
+    return std::make_unique<TrackedSpan>(&ended);
+  }
+
+  bool ended = false;
+};
+
+}  // namespace
+
+TEST(ConnectionPoolTest, PooledConnectionDoesNotKeepTheRequestContext) {
+  boost::asio::io_context io;
+  boost::asio::ssl::context ssl(boost::asio::ssl::context::tls_client);
+  auto pool = ConnectionPool::create();
+  auto tracer = std::make_shared<EndTrackingTracer>();
+  auto context = std::make_shared<TraceContext>(
+      tracer, tracer->startSpan("caller", nullptr, {}));
+  boost::asio::any_io_executor executor =
+      TracingExecutor(boost::asio::make_strand(io), context);
+  context.reset();
+
+  boost::asio::co_spawn(
+      executor,
+      [&]() -> boost::asio::awaitable<void> {
+        auto lease = co_await pool->acquireAsync("host:443", ssl, 1s);
+        lease.markReusable();
+      },
+      boost::asio::detached);
+  executor = {};
+  io.run();
+
+  EXPECT_EQ(pool->idleCount("host:443"), 1u);
+  EXPECT_TRUE(tracer->ended);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <zlib.h>
+#include <boost/beast/http.hpp>
+#include <string>
+#include "../include/outline/network/ContentDecoding.h"
+
+namespace http = boost::beast::http;
+using outline::network::ContentDecoder;
+using outline::network::DecodingBody;
+
+namespace {
+
+// windowBits as for deflateInit2: 31 gzip, 15 zlib, -15 raw deflate.
+std::string compress(const std::string& text, int windowBits) {
+  z_stream z{};
+  deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&z, text.size()), '\0');
+  z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+  z.avail_in = static_cast<uInt>(text.size());
+  z.next_out = reinterpret_cast<Bytef*>(out.data());
+  z.avail_out = static_cast<uInt>(out.size());
+  deflate(&z, Z_FINISH);
+  out.resize(out.size() - z.avail_out);
+  deflateEnd(&z);
+  return out;
+}
+
+std::string sampleJson() {
+  std::string text = "{\"accessKeys\":[";
+  for (int i = 0; i < 2000; ++i)
+    text += "{\"id\":\"" + std::to_string(i) + "\",\"port\":443},";
+  text.back() = ']';
+  return text + "}";
+}
+
+// Parses a whole response at once, like a read would piece by piece.
+boost::system::error_code parse(http::response_parser<DecodingBody>& parser,
+                                const std::string& response) {
+  boost::system::error_code ec;
+  std::size_t used = 0;
+  while (!ec && used < response.size() && !parser.is_done()) {
+    used += parser.put(boost::asio::buffer(response.data() + used,
+                                           response.size() - used),
+                       ec);
+  }
+  return ec;
+}
+
+}  // namespace
+
+TEST(ContentDecodingTest, ParsesContentEncodings) {
+  EXPECT_EQ(ContentDecoder::parse(""), ContentDecoder::Coding::Identity);
+  EXPECT_EQ(ContentDecoder::parse(" GZIP "), ContentDecoder::Coding::Gzip);
+  EXPECT_EQ(ContentDecoder::parse("x-gzip"), ContentDecoder::Coding::Gzip);
+  EXPECT_EQ(ContentDecoder::parse("deflate"),
+            ContentDecoder::Coding::Deflate);
+  EXPECT_FALSE(ContentDecoder::parse("br").has_value());
+}
+
+TEST(ContentDecodingTest, DecodesEveryFramingPieceByPiece) {
+  const auto text = sampleJson();
+  for (auto [bits, coding] :
+       {std::pair{31, ContentDecoder::Coding::Gzip},
+        std::pair{15, ContentDecoder::Coding::Deflate},
+        std::pair{-15, ContentDecoder::Coding::Deflate}}) {
+    const auto compressed = compress(text, bits);
+    ContentDecoder decoder(coding);
+    std::string out;
+    for (std::size_t i = 0; i < compressed.size(); i += 7) {
+      ASSERT_FALSE(decoder.decode(
+          std::string_view(compressed).substr(i, 7), out));
+    }
+    EXPECT_FALSE(decoder.finish());
+    EXPECT_EQ(out, text);
+  }
+}
+
+TEST(ContentDecodingTest, RejectsTruncatedAndCorruptStreams) {
+  const auto compressed = compress(sampleJson(), 31);
+  ContentDecoder truncated(ContentDecoder::Coding::Gzip);
+  std::string out;
+  EXPECT_FALSE(truncated.decode(
+      std::string_view(compressed).substr(0, compressed.size() / 2), out));
+  EXPECT_TRUE(truncated.finish());
+
+  ContentDecoder corrupt(ContentDecoder::Coding::Gzip);
+  EXPECT_TRUE(corrupt.decode("not gzip at all", out));
+}
+
+TEST(ContentDecodingTest, ParserDecodesOrDropsTheBody) {
+  const auto text = sampleJson();
+  const auto compressed = compress(text, 31);
+  const std::string response =
+      "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " +
+      std::to_string(compressed.size()) + "\r\n\r\n" + compressed;
+
+  http::response_parser<DecodingBody> parser;
+  ASSERT_FALSE(parse(parser, response));
+  ASSERT_TRUE(parser.is_done());
+  EXPECT_EQ(parser.get().body().data, text);
+
+  http::response_parser<DecodingBody> dropping;
+  dropping.get().body().discard = true;
+  ASSERT_FALSE(parse(dropping, response));
+  ASSERT_TRUE(dropping.is_done());
+  EXPECT_TRUE(dropping.get().body().data.empty());
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../include/outline/constants/ApiEndpoint.h"
+#include "../include/outline/utils/EndpointTemplate.h"
+
+using outline::api::Endpoints;
+using outline::utils::EndpointTemplate;
+using outline::utils::buildTarget;
+using outline::utils::endpointTemplate;
+
+static_assert(endpointTemplate<Endpoints::GetAccessKeys>.parameterCount() ==
+              0);
+static_assert(endpointTemplate<Endpoints::RenameAccessKey>.parameterCount() ==
+              1);
+
+TEST(EndpointTemplateTest, SplitsLiteralAndParameterSegments) {
+  constexpr EndpointTemplate tmpl("/access-keys/{key_id}/name");
+  std::vector<std::pair<std::string, bool>> segments;
+  for (const auto& segment : tmpl)
+    segments.emplace_back(std::string(segment.text), segment.parameter);
+
+  std::vector<std::pair<std::string, bool>> expected{
+      {"/access-keys/", false}, {"key_id", true}, {"/name", false}};
+  EXPECT_EQ(segments, expected);
+}
+
+TEST(EndpointTemplateTest, BuildsTargetUnderBasePath) {
+  EXPECT_EQ(buildTarget<Endpoints::GetAccessKeys>("/secret"),
+            "/secret/access-keys");
+  EXPECT_EQ(buildTarget<Endpoints::GetAccessKeys>("/secret/"),
+            "/secret/access-keys");
+  EXPECT_EQ(buildTarget<Endpoints::RenameAccessKey>("/secret", "42"),
+            "/secret/access-keys/42/name");
+}
+
+TEST(EndpointTemplateTest, KeepsTheQueryOfTheApiUrl) {
+  using outline::utils::TargetBase;
+  EXPECT_EQ(buildTarget<Endpoints::RenameAccessKey>(
+                TargetBase{"/secret", "token=a%20b"}, "42"),
+            "/secret/access-keys/42/name?token=a%20b");
+  EXPECT_EQ(buildTarget<Endpoints::GetAccessKeys>(TargetBase{"/secret", ""}),
+            "/secret/access-keys");
+}
+
+TEST(EndpointTemplateTest, PercentEncodesValues) {
+  EXPECT_EQ(buildTarget<Endpoints::RenameAccessKey>("/secret", "a b/\xC3\xA9"),
+            "/secret/access-keys/a%20b%2F%C3%A9/name");
+}
+
+TEST(EndpointTemplateTest, RejectsMalformedTemplates) {
+  EXPECT_THROW(EndpointTemplate("/access-keys/{key_id"), std::invalid_argument);
+  EXPECT_THROW(EndpointTemplate("/access-keys/{}"), std::invalid_argument);
+
+  std::string out;
+  EXPECT_THROW(endpointTemplate<Endpoints::RenameAccessKey>.expandInto(
+                   out, "/secret", {}),
+               std::invalid_argument);
+}
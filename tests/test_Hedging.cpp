@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include "../include/outline/network/Hedging.h"
+
+using namespace std::chrono_literals;
+using outline::network::HedgeBudget;
+using outline::network::HedgeOptions;
+using outline::network::hedgeDelay;
+
+TEST(HedgingTest, DelayFollowsThePercentileWithinBounds) {
+  HedgeOptions options;
+  options.minDelay = 10ms;
+  options.maxDelay = 500ms;
+  EXPECT_EQ(hedgeDelay(options, 120000), 120ms);
+  EXPECT_EQ(hedgeDelay(options, 100), 10ms);
+  EXPECT_EQ(hedgeDelay(options, 10000000), 500ms);
+
+  options.maxDelay = 1ms;
+  EXPECT_EQ(hedgeDelay(options, 100000), 10ms);
+}
+
+TEST(HedgingTest, BudgetAllowsAFractionOfTheRequests) {
+  HedgeBudget budget(2, 0.25);
+  EXPECT_TRUE(budget.trySpend());
+  EXPECT_TRUE(budget.trySpend());
+  EXPECT_FALSE(budget.trySpend());
+
+  for (int i = 0; i < 3; ++i)
+    budget.recordRequest();
+  EXPECT_FALSE(budget.trySpend());
+  budget.recordRequest();
+  EXPECT_TRUE(budget.trySpend());
+  EXPECT_FALSE(budget.trySpend());
+
+  // Tokens stop at the maximum.
+  for (int i = 0; i < 100; ++i)
+    budget.recordRequest();
+  EXPECT_TRUE(budget.trySpend());
+  EXPECT_TRUE(budget.trySpend());
+  EXPECT_FALSE(budget.trySpend());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include "../include/outline/network/Instrumentation.h"
+
+using namespace std::chrono_literals;
+using outline::network::ErrorClass;
+using outline::network::Instrumentation;
+using outline::network::LatencyHistogram;
+using outline::network::Phase;
+
+TEST(InstrumentationTest, BucketsAreContiguousAndTight) {
+  for (std::uint64_t v = 0; v < 100000; v += 7) {
+    auto index = LatencyHistogram::bucketIndex(v);
+    EXPECT_GE(LatencyHistogram::bucketUpperBound(index), v);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::bucketUpperBound(index - 1), v);
+    }
+    EXPECT_LE(LatencyHistogram::bucketUpperBound(index), v + v / 16);
+  }
+}
+
+TEST(InstrumentationTest, PercentilesFollowTheSamples) {
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 1000; ++i)
+    histogram.record(std::chrono::microseconds(i * 100));
+  auto snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 1000u);
+  EXPECT_EQ(snapshot.max, 100000u);
+  EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.5)), 50000, 50000 / 16);
+  EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.99)), 99000,
+              99000 / 16);
+  EXPECT_EQ(snapshot.percentile(1.0), 100000u);
+}
+
+TEST(InstrumentationTest, SnapshotCollectsCountersAndEndpoints) {
+  Instrumentation instrumentation;
+  instrumentation.requestStarted();
+  instrumentation.requestStarted();
+  instrumentation.addBytesSent(10);
+  instrumentation.addBytesReceived(20);
+  instrumentation.recordPhase(Phase::Handshake, 5ms);
+  instrumentation.recordError(ErrorClass::Timeout);
+  instrumentation.requestFinished("GET", "/server", 3ms);
+  instrumentation.requestFinished("GET", "/server", 4ms);
+
+  auto snapshot = instrumentation.snapshot();
+  EXPECT_EQ(snapshot.requests, 2u);
+  EXPECT_EQ(snapshot.inFlight, 0);
+  EXPECT_EQ(snapshot.bytesSent, 10u);
+  EXPECT_EQ(snapshot.bytesReceived, 20u);
+  EXPECT_EQ(snapshot.errorCount(ErrorClass::Timeout), 1u);
+  EXPECT_EQ(snapshot.phase(Phase::Handshake).count, 1u);
+  ASSERT_EQ(snapshot.endpoints.size(), 1u);
+  EXPECT_EQ(snapshot.endpoints[0].endpoint, "/server");
+  EXPECT_EQ(snapshot.endpoints[0].latency.count, 2u);
+
+  auto text = snapshot.toPrometheus();
+  EXPECT_NE(text.find("outline_client_requests_total 2\n"), std::string::npos);
+  EXPECT_NE(text.find("outline_client_errors_total{class=\"timeout\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("outline_client_request_seconds_count{method=\"GET\","
+                      "endpoint=\"/server\"} 2\n"),
+            std::string::npos);
+}
+
+TEST(InstrumentationTest, EndpointPercentileWaitsForEnoughSamples) {
+  Instrumentation instrumentation;
+  for (int i = 1; i <= 10; ++i) {
+    instrumentation.requestStarted();
+    instrumentation.requestFinished("GET", "/server",
+                                    std::chrono::milliseconds(i));
+  }
+  EXPECT_FALSE(
+      instrumentation.endpointPercentile("GET", "/server", 0.9, 20));
+  EXPECT_FALSE(
+      instrumentation.endpointPercentile("GET", "/metrics/transfer", 0.9, 1));
+  auto p90 = instrumentation.endpointPercentile("GET", "/server", 0.9, 10);
+  ASSERT_TRUE(p90.has_value());
+  EXPECT_NEAR(static_cast<double>(*p90), 9000, 9000 / 16);
+
+  instrumentation.hedgeSent();
+  instrumentation.hedgeWon();
+  auto snapshot = instrumentation.snapshot();
+  EXPECT_EQ(snapshot.hedgesSent, 1u);
+  EXPECT_EQ(snapshot.hedgesWon, 1u);
+  EXPECT_NE(snapshot.toPrometheus().find("outline_client_hedges_total 1\n"),
+            std::string::npos);
+}
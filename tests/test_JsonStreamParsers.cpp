@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../include/outline/exceptions/OutlineExceptions.h"
+#include "../include/outline/utils/JsonStreamParsers.h"
+
+TEST(JsonStreamParsersTest, AccessKeysSplitIntoSingleBytes) {
+  std::string body = R"({"accessKeys":[
+      {"id":"1","name":"first","password":"secret","port":12345,
+       "method":"chacha20-ietf-poly1305","accessUrl":"ss://x",
+       "dataLimit":{"bytes":1024}},
+      {"id":"2","name":"second","port":443}]})";
+  std::vector<outline::AccessKey> keys;
+  outline::utils::AccessKeyStreamParser parser(
+      [&keys](outline::AccessKey&& key) { keys.push_back(std::move(key)); });
+  for (char c : body)
+    parser.write(std::string_view(&c, 1));
+  parser.finish();
+
+  ASSERT_EQ(parser.count(), 2u);
+  ASSERT_EQ(keys.size(), 2u);
+  EXPECT_EQ(keys[0].id, "1");
+  EXPECT_EQ(keys[0].password, "secret");
+  EXPECT_EQ(keys[0].port, 12345);
+  EXPECT_EQ(keys[0].dataLimitBytes, 1024);
+  EXPECT_EQ(keys[1].name, "second");
+  EXPECT_FALSE(keys[1].dataLimitBytes.has_value());
+}
+
+TEST(JsonStreamParsersTest, TransferMetrics) {
+  std::map<std::string, std::uint64_t> bytes;
+  outline::utils::TransferMetricsStreamParser parser(
+      [&bytes](std::string_view id, std::uint64_t value) {
+        bytes[std::string(id)] = value;
+      });
+  parser.write(R"({"bytesTransferredByUserId":{"1":10)");
+  parser.write(R"(00,"42":7}})");
+  parser.finish();
+
+  EXPECT_EQ(parser.count(), 2u);
+  EXPECT_EQ(bytes["1"], 1000u);
+  EXPECT_EQ(bytes["42"], 7u);
+}
+
+TEST(JsonStreamParsersTest, InvalidJsonThrows) {
+  outline::utils::TransferMetricsStreamParser parser(
+      [](std::string_view, std::uint64_t) {});
+  EXPECT_THROW(parser.write("{\"bytesTransferredByUserId\":]"),
+               outline::OutlineParseException);
+}
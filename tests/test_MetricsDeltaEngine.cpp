@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include "../include/outline/MetricsDeltaEngine.h"
+
+using Clock = outline::MetricsDeltaEngine::Clock;
+
+TEST(MetricsDeltaEngineTest, FirstPollIsBaseline) {
+  outline::MetricsDeltaEngine engine;
+  engine.begin(Clock::time_point{});
+  engine.update("1", 100);
+  engine.update("2", 200);
+  auto report = engine.finish();
+  EXPECT_TRUE(report.baseline);
+  EXPECT_TRUE(report.changed.empty());
+  EXPECT_EQ(engine.size(), 2u);
+  EXPECT_EQ(engine.bytes("2"), 200u);
+  EXPECT_FALSE(engine.bytes("3").has_value());
+}
+
+TEST(MetricsDeltaEngineTest, ReportsOnlyChangedKeysWithRates) {
+  outline::MetricsDeltaEngine engine;
+  Clock::time_point start{};
+  engine.begin(start);
+  engine.update("1", 100);
+  engine.update("2", 200);
+  engine.finish();
+
+  engine.begin(start + std::chrono::seconds(10));
+  engine.update("1", 100);
+  engine.update("2", 700);
+  engine.update("3", 50);
+  auto report = engine.finish();
+  EXPECT_FALSE(report.baseline);
+  EXPECT_DOUBLE_EQ(report.interval.count(), 10.0);
+  ASSERT_EQ(report.changed.size(), 2u);
+  EXPECT_EQ(report.changed[0].accessKeyId, "2");
+  EXPECT_EQ(report.changed[0].deltaBytes, 500u);
+  EXPECT_DOUBLE_EQ(report.changed[0].bytesPerSecond, 50.0);
+  EXPECT_EQ(report.changed[1].accessKeyId, "3");
+  EXPECT_EQ(report.changed[1].deltaBytes, 50u);
+  EXPECT_TRUE(report.removed.empty());
+}
+
+TEST(MetricsDeltaEngineTest, DetectsRemovedKeysAndResets) {
+  outline::MetricsDeltaEngine engine;
+  engine.begin(Clock::time_point{});
+  engine.update("1", 100);
+  engine.update("2", 200);
+  engine.finish();
+
+  engine.begin(Clock::time_point{} + std::chrono::seconds(1));
+  engine.update("2", 20);
+  auto report = engine.finish();
+  ASSERT_EQ(report.changed.size(), 1u);
+  EXPECT_TRUE(report.changed[0].reset);
+  EXPECT_EQ(report.changed[0].deltaBytes, 20u);
+  ASSERT_EQ(report.removed.size(), 1u);
+  EXPECT_EQ(report.removed[0], "1");
+  EXPECT_EQ(engine.size(), 1u);
+  EXPECT_FALSE(engine.bytes("1").has_value());
+}
+
+TEST(MetricsDeltaEngineTest, KeepsKeysWhileGrowing) {
+  outline::MetricsDeltaEngine engine;
+  engine.begin(Clock::time_point{});
+  for (int i = 0; i < 10000; ++i)
+    engine.update(std::to_string(i), i);
+  engine.finish();
+
+  engine.begin(Clock::time_point{} + std::chrono::seconds(1));
+  for (int i = 0; i < 10000; ++i)
+    engine.update(std::to_string(i), i + (i % 2));
+  auto report = engine.finish();
+  EXPECT_EQ(engine.size(), 10000u);
+  EXPECT_EQ(report.changed.size(), 5000u);
+  EXPECT_TRUE(report.removed.empty());
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <boost/json.hpp>
+#include <string>
+#include <vector>
+#include "../include/outline/models/AccessKey.h"
+#include "../include/outline/models/ServerInfo.h"
+#include "../include/outline/models/TransferMetrics.h"
+
+TEST(ModelsTest, AccessKeyFromJson) {
+  auto jv = boost::json::parse(R"({"accessKeys":[
+      {"id":"1","name":"first","password":"secret","port":12345,
+       "method":"chacha20-ietf-poly1305","accessUrl":"ss://x",
+       "dataLimit":{"bytes":1024}},
+      {"id":"2","name":"","password":"p","port":1,"method":"m",
+       "accessUrl":"ss://y"}]})");
+  auto keys = boost::json::value_to<std::vector<outline::AccessKey>>(
+      jv.as_object().at("accessKeys"));
+  ASSERT_EQ(keys.size(), 2u);
+  EXPECT_EQ(keys[0].id, "1");
+  EXPECT_EQ(keys[0].name, "first");
+  EXPECT_EQ(keys[0].port, 12345);
+  EXPECT_EQ(keys[0].dataLimitBytes, 1024);
+  EXPECT_FALSE(keys[1].dataLimitBytes.has_value());
+}
+
+TEST(ModelsTest, ServerInfoFromJson) {
+  auto jv = boost::json::parse(R"({"name":"Server Outline",
+      "serverId":"gb236f3c","metricsEnabled":true,
+      "createdTimestampMs":1729449481512,"version":"1.11.0",
+      "portForNewAccessKeys":443,"hostnameForAccessKeys":"1.2.3.4"})");
+  auto info = boost::json::value_to<outline::ServerInfo>(jv);
+  EXPECT_EQ(info.name, "Server Outline");
+  EXPECT_TRUE(info.metricsEnabled);
+  EXPECT_EQ(info.createdTimestampMs, 1729449481512);
+  EXPECT_EQ(info.portForNewAccessKeys, 443);
+  EXPECT_FALSE(info.accessKeyDataLimitBytes.has_value());
+}
+
+TEST(ModelsTest, TransferMetricsFromJson) {
+  auto jv = boost::json::parse(
+      R"({"bytesTransferredByUserId":{"1":1000,"7":25}})");
+  auto metrics = boost::json::value_to<outline::TransferMetrics>(jv);
+  ASSERT_EQ(metrics.bytesTransferredByUserId.size(), 2u);
+  EXPECT_EQ(metrics.bytesTransferredByUserId.at("7"), 25u);
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include "../include/outline/OutlineFleet.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// API URL of a local port nobody listens on, so requests fail fast.
+std::string closedPortUrl() {
+  boost::asio::io_context io;
+  boost::asio::ip::tcp::acceptor acceptor(
+      io, {boost::asio::ip::make_address("127.0.0.1"), 0});
+  return "https://127.0.0.1:" +
+         std::to_string(acceptor.local_endpoint().port()) + "/api";
+}
+
+outline::network::PollOptions every(std::chrono::milliseconds interval) {
+  outline::network::PollOptions options;
+  options.interval = interval;
+  options.jitter = 0;
+  return options;
+}
+
+}  // namespace
+
+// Catches a client outliving the fleet's loop when built with
+// OUTLINE_TESTS_ASAN.
+TEST(OutlineFleetTest, DestroysClientsWithSubscribedPollers) {
+  auto fleet = std::make_unique<outline::OutlineFleet>();
+  for (const auto& url : {closedPortUrl(), closedPortUrl()}) {
+    auto client = fleet->addServer(url, "");
+    client->subscribeMetrics(
+        [](std::shared_ptr<const outline::TransferMetrics>,
+           std::exception_ptr) {},
+        every(5ms));
+    client->subscribeServerInformation(
+        [](std::shared_ptr<const outline::ServerInfo>, std::exception_ptr) {},
+        every(5ms));
+  }
+  std::this_thread::sleep_for(50ms);
+  fleet.reset();
+  SUCCEED();
+}
+
+TEST(OutlineFleetTest, FanOutSkipsAShutDownClient) {
+  outline::OutlineFleet fleet;
+  auto client = fleet.addServer(closedPortUrl(), "");
+  client->shutdown(0ms);
+  std::exception_ptr error;
+  EXPECT_EQ(fleet.getMetricsAll(
+                [&error](outline::FleetResult<outline::TransferMetrics>&&
+                             result) { error = result.error; }),
+            1u);
+  ASSERT_TRUE(error);
+  EXPECT_THROW(std::rethrow_exception(error),
+               outline::OutlineShutdownException);
+  EXPECT_EQ(client->getInstrumentation().requests, 0u);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <boost/asio.hpp>
+#include "../include/outline/network/PeriodicPoller.h"
+
+using namespace std::chrono_literals;
+using outline::network::PeriodicPoller;
+using outline::network::PollOptions;
+
+namespace {
+
+boost::asio::awaitable<int> slowFetch(std::chrono::milliseconds delay) {
+  boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor,
+                                  delay);
+  co_await timer.async_wait(boost::asio::use_awaitable);
+  co_return 1;
+}
+
+PollOptions every(std::chrono::milliseconds interval, bool immediate) {
+  PollOptions options;
+  options.interval = interval;
+  options.jitter = 0;
+  options.immediate = immediate;
+  return options;
+}
+
+}  // namespace
+
+TEST(PeriodicPollerTest, ImmediateSubscribeDuringAFetchIsKept) {
+  boost::asio::io_context io;
+  int fetches = 0;
+  auto poller = PeriodicPoller<int>::create(
+      boost::asio::make_strand(io), [&fetches]() {
+        ++fetches;
+        return slowFetch(50ms);
+      });
+  int late = 0;
+  poller->subscribe(1, [](std::shared_ptr<const int>, std::exception_ptr) {},
+                    every(10s, true));
+  boost::asio::steady_timer during(io, 20ms);
+  during.async_wait([&](boost::system::error_code) {
+    poller->subscribe(
+        2, [&late](std::shared_ptr<const int>, std::exception_ptr) { ++late; },
+        every(10s, true));
+  });
+  io.run_for(500ms);
+  poller->stop();
+  // The second subscriber got its own poll instead of waiting 10 s.
+  EXPECT_EQ(fetches, 2);
+  EXPECT_EQ(late, 2);
+}
+
+TEST(PeriodicPollerTest, NoFetchStartsAfterStop) {
+  boost::asio::io_context io;
+  int fetches = 0;
+  int results = 0;
+  auto poller = PeriodicPoller<int>::create(
+      boost::asio::make_strand(io), [&fetches]() {
+        ++fetches;
+        return slowFetch(20ms);
+      });
+  poller->subscribe(
+      1, [&results](std::shared_ptr<const int>, std::exception_ptr) {
+        ++results;
+      },
+      every(1ms, true));
+  boost::asio::steady_timer during(io, 10ms);
+  during.async_wait([&](boost::system::error_code) { poller->stop(); });
+  io.run_for(200ms);
+  EXPECT_EQ(fetches, 1);
+  EXPECT_EQ(results, 0);
+}
+
+TEST(PeriodicPollerTest, SubscribeAfterStopIsRefused) {
+  boost::asio::io_context io;
+  int fetches = 0;
+  auto poller = PeriodicPoller<int>::create(
+      boost::asio::make_strand(io), [&fetches]() {
+        ++fetches;
+        return slowFetch(1ms);
+      });
+  poller->stop();
+  EXPECT_FALSE(poller->subscribe(
+      1, [](std::shared_ptr<const int>, std::exception_ptr) {},
+      every(1ms, true)));
+  io.run_for(50ms);
+  EXPECT_EQ(fetches, 0);
+}
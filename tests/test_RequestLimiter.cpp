@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <boost/asio.hpp>
+#include "../include/outline/network/RequestLimiter.h"
+
+using namespace std::chrono_literals;
+using outline::network::AdaptiveLimit;
+using outline::network::CancellationSignal;
+using outline::network::LimiterOptions;
+using outline::network::RequestContext;
+using outline::network::RequestLimiter;
+using outline::network::RequestPriority;
+using outline::network::TokenBucket;
+
+TEST(RequestLimiterTest, LimitGrowsWhileFastAndShrinksWhenSlow) {
+  LimiterOptions options;
+  options.initialLimit = 4;
+  options.maxLimit = 8;
+  AdaptiveLimit limit(options);
+  for (int i = 0; i < 100; ++i)
+    limit.record(10ms, true, limit.current());
+  EXPECT_EQ(limit.current(), 8u);
+
+  for (int i = 0; i < 10; ++i)
+    limit.record(100ms, true, limit.current());
+  EXPECT_LT(limit.current(), 4u);
+  limit.record(10ms, false, 1);
+  EXPECT_GE(limit.current(), 1u);
+}
+
+TEST(RequestLimiterTest, IdleLimitDoesNotGrow) {
+  LimiterOptions options;
+  options.initialLimit = 4;
+  AdaptiveLimit limit(options);
+  for (int i = 0; i < 100; ++i)
+    limit.record(10ms, true, 1);
+  EXPECT_EQ(limit.current(), 4u);
+}
+
+TEST(RequestLimiterTest, BucketSpacesRequestsAfterBurst) {
+  TokenBucket::Clock::time_point start{};
+  TokenBucket bucket(10, 2, start);
+  EXPECT_EQ(bucket.reserve(start), TokenBucket::Clock::duration::zero());
+  EXPECT_EQ(bucket.reserve(start), TokenBucket::Clock::duration::zero());
+  EXPECT_EQ(bucket.reserve(start), std::chrono::milliseconds(100));
+  EXPECT_EQ(bucket.reserve(start), std::chrono::milliseconds(200));
+  EXPECT_EQ(bucket.reserve(start + 1s), TokenBucket::Clock::duration::zero());
+}
+
+TEST(RequestLimiterTest, QueuesRequestsBeyondTheLimit) {
+  LimiterOptions options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  auto limiter = RequestLimiter::create(options);
+  boost::asio::io_context ioc;
+  std::vector<int> order;
+
+  auto request = [&](int id) -> boost::asio::awaitable<void> {
+    auto permit = co_await limiter->acquireAsync("host:443", 1s);
+    order.push_back(id);
+    boost::asio::steady_timer timer(ioc, 5ms);
+    co_await timer.async_wait(boost::asio::use_awaitable);
+    order.push_back(-id);
+    permit.finish(true);
+  };
+  for (int id = 1; id <= 3; ++id)
+    boost::asio::co_spawn(ioc, request(id), boost::asio::detached);
+  ioc.run();
+  EXPECT_EQ(order, (std::vector<int>{1, -1, 2, -2, 3, -3}));
+}
+
+TEST(RequestLimiterTest, WaitTimesOut) {
+  LimiterOptions options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  auto limiter = RequestLimiter::create(options);
+  boost::asio::io_context ioc;
+  bool timedOut = false;
+
+  auto run = [&]() -> boost::asio::awaitable<void> {
+    auto held = co_await limiter->acquireAsync("host:443", 1s);
+    try {
+      co_await limiter->acquireAsync("host:443", 10ms);
+    } catch (const boost::system::system_error& e) {
+      timedOut = e.code() == boost::asio::error::timed_out;
+    }
+  };
+  boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+  ioc.run();
+  EXPECT_TRUE(timedOut);
+}
+
+TEST(RequestLimiterTest, InteractiveWaitersOvertakeBulkOnes) {
+  LimiterOptions options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  auto limiter = RequestLimiter::create(options);
+  boost::asio::io_context ioc;
+  std::vector<int> order;
+  RequestContext polling{RequestPriority::Polling, nullptr};
+  RequestContext bulk{RequestPriority::Bulk, nullptr};
+
+  auto request = [&](int id, const RequestContext* context)
+      -> boost::asio::awaitable<void> {
+    auto permit = co_await limiter->acquireAsync("host:443", 1s, context);
+    order.push_back(id);
+    boost::asio::steady_timer timer(ioc, 5ms);
+    co_await timer.async_wait(boost::asio::use_awaitable);
+    permit.finish(true);
+  };
+  // The first takes the slot; the rest queue in the order they are spawned.
+  boost::asio::co_spawn(ioc, request(1, &bulk), boost::asio::detached);
+  boost::asio::co_spawn(ioc, request(2, &polling), boost::asio::detached);
+  boost::asio::co_spawn(ioc, request(3, &bulk), boost::asio::detached);
+  boost::asio::co_spawn(ioc, request(4, nullptr), boost::asio::detached);
+  ioc.run();
+  EXPECT_EQ(order, (std::vector<int>{1, 4, 3, 2}));
+}
+
+TEST(RequestLimiterTest, CancelledWaitLeavesTheQueue) {
+  LimiterOptions options;
+  options.initialLimit = 1;
+  options.maxLimit = 1;
+  auto limiter = RequestLimiter::create(options);
+  boost::asio::io_context ioc;
+  auto signal = std::make_shared<CancellationSignal>();
+  RequestContext context{RequestPriority::Interactive, signal};
+  bool aborted = false;
+
+  auto run = [&]() -> boost::asio::awaitable<void> {
+    auto held = co_await limiter->acquireAsync("host:443", 1s);
+    try {
+      co_await limiter->acquireAsync("host:443", 10s, &context);
+    } catch (const boost::system::system_error& e) {
+      aborted = e.code() == boost::asio::error::operation_aborted;
+    }
+  };
+  boost::asio::steady_timer emit(ioc, 10ms);
+  emit.async_wait([signal](boost::system::error_code) { signal->emit(); });
+  auto start = std::chrono::steady_clock::now();
+  boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+  ioc.run();
+  EXPECT_TRUE(aborted);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+}
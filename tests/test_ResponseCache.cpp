@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include "../include/outline/network/ResponseCache.h"
+
+using outline::network::ResponseCache;
+
+TEST(ResponseCacheTest, ServesFreshBodiesAndCounts) {
+  ResponseCache cache({std::chrono::milliseconds(1000)});
+  EXPECT_EQ(cache.get("server"), nullptr);
+  cache.put("server", std::make_shared<const std::string>("{}"),
+            cache.generation());
+  auto body = cache.get("server");
+  ASSERT_NE(body, nullptr);
+  EXPECT_EQ(*body, "{}");
+  EXPECT_EQ(cache.stats().hits, 1u);
+  EXPECT_EQ(cache.stats().misses, 1u);
+}
+
+TEST(ResponseCacheTest, ExpiresAfterTtl) {
+  ResponseCache cache({std::chrono::milliseconds(10)});
+  cache.put("server", std::make_shared<const std::string>("{}"),
+            cache.generation());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(cache.get("server"), nullptr);
+}
+
+TEST(ResponseCacheTest, DropsBodiesFetchedBeforeInvalidation) {
+  ResponseCache cache({std::chrono::milliseconds(1000)});
+  auto generation = cache.generation();
+  cache.invalidate("access-keys/1");
+  cache.put("access-keys/1", std::make_shared<const std::string>("old"),
+            generation);
+  EXPECT_EQ(cache.get("access-keys/1"), nullptr);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include "../include/outline/network/Retry.h"
+
+using namespace std::chrono_literals;
+using outline::network::Backoff;
+using outline::network::CircuitBreaker;
+using outline::network::RetryBudget;
+
+TEST(RetryTest, BackoffStaysWithinBounds) {
+  Backoff backoff(10ms, 200ms);
+  auto previous = 10ms;
+  for (int i = 0; i < 100; ++i) {
+    auto delay = backoff.next();
+    EXPECT_GE(delay, 10ms);
+    EXPECT_LE(delay, 200ms);
+    EXPECT_LE(delay, previous * 3);
+    previous = delay;
+  }
+}
+
+TEST(RetryTest, BudgetStopsRetriesAndRefillsOnSuccess) {
+  RetryBudget budget(10, 0.5);
+  EXPECT_TRUE(budget.canRetry());
+  for (int i = 0; i < 5; ++i)
+    budget.recordFailure();
+  EXPECT_FALSE(budget.canRetry());
+  budget.recordSuccess();
+  budget.recordSuccess();
+  EXPECT_TRUE(budget.canRetry());
+}
+
+TEST(RetryTest, BreakerOpensAndProbesAfterOpenTime) {
+  CircuitBreaker breaker(2, 100ms);
+  CircuitBreaker::Clock::time_point start{};
+  breaker.recordFailure("a:443", start);
+  EXPECT_TRUE(breaker.allow("a:443", start));
+  breaker.recordFailure("a:443", start);
+  EXPECT_FALSE(breaker.allow("a:443", start + 50ms));
+  EXPECT_TRUE(breaker.allow("b:443", start + 50ms));
+
+  // One probe at a time once the open time passed.
+  EXPECT_TRUE(breaker.allow("a:443", start + 150ms));
+  EXPECT_FALSE(breaker.allow("a:443", start + 150ms));
+  breaker.recordFailure("a:443", start + 150ms);
+  EXPECT_FALSE(breaker.allow("a:443", start + 200ms));
+
+  EXPECT_TRUE(breaker.allow("a:443", start + 300ms));
+  breaker.recordSuccess("a:443");
+  EXPECT_TRUE(breaker.allow("a:443", start + 300ms));
+  EXPECT_TRUE(breaker.allow("a:443", start + 300ms));
+}
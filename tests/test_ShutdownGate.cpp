@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <boost/asio.hpp>
+#include "../include/outline/network/ShutdownGate.h"
+
+using namespace std::chrono_literals;
+using outline::network::ShutdownGate;
+
+TEST(ShutdownGateTest, RejectsRequestsOnceClosed) {
+  ShutdownGate gate;
+  EXPECT_TRUE(gate.enter());
+  EXPECT_TRUE(gate.close());
+  EXPECT_FALSE(gate.close());
+  EXPECT_FALSE(gate.enter());
+  EXPECT_EQ(gate.inFlight(), 1u);
+  gate.leave();
+  EXPECT_EQ(gate.inFlight(), 0u);
+}
+
+TEST(ShutdownGateTest, DrainWaitsForTheLastRequest) {
+  boost::asio::io_context io;
+  ShutdownGate gate;
+  gate.enter();
+  gate.close();
+
+  boost::asio::steady_timer finish(io, 20ms);
+  finish.async_wait([&gate](boost::system::error_code) { gate.leave(); });
+  auto drained = boost::asio::co_spawn(
+      io, gate.drainAsync(std::chrono::steady_clock::now() + 10s),
+      boost::asio::use_future);
+  auto start = std::chrono::steady_clock::now();
+  io.run();
+  EXPECT_TRUE(drained.get());
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+}
+
+TEST(ShutdownGateTest, DrainGivesUpAtTheDeadline) {
+  boost::asio::io_context io;
+  ShutdownGate gate;
+  gate.enter();
+  gate.close();
+  auto drained = boost::asio::co_spawn(
+      io, gate.drainAsync(std::chrono::steady_clock::now() + 20ms),
+      boost::asio::use_future);
+  io.run();
+  EXPECT_FALSE(drained.get());
+  EXPECT_EQ(gate.inFlight(), 1u);
+}
+
+TEST(ShutdownGateTest, CancelRunsLiveRegistrationsOnly) {
+  boost::asio::io_context io;
+  ShutdownGate gate;
+  int live = 0;
+  int released = 0;
+  int late = 0;
+  auto registration =
+      gate.onCancel(io.get_executor(), [&live]() { ++live; });
+  {
+    auto gone =
+        gate.onCancel(io.get_executor(), [&released]() { ++released; });
+  }
+  gate.cancel();
+  EXPECT_TRUE(gate.cancelled());
+  auto after = gate.onCancel(io.get_executor(), [&late]() { ++late; });
+  io.run();
+  EXPECT_EQ(live, 1);
+  EXPECT_EQ(released, 0);
+  EXPECT_EQ(late, 1);
+}
+
+TEST(ShutdownGateTest, TicketLeavesWhenDestroyed) {
+  ShutdownGate gate;
+  {
+    auto ticket = gate.admit();
+    EXPECT_TRUE(ticket);
+    auto moved = std::move(ticket);
+    EXPECT_EQ(gate.inFlight(), 1u);
+  }
+  EXPECT_EQ(gate.inFlight(), 0u);
+  gate.close();
+  EXPECT_FALSE(gate.admit());
+  EXPECT_EQ(gate.inFlight(), 0u);
+}
+
+TEST(ShutdownGateTest, WaitBlocksUntilTheLastRequestLeaves) {
+  ShutdownGate gate;
+  auto ticket = gate.admit();
+  std::thread finisher([&ticket]() {
+    std::this_thread::sleep_for(20ms);
+    ticket = ShutdownGate::Ticket();
+  });
+  gate.wait();
+  EXPECT_EQ(gate.inFlight(), 0u);
+  finisher.join();
+}
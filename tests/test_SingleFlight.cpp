@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <boost/asio.hpp>
+#include "../include/outline/network/SingleFlight.h"
+
+using namespace std::chrono_literals;
+using outline::network::CancellationSignal;
+using outline::network::ContextExecutor;
+using outline::network::RequestContext;
+using outline::network::RequestPriority;
+using outline::network::SingleFlight;
+
+namespace {
+
+// Outcome of one caller of SingleFlight::run().
+struct Call {
+  std::string value;
+  bool aborted = false;
+  bool done = false;
+};
+
+boost::asio::awaitable<std::string> slowFetch(
+    std::chrono::milliseconds delay, std::optional<RequestPriority>* seen) {
+  boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor,
+                                  delay);
+  co_await timer.async_wait(boost::asio::use_awaitable);
+  if (seen)
+    *seen = RequestContext::activePriority();
+  co_return "body";
+}
+
+class SingleFlightTest : public ::testing::Test {
+ protected:
+  boost::asio::any_io_executor callerExecutor(
+      RequestPriority priority,
+      std::shared_ptr<CancellationSignal> cancellation = nullptr) {
+    return ContextExecutor<RequestContext>(
+        boost::asio::make_strand(io),
+        std::make_shared<RequestContext>(
+            RequestContext{priority, std::move(cancellation)}));
+  }
+
+  void start(boost::asio::any_io_executor executor, Call& call,
+             std::optional<RequestPriority>* seen = nullptr) {
+    boost::asio::co_spawn(
+        executor,
+        [this, &call, seen]() -> boost::asio::awaitable<void> {
+          try {
+            call.value = *co_await flight.run(
+                [this, seen]() {
+                  ++fetches;
+                  return slowFetch(50ms, seen);
+                },
+                [this]() {
+                  return boost::asio::any_io_executor(
+                      boost::asio::make_strand(io));
+                });
+          } catch (const boost::system::system_error& e) {
+            call.aborted = e.code() == boost::asio::error::operation_aborted;
+          }
+          call.done = true;
+        },
+        boost::asio::detached);
+  }
+
+  void after(std::chrono::milliseconds delay, std::function<void()> action) {
+    auto timer = std::make_shared<boost::asio::steady_timer>(io, delay);
+    timer->async_wait(
+        [timer, action](boost::system::error_code) { action(); });
+  }
+
+  boost::asio::io_context io;
+  SingleFlight<std::string> flight;
+  int fetches = 0;
+};
+
+}  // namespace
+
+TEST_F(SingleFlightTest, CancelledLeaderLeavesTheFetchToTheOthers) {
+  auto signal = std::make_shared<CancellationSignal>();
+  Call leader;
+  Call other;
+  start(callerExecutor(RequestPriority::Interactive, signal), leader);
+  after(5ms, [&]() {
+    start(callerExecutor(RequestPriority::Interactive), other);
+  });
+  after(20ms, [&]() { signal->emit(); });
+  io.run();
+
+  EXPECT_EQ(fetches, 1);
+  EXPECT_TRUE(leader.aborted);
+  EXPECT_TRUE(other.done);
+  EXPECT_EQ(other.value, "body");
+}
+
+TEST_F(SingleFlightTest, CancelledWaiterStopsWaitingAlone) {
+  auto signal = std::make_shared<CancellationSignal>();
+  Call leader;
+  Call waiter;
+  start(callerExecutor(RequestPriority::Interactive), leader);
+  after(5ms, [&]() {
+    start(callerExecutor(RequestPriority::Interactive, signal), waiter);
+  });
+  bool waiterStoppedEarly = false;
+  after(20ms, [&]() { signal->emit(); });
+  after(35ms, [&]() { waiterStoppedEarly = waiter.done && !leader.done; });
+  io.run();
+
+  EXPECT_EQ(fetches, 1);
+  EXPECT_TRUE(waiterStoppedEarly);
+  EXPECT_TRUE(waiter.aborted);
+  EXPECT_EQ(leader.value, "body");
+}
+
+TEST_F(SingleFlightTest, FetchTakesTheHighestPriorityOfItsCallers) {
+  std::optional<RequestPriority> seen;
+  Call poll;
+  Call user;
+  start(callerExecutor(RequestPriority::Polling), poll, &seen);
+  after(5ms, [&]() {
+    start(callerExecutor(RequestPriority::Interactive), user);
+  });
+  io.run();
+
+  EXPECT_EQ(fetches, 1);
+  EXPECT_EQ(seen, RequestPriority::Interactive);
+  EXPECT_EQ(poll.value, "body");
+  EXPECT_EQ(user.value, "body");
+}
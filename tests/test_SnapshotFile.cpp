@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "../include/outline/SnapshotFile.h"
+#include "../include/outline/exceptions/OutlineExceptions.h"
+
+using outline::AccessKey;
+using outline::ServerSnapshot;
+using outline::SnapshotFile;
+
+namespace {
+
+std::string tempPath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+ServerSnapshot makeSnapshot() {
+  ServerSnapshot snapshot;
+  snapshot.fetchedAt = std::chrono::system_clock::now();
+  snapshot.serverInfo.name = "server";
+  snapshot.serverInfo.serverId = "id-1";
+  snapshot.serverInfo.version = "1.9.0";
+  snapshot.serverInfo.hostnameForAccessKeys = "vpn.example.com";
+  snapshot.serverInfo.metricsEnabled = true;
+  snapshot.serverInfo.portForNewAccessKeys = 443;
+  for (int i = 0; i < 3; ++i) {
+    AccessKey key;
+    key.id = std::to_string(i);
+    key.name = "key-" + key.id;
+    key.port = 8000 + i;
+    if (i == 1)
+      key.dataLimitBytes = 1000;
+    snapshot.accessKeys.add(key);
+    snapshot.accessKeys.setBytes(key.id, 100 * (i + 1));
+  }
+  return snapshot;
+}
+
+}  // namespace
+
+TEST(SnapshotFileTest, RoundTripsTheSnapshot) {
+  auto path = tempPath("outline_snapshot_roundtrip.bin");
+  SnapshotFile::save(path, "https://host/secret", makeSnapshot());
+
+  auto loaded = SnapshotFile::load(path, "https://host/secret");
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->serverInfo.name, "server");
+  EXPECT_EQ(loaded->serverInfo.hostnameForAccessKeys, "vpn.example.com");
+  EXPECT_TRUE(loaded->serverInfo.metricsEnabled);
+  EXPECT_EQ(loaded->serverInfo.portForNewAccessKeys, 443);
+  EXPECT_FALSE(loaded->serverInfo.accessKeyDataLimitBytes.has_value());
+
+  const auto& keys = loaded->accessKeys;
+  ASSERT_EQ(keys.size(), 3u);
+  auto row = keys.find("1");
+  ASSERT_NE(row, outline::AccessKeySnapshot::npos);
+  EXPECT_EQ(keys.name(row), "key-1");
+  EXPECT_EQ(keys.port(row), 8001);
+  EXPECT_EQ(keys.dataLimitBytes(row), 1000);
+  EXPECT_EQ(keys.bytes(row), 200u);
+  EXPECT_EQ(keys.totalBytes(), 600u);
+  std::filesystem::remove(path);
+}
+
+TEST(SnapshotFileTest, IgnoresMissingFilesAndOtherServers) {
+  auto path = tempPath("outline_snapshot_source.bin");
+  std::filesystem::remove(path);
+  EXPECT_FALSE(SnapshotFile::load(path, "a").has_value());
+  SnapshotFile::save(path, "a", makeSnapshot());
+  EXPECT_FALSE(SnapshotFile::load(path, "b").has_value());
+  std::filesystem::remove(path);
+}
+
+TEST(SnapshotFileTest, RejectsTruncatedFiles) {
+  auto path = tempPath("outline_snapshot_truncated.bin");
+  SnapshotFile::save(path, "a", makeSnapshot());
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+  EXPECT_THROW(SnapshotFile::load(path, "a"), outline::OutlineParseException);
+  std::ofstream(path, std::ios::trunc) << "garbage";
+  EXPECT_THROW(SnapshotFile::load(path, "a"), outline::OutlineParseException);
+  std::filesystem::remove(path);
+}
+
+TEST(SnapshotFileTest, SeededEngineReportsDeltas) {
+  auto snapshot = makeSnapshot();
+  outline::MetricsDeltaEngine engine;
+  snapshot.seedMetrics(engine);
+  EXPECT_EQ(engine.bytes("2"), 300u);
+
+  engine.begin();
+  engine.update("0", 100);
+  engine.update("1", 250);
+  engine.update("2", 300);
+  auto report = engine.finish();
+  EXPECT_FALSE(report.baseline);
+  ASSERT_EQ(report.changed.size(), 1u);
+  EXPECT_EQ(report.changed[0].accessKeyId, "1");
+  EXPECT_EQ(report.changed[0].deltaBytes, 50u);
+}
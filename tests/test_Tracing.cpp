@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../include/outline/network/Tracing.h"
+
+using namespace std::chrono_literals;
+using outline::network::Span;
+using outline::network::TraceContext;
+using outline::network::TraceSpan;
+using outline::network::Tracer;
+using outline::network::TracingExecutor;
+
+namespace {
+
+struct RecordedSpan {
+  std::string name;
+  std::string parent;
+  std::string error;
+  bool ended = false;
+};
+
+class RecordingTracer : public Tracer {
+ public:
+  class RecordingSpan : public Span {
+   public:
+    explicit RecordingSpan(RecordedSpan* record) : record(record) {}
+    ~RecordingSpan() override { record->ended = true; }
+
+    void setAttribute(std::string_view, std::string_view) override {}
+    void setAttribute(std::string_view, std::int64_t) override {}
+    void setError(std::string_view message) override {
+      record->error = message;
+    }
+
+    RecordedSpan* record;
+  };
+
+  std::unique_ptr<Span> startSpan(
+      std::string_view name, Span* parent,
+      std::chrono::system_clock::time_point) override {
+    auto& record = *spans.emplace_back(std::make_unique<RecordedSpan>());
+    record.name = name;
+    if (parent)
+      record.parent = static_cast<RecordingSpan*>(parent)->record->name;
+    return std::make_unique<RecordingSpan>(&record);
+  }
+
+  std::vector<std::unique_ptr<RecordedSpan>> spans;
+};
+
+}  // namespace
+
+TEST(TracingTest, SpansDoNothingWithoutContext) {
+  EXPECT_EQ(TraceContext::active(), nullptr);
+  TraceSpan span("read");
+  EXPECT_FALSE(span);
+  TraceSpan::completed("parse", 1ms);
+}
+
+TEST(TracingTest, ContextFollowsTheRequestAcrossSuspensions) {
+  boost::asio::io_context io;
+  auto tracer = std::make_shared<RecordingTracer>();
+  std::shared_ptr<Span> caller = tracer->startSpan("caller", nullptr, {});
+  auto context = std::make_shared<TraceContext>(tracer, caller);
+  boost::asio::any_io_executor executor =
+      TracingExecutor(boost::asio::make_strand(io), context);
+
+  bool sawContext = false;
+  boost::asio::co_spawn(
+      executor,
+      [&]() -> boost::asio::awaitable<void> {
+        TraceSpan request("GET", "/server");
+        {
+          // The timer runs on the plain io_context; the coroutine still
+          // resumes through the request's executor.
+          boost::asio::steady_timer timer(io, 1ms);
+          TraceSpan read("read");
+          co_await timer.async_wait(boost::asio::use_awaitable);
+          sawContext = TraceContext::active() == context.get();
+        }
+        TraceSpan::completed("parse", 1ms, "Invalid JSON");
+      },
+      boost::asio::detached);
+  io.run();
+
+  EXPECT_TRUE(sawContext);
+  EXPECT_EQ(TraceContext::active(), nullptr);
+  ASSERT_EQ(tracer->spans.size(), 4u);
+  EXPECT_EQ(tracer->spans[1]->name, "GET /server");
+  EXPECT_EQ(tracer->spans[1]->parent, "caller");
+  EXPECT_EQ(tracer->spans[2]->name, "read");
+  EXPECT_EQ(tracer->spans[2]->parent, "GET /server");
+  EXPECT_EQ(tracer->spans[3]->name, "parse");
+  EXPECT_EQ(tracer->spans[3]->parent, "GET /server");
+  EXPECT_EQ(tracer->spans[3]->error, "Invalid JSON");
+  for (std::size_t i = 1; i < tracer->spans.size(); ++i)
+    EXPECT_TRUE(tracer->spans[i]->ended);
+  EXPECT_EQ(context->current, nullptr);
+}
+
+TEST(TracingTest, ContextsOnOneStrandKeepTheirOwnSpans) {
+  boost::asio::io_context io;
+  auto tracer = std::make_shared<RecordingTracer>();
+  std::shared_ptr<Span> request = tracer->startSpan("request", nullptr, {});
+  TracingExecutor first(boost::asio::make_strand(io),
+                        std::make_shared<TraceContext>(tracer, request));
+  // Like two hedge attempts of one request.
+  TracingExecutor second(first.inner(),
+                         std::make_shared<TraceContext>(tracer, request));
+
+  auto attempt = [&io](std::string name) -> boost::asio::awaitable<void> {
+    TraceSpan span(name);
+    boost::asio::steady_timer timer(io, 1ms);
+    co_await timer.async_wait(boost::asio::use_awaitable);
+    TraceSpan::completed("read " + name, 1ms);
+  };
+  boost::asio::co_spawn(first, attempt("first"), boost::asio::detached);
+  boost::asio::co_spawn(second, attempt("second"), boost::asio::detached);
+  io.run();
+
+  ASSERT_EQ(tracer->spans.size(), 5u);
+  for (std::size_t i = 1; i < tracer->spans.size(); ++i) {
+    const auto& span = *tracer->spans[i];
+    if (span.name.starts_with("read "))
+      EXPECT_EQ(span.parent, span.name.substr(5));
+    else
+      EXPECT_EQ(span.parent, "request");
+  }
+}